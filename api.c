@@ -137,7 +137,7 @@ lreplace(char *s, int len)
 #define roundlenup(n) ((n+NBLOCK-1) & ~(NBLOCK-1))
 
 	nlen = (size_t) roundlenup(len);
-	ntext = castalloc(char, nlen);
+	ntext = ltextalloc(curbp, &nlen);
 	if (ntext == NULL)
 	    return FALSE;
 	if (lvalue(lp))
@@ -276,30 +276,14 @@ int
 api_gotoline(VileBuf * vbp, int lno)
 {
 #if !SMALLER
-    int count;
     LINE *lp;
     BUFFER *bp = vbp->bp;
 
-    if (!b_is_counted(bp))
-	bsizes(bp);
-
-    count = lno - DOT.l->l_number;
-    lp = DOT.l;
-
-    while (count < 0 && lp != buf_head(bp)) {
-	lp = lback(lp);
-	count++;
-    }
-    while (count > 0) {
-	lp = lforw(lp);
-	count--;
-	if (lp == buf_head(bp))
-	    break;
-    }
+    lp = line_at(bp, lno);
 
     DOT.o = b_left_margin(curbp);
 
-    if (lp != buf_head(bp) && lno == lp->l_number) {
+    if (lp != NULL) {
 	DOT.l = lp;
 	return TRUE;
     } else {
@@ -404,27 +404,19 @@ forwchar_to_eol(int f, int n)
 int
 vl_gotoline(int n)
 {
-    int status = TRUE;		/* status return */
-
-    MARK odot;
+    LINE *lp;
 
     if (n == 0)			/* if a bogus argument...then leave */
 	return (FALSE);
 
-    odot = DOT;
+    if (n < 0)			/* count from the end of the buffer */
+	n += vl_line_count(curbp) + 1;
+
+    if ((lp = line_at(curbp, n)) == NULL)
+	return (FALSE);
 
+    DOT.l = lp;
     DOT.o = w_left_margin(curwp);
-    if (n < 0) {
-	DOT.l = lback(buf_head(curbp));
-	status = backline(TRUE, -n - 1);
-    } else {
-	DOT.l = lforw(buf_head(curbp));
-	status = forwline(TRUE, n - 1);
-    }
-    if (status != TRUE) {
-	DOT = odot;
-	return status;
-    }
     (void) firstnonwhite(FALSE, 1);
     curwp->w_flag |= WFMOVE;
     return TRUE;
@@ -3342,6 +3342,7 @@ kbd_engl_stat(const char *prompt, char *buffer, UINT which, int stated)
     size_t len = NLINE;
 
     which_current = which;
+    namebst_gen++;
 
     tb_scopy(&temp, "");
     init_filec(FILECOMPLETION_BufName);
@@ -3358,6 +3359,7 @@ kbd_engl_stat(const char *prompt, char *buffer, UINT which, int stated)
     strncpy0(buffer, tb_values(temp), len);
 
     which_current = 0;
+    namebst_gen++;
     return code;
 }
 
@@ -3368,6 +3370,7 @@ insert_namebst(const char *name, const CMDFUNC * cmd, int ro, UINT which)
     int result;
 
     TRACE2((T_CALLED "insert_namebst(%s,%s)\n", name, ro ? "ro" : "rw"));
+    namebst_gen++;
     if (name != NULL) {
 	BI_TREE *my_bst = bst_pointer(which);
 	BI_DATA temp, *p;
@@ -3447,6 +3450,7 @@ delete_namebst(const char *name, int release, int redefining, UINT which)
     int code = TRUE;
 
     TRACE((T_CALLED "delete_namebst(%s,%d) %p\n", name, release, (void *) p));
+    namebst_gen++;
     /* not a named procedure */
     if ((p = btree_search(my_bst, name)) != NULL) {
 
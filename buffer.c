@@ -65,6 +65,335 @@ find_BufferList(void)
     return find_b_name(BUFFERLIST_BufName);
 }
 
+/*--------------------------------------------------------------------------*/
+
+/*
+ * The buffer-list is also indexed by hash tables, so that lookups by address,
+ * buffer-name, filename or file-id do not walk the list.  Each listed buffer
+ * is in the address index; it is in the others if it has that key.  Buckets
+ * are chained through the buffers, which also remember the hash codes so we
+ * can unlink or rehash them after the key changes.
+ */
+typedef struct {
+    BUFFER **table;		/* buckets, chained through b_hnext[] */
+    UINT size;			/* number of buckets, a power of two */
+    UINT count;			/* number of buffers in the index */
+} BUF_HASH;
+
+#define BUF_HASH_MIN	64
+#define FNV_BASIS	2166136261U
+#define FNV_PRIME	16777619U
+
+#define BufHashBit(which)	(1U << (which))
+#define BufHashSlot(which,code)	(buf_hash[which].table \
+				 + ((code) & (buf_hash[which].size - 1)))
+#define BufHashHead(which,code)	(buf_hash[which].size \
+				 ? *BufHashSlot(which, code) \
+				 : NULL)
+
+static BUF_HASH buf_hash[bx_MAX];
+static int buf_hash_failed;	/* if out of memory, fall back to the list */
+
+static UINT
+hash_bytes(UINT code, const void *data, size_t length)
+{
+    const UCHAR *s = (const UCHAR *) data;
+
+    while (length-- != 0) {
+	code = (code ^ *s++) * FNV_PRIME;
+    }
+    return code;
+}
+
+/*
+ * Buffer-names may be compared ignoring case (filename-ic).  Fold ASCII, and
+ * give all non-ASCII bytes the same code since their case-folding depends on
+ * the locale.
+ */
+static UINT
+hash_bname(const char *name)
+{
+    UINT code = FNV_BASIS;
+    int ch;
+
+    while ((ch = CharOf(*name++)) != EOS) {
+	if (ch >= 128)
+	    ch = 128;
+	else if (ch >= 'A' && ch <= 'Z')
+	    ch += ('a' - 'A');
+	code = (code ^ (UINT) ch) * FNV_PRIME;
+    }
+    return code;
+}
+
+static UINT
+hash_fname(const char *fname)
+{
+    return hash_bytes(FNV_BASIS, fname, strlen(fname));
+}
+
+static UINT
+hash_address(BUFFER *bp)
+{
+    return hash_bytes(FNV_BASIS, &bp, sizeof(bp));
+}
+
+#ifdef CAN_CHECK_INO
+static UINT
+hash_fuid(FUID * fuid)
+{
+    UINT code = hash_bytes(FNV_BASIS, &(fuid->dev), sizeof(fuid->dev));
+    return hash_bytes(code, &(fuid->ino), sizeof(fuid->ino));
+}
+#endif
+
+/*
+ * Compute the key for the given index, returning false if the buffer does not
+ * belong in that index.
+ */
+static int
+buf_hash_code(BUFFER *bp, BUF_INDEX which, UINT *code)
+{
+    int result = FALSE;
+
+    switch (which) {
+    case bx_ADDR:
+	*code = hash_address(bp);
+	result = TRUE;
+	break;
+    case bx_NAME:
+	*code = hash_bname(bp->b_bname);
+	result = TRUE;
+	break;
+    case bx_FILE:
+	if (bp->b_fname != NULL && !isInternalName(bp->b_fname)) {
+	    *code = hash_fname(bp->b_fname);
+	    result = TRUE;
+	}
+	break;
+#ifdef CAN_CHECK_INO
+    case bx_FUID:
+	if (bp->b_fileuid.valid) {
+	    *code = hash_fuid(&(bp->b_fileuid));
+	    result = TRUE;
+	}
+	break;
+#endif
+    case bx_MAX:
+	break;
+    }
+    return result;
+}
+
+static int
+grow_buf_hash(BUF_INDEX which)
+{
+    BUF_HASH *hp = &buf_hash[which];
+    UINT size = hp->size ? (hp->size * 2) : BUF_HASH_MIN;
+    BUFFER **table;
+    BUFFER *bp;
+    UINT n;
+
+    beginDisplay();
+    if ((table = typecallocn(BUFFER *, size)) != NULL) {
+	for (n = 0; n < hp->size; ++n) {
+	    while ((bp = hp->table[n]) != NULL) {
+		BUFFER **slot = table + (bp->b_hcode[which] & (size - 1));
+		hp->table[n] = bp->b_hnext[which];
+		bp->b_hnext[which] = *slot;
+		*slot = bp;
+	    }
+	}
+	FreeIfNeeded(hp->table);
+	hp->table = table;
+	hp->size = size;
+    }
+    endofDisplay();
+    return (table != NULL);
+}
+
+static void
+buf_hash_insert(BUFFER *bp, BUF_INDEX which)
+{
+    BUF_HASH *hp = &buf_hash[which];
+    UINT code;
+
+    if (buf_hash_code(bp, which, &code)) {
+	if (hp->count >= hp->size && !grow_buf_hash(which)) {
+	    if (hp->size == 0) {
+		buf_hash_failed = TRUE;
+		return;
+	    }
+	}
+	bp->b_hcode[which] = code;
+	bp->b_hnext[which] = *BufHashSlot(which, code);
+	*BufHashSlot(which, code) = bp;
+	bp->b_hmember |= BufHashBit(which);
+	hp->count += 1;
+    }
+}
+
+static void
+buf_hash_remove(BUFFER *bp, BUF_INDEX which)
+{
+    if (bp->b_hmember & BufHashBit(which)) {
+	BUFFER **slot = BufHashSlot(which, bp->b_hcode[which]);
+
+	while (*slot != NULL) {
+	    if (*slot == bp) {
+		*slot = bp->b_hnext[which];
+		break;
+	    }
+	    slot = &((*slot)->b_hnext[which]);
+	}
+	bp->b_hnext[which] = NULL;
+	bp->b_hmember &= ~BufHashBit(which);
+	buf_hash[which].count -= 1;
+    }
+}
+
+static void
+index_buffer(BUFFER *bp)
+{
+    int n;
+
+    for (n = 0; n < (int) bx_MAX; ++n)
+	buf_hash_insert(bp, (BUF_INDEX) n);
+}
+
+static void
+unindex_buffer(BUFFER *bp)
+{
+    int n;
+
+    for (n = 0; n < (int) bx_MAX; ++n)
+	buf_hash_remove(bp, (BUF_INDEX) n);
+}
+
+/*
+ * Call this after changing the name, filename or file-id of a buffer, to
+ * update the indexes if it is in the buffer-list.
+ */
+void
+reindex_buffer(BUFFER *bp)
+{
+    if (bp->b_hmember & BufHashBit(bx_ADDR)) {
+	int n;
+
+	for (n = (int) bx_ADDR + 1; n < (int) bx_MAX; ++n) {
+	    buf_hash_remove(bp, (BUF_INDEX) n);
+	    buf_hash_insert(bp, (BUF_INDEX) n);
+	}
+    }
+}
+
+/*
+ * If more than one buffer matches, return the one which would be found first
+ * by walking the list.
+ */
+static BUFFER *
+first_in_list(BUFFER *found, BUFFER *bp)
+{
+    if (found != NULL) {
+	if (global_g_val(GMDABUFF)
+	    ? (bp->b_last_used < found->b_last_used)
+	    : (bp->b_created < found->b_created))
+	    found = bp;
+    } else {
+	found = bp;
+    }
+    return found;
+}
+
+/*
+ * Look for a filename (already lengthened) in the buffer-list.
+ */
+BUFFER *
+find_b_fname(const char *nfname)
+{
+    BUFFER *bp;
+    BUFFER *found = NULL;
+
+#if !OPT_VMS_PATH
+    if (!buf_hash_failed) {
+	if (nfname != NULL && !isInternalName(nfname)) {
+	    for (bp = BufHashHead(bx_FILE, hash_fname(nfname));
+		 bp != NULL;
+		 bp = bp->b_hnext[bx_FILE]) {
+		if (!strcmp(nfname, bp->b_fname))
+		    found = first_in_list(found, bp);
+	    }
+	}
+	return found;
+    }
+#endif
+    for_each_buffer(bp) {
+	if (same_fname(nfname, bp, FALSE)) {
+	    found = bp;
+	    break;
+	}
+    }
+    return found;
+}
+
+#ifdef CAN_CHECK_INO
+/*
+ * Look for a file-id in the buffer-list.
+ */
+BUFFER *
+find_b_fuid(FUID * fuid)
+{
+    BUFFER *bp;
+    BUFFER *found = NULL;
+
+    if (!buf_hash_failed) {
+	if (fuid->valid) {
+	    for (bp = BufHashHead(bx_FUID, hash_fuid(fuid));
+		 bp != NULL;
+		 bp = bp->b_hnext[bx_FUID]) {
+		if (fileuid_same(bp, fuid))
+		    found = first_in_list(found, bp);
+	    }
+	}
+	return found;
+    }
+    for_each_buffer(bp) {
+	if (fileuid_same(bp, fuid)) {
+	    found = bp;
+	    break;
+	}
+    }
+    return found;
+}
+#endif
+
+/*
+ * Look for a buffer whose name is exactly the given string.
+ */
+static BUFFER *
+find_b_bname(const char *bname)
+{
+    BUFFER *bp;
+    BUFFER *found = NULL;
+
+    if (!buf_hash_failed) {
+	for (bp = BufHashHead(bx_NAME, hash_bname(bname));
+	     bp != NULL;
+	     bp = bp->b_hnext[bx_NAME]) {
+	    if (eql_bname(bp, bname))
+		found = first_in_list(found, bp);
+	}
+	return found;
+    }
+    for_each_buffer(bp) {
+	if (eql_bname(bp, bname)) {
+	    found = bp;
+	    break;
+	}
+    }
+    return found;
+}
+
 /*
  * Look for a buffer-pointer in the list, to see if it has been delinked yet.
  */
@@ -73,6 +402,16 @@ find_bp(BUFFER *bp1)
 {
     if (bp1 != NULL) {
 	BUFFER *bp;
+
+	if (!buf_hash_failed) {
+	    for (bp = BufHashHead(bx_ADDR, hash_address(bp1));
+		 bp != NULL;
+		 bp = bp->b_hnext[bx_ADDR]) {
+		if (bp == bp1)
+		    return bp;
+	    }
+	    return NULL;
+	}
 	for_each_buffer(bp) {
 	    if (bp == bp1)
 		return bp;
@@ -164,15 +503,11 @@ is_pathchars(const char *fname)
 BUFFER *
 find_b_file(const char *fname)
 {
-    BUFFER *bp;
     char nfname[NFILEN];
 
     if (is_pathchars(fname)) {
 	(void) lengthen_path(vl_strncpy(nfname, fname, sizeof(nfname)));
-	for_each_buffer(bp) {
-	    if (same_fname(nfname, bp, FALSE))
-		return bp;
-	}
+	return find_b_fname(nfname);
     }
     return NULL;
 }
@@ -335,6 +670,9 @@ FreeBuffer(BUFFER *bp)
 
     beginDisplay();
 
+#if defined(MDCHK_MODTIME) && OPT_FILE_WATCH
+    unwatch_buffer_file(bp);
+#endif
     if (bp->b_fname != out_of_mem)
 	FreeIfNeeded(bp->b_fname);
 
@@ -345,6 +683,7 @@ FreeBuffer(BUFFER *bp)
     }
 #endif
     lfree(buf_head(bp), bp);	/* Release header line. */
+    lindex_clear(bp);
     if (delink_bp(bp) || is_delinked_bp(bp)) {
 	if (curbp == bp)
 	    curbp = NULL;
@@ -1638,7 +1977,7 @@ make_buffer_list(char *bufn)
 	} else if (global_g_val(GVAL_FOR_BUFFERS) == FB_REGEX) {
 	    regexp *exp;
 
-	    if ((exp = regcomp(bufn, strlen(bufn), TRUE)) != NULL) {
+	    if ((exp = regcomp_cached(bufn, strlen(bufn), TRUE)) != NULL) {
 		for_each_buffer(bp) {
 		    if (nregexec(exp, bp->b_bname, (char *) 0, 0, -1, FALSE)) {
 			result[count++] = strmalloc(bp->b_bname);
@@ -1855,6 +2194,7 @@ delink_bp(BUFFER *bp)
 	bheadp = bp2;
     else
 	bp1->b_bufp = bp2;
+    unindex_buffer(bp);
     MarkUnused(bp);
     MarkDeleted(bp);
     if (bp == last_bp)
@@ -2461,17 +2801,16 @@ add_line_at(BUFFER *bp, LINE *prevp, const char *text, int len)
 		    set_local_b_val(bp, MDNEWLINE, TRUE);
 		    bp->b_bytecount += (B_COUNT) (ntext + 1);
 		    bp->b_linecount += 1;
-#if !SMALLER			/* tradeoff between codesize & data */
-		    lp->l_number = bp->b_linecount;
-#endif
 		} else
 		    b_clr_counted(bp);
 	    }
 
+	    bp->b_changes++;
 	    set_lforw(prevp, newlp);	/* link into the buffer */
 	    set_lback(newlp, prevp);
 	    set_lback(nextp, newlp);
 	    set_lforw(newlp, nextp);
+	    lindex_insert(bp, newlp);
 
 	    result = TRUE;
 	}
@@ -2584,23 +2923,28 @@ any_unread_buf(BUFFER **bpp)
 /*
  * Copies string to a buffer-name, trimming trailing blanks for consistency.
  */
-void
-set_bname(BUFFER *bp, const char *name)
+static void
+canonical_bname(char *dst, const char *name)
 {
     int j, k;
-    char *d;
 
-    (void) strncpy0(bp->b_bname, name, (size_t) NBUFN);
+    (void) strncpy0(dst, name, (size_t) NBUFN);
 
-    d = bp->b_bname;
-    for (j = 0, k = -1; d[j]; j++) {
-	if (!isSpace(d[j]))
+    for (j = 0, k = -1; dst[j]; j++) {
+	if (!isSpace(dst[j]))
 	    k = -1;
 	else if (k < 0)
 	    k = j;
     }
     if (k >= 0)
-	d[k] = EOS;
+	dst[k] = EOS;
+}
+
+void
+set_bname(BUFFER *bp, const char *name)
+{
+    canonical_bname(bp->b_bname, name);
+    reindex_buffer(bp);
 }
 
 /*
@@ -2611,16 +2955,10 @@ set_bname(BUFFER *bp, const char *name)
 BUFFER *
 find_b_name(const char *bname)
 {
-    BUFFER *bp;
-    BUFFER temp;
+    char temp[NBUFN];
 
-    set_bname(&temp, bname);	/* make a canonical buffer-name */
-
-    for_each_buffer(bp) {
-	if (eql_bname(bp, temp.b_bname))
-	    return bp;
-    }
-    return NULL;
+    canonical_bname(temp, bname);	/* make a canonical buffer-name */
+    return find_b_bname(temp);
 }
 
 /*
@@ -2636,11 +2974,8 @@ bfind(const char *bname, UINT bflag)
     BUFFER *lastb = NULL;	/* buffer to insert after */
     BUFFER *bp2;
 
-    for_each_buffer(bp) {
-	if (eql_bname(bp, bname))
-	    return (bp);
-	lastb = bp;
-    }
+    if ((bp = find_b_bname(bname)) != NULL)
+	return (bp);
 
     TRACE((T_CALLED "bfind(%s, %u)\n", bname, bflag));
 
@@ -2699,12 +3034,18 @@ bfind(const char *bname, UINT bflag)
 	    set_lback(lp, lp);
 
 	    /* append at the end */
+	    for (lastb = bheadp;
+		 lastb != NULL && lastb->b_bufp != NULL;
+		 lastb = lastb->b_bufp) {
+		;
+	    }
 	    if (lastb)
 		lastb->b_bufp = bp;
 	    else
 		bheadp = bp;
 	    bp->b_bufp = NULL;
 	    bp->b_created = countBuffers();
+	    index_buffer(bp);
 
 	    for_each_buffer(bp2)
 		bp2->b_last_used += 1;
@@ -2765,8 +3106,6 @@ make_ro_bp(const char *bname, UINT flags)
 int
 bclear(BUFFER *bp)
 {
-    LINE *lp;
-
     if (!b_is_temporary(bp)	/* Not invisible or scratch */
 	&&b_is_changed(bp)) {	/* Something changed    */
 	char ques[30 + NBUFN];
@@ -2792,20 +3131,33 @@ bclear(BUFFER *bp)
     free_attribs(bp);
 #endif
 
-    while ((lp = lforw(buf_head(bp))) != buf_head(bp)) {
-	lremove2(bp, lp);
-    }
-
     if (bp->b_ulinep != NULL) {
 	lfree(bp->b_ulinep, bp);
 	bp->b_ulinep = NULL;
     }
+
+    lremove_all(bp);
+    bp->b_changes++;
+#if !SMALLER
+    free_maccode(bp);
+#endif
+#if OPT_LAZY_READER
+    if (bp->b_lazyfp != NULL) {
+	(void) fclose(bp->b_lazyfp);
+	bp->b_lazyfp = NULL;
+    }
+#endif
     FreeAndNull(bp->b_ltext);
     bp->b_ltext_end = NULL;
 
     FreeAndNull(bp->b_LINEs);
     bp->b_LINEs_end = NULL;
 
+#if OPT_FILTER
+    FreeAndNull(bp->b_lexfilter);
+    bp->b_lexgen = 0;
+#endif
+
     bp->b_freeLINEs = NULL;
 
     bp->b_dot = bp->b_line;	/* Fix "."              */
@@ -2832,13 +3184,14 @@ bclear(BUFFER *bp)
 
 /*
  * Update the counts for the # of bytes and lines, to use in various display
- * commands.
+ * commands.  Line-numbers are kept separately (see lindex_check).
  */
 int
 bsizes(BUFFER *bp)
 {
     int code = FALSE;
 
+    lazyreadf_finish(bp);
     if (valid_buffer(curbp)
 	&& !b_is_counted(bp)) {
 	LINE *lp;		/* current line */
@@ -2850,9 +3203,6 @@ bsizes(BUFFER *bp)
 	for_each_line(lp, bp) {
 	    ++numlines;
 	    numchars += ((B_COUNT) llength(lp) + ending);
-#if !SMALLER			/* tradeoff between codesize & data */
-	    lp->l_number = numlines;
-#endif
 	}
 	if (!b_val(bp, MDNEWLINE)) {
 	    if (numchars > ending)
@@ -2884,11 +3234,16 @@ chg_buff(BUFFER *bp, unsigned flag)
 {
     WINDOW *wp;
 
+    bp->b_changes++;
     if (is_delinked_bp(bp))
 	return;
 
     b_clr_counted(bp);
     b_match_attrs_dirty(bp);
+#if OPT_FILTER
+    if (!OkUndo(bp))		/* no line-level change tracking */
+	bp->b_lexgen = 0;
+#endif
     if (bp->b_nwnd != 1)	/* Ensure hard.             */
 	flag |= WFHARD;
     if (!b_is_changed(bp)) {	/* First change, so     */
@@ -3137,6 +3492,7 @@ void
 bp_leaks(void)
 {
     BUFFER *bp;
+    int n;
 
     TRACE((T_CALLED "bp_leaks()\n"));
     bminip = zap_buffer(bminip);
@@ -3144,6 +3500,10 @@ bp_leaks(void)
     while ((bp = bheadp) != NULL) {
 	(void) zap_buffer(bp);
     }
+    for (n = 0; n < (int) bx_MAX; ++n) {
+	FreeAndNull(buf_hash[n].table);
+	buf_hash[n].size = 0;
+    }
 #if OPT_MODELINE
     mls_regfree(-1);
 #endif
@@ -28,6 +28,18 @@ static TBUFF *gets_data;
 static const char *current_params;
 static int need_separator;
 
+/*
+ * Line-oriented filters may report their state at the start of each line
+ * (see flt_set_state), which lets flt_update() re-lex only changed lines.
+ */
+static int lex_pass;		/* pass-number stamped onto lines read */
+static int lex_last;		/* previous pass, when updating */
+static int lex_state = -1;	/* state reported for the next line */
+static int lex_resume = -1;	/* state from which to resume */
+static int lex_fresh;		/* true until the first line is read */
+static int lex_used;		/* true if the filter reported a state */
+static TBUFF *lex_name;		/* filter name/params for checkpoints */
+
 #define FLT_PUTC(ch) \
     if (filter_only > 0) { \
 	putchar(ch); \
@@ -342,6 +354,28 @@ flt_gets(char **ptr, size_t *len)
     *len = 0;
     *ptr = NULL;
 
+    if (need >= 0 && lex_pass) {
+	LINE *lp = mark_in.l;
+
+	if (lex_last
+	    && !lex_fresh
+	    && lex_state >= 0
+	    && lp->l_lexgen == lex_last
+	    && lp->l_lexstate == lex_state) {
+	    TRACE(("flt_gets - resynchronized at %d\n", line_no(curbp, lp)));
+	    need = -1;
+	} else {
+#if OPT_LINE_ATTRS
+	    if (lex_last)
+		FreeAndNull(lp->l_attrs);
+#endif
+	    lp->l_lexgen = lex_pass;
+	    lp->l_lexstate = lex_state;
+	}
+	lex_fresh = FALSE;
+	lex_state = -1;
+    }
+
     if (need >= 0
 	&& tb_init(&gets_data, 0) != NULL
 	&& tb_bappend(&gets_data, lvalue(mark_in.l), (size_t) need) != NULL
@@ -677,6 +711,86 @@ flt_lookup(char *name)
     return FALSE;
 }
 
+/*
+ * Load the keyword tables and options for the current filter, leaving the
+ * input/output marks at the beginning of the buffer.
+ */
+static void
+setup_filter(void)
+{
+    int nextarg;
+
+    need_separator = FALSE;
+    mark_in.l = lforw(buf_head(curbp));
+    mark_in.o = w_left_margin(curwp);
+    mark_out = mark_in;
+    tb_init(&gets_data, 0);
+
+    init_flt_error();
+
+    (void) ProcessArgs(0);
+
+    flt_initialize(current_filter->filter_name);
+
+    current_filter->InitFilter(1);
+
+    /* setup colors for the filter's default-table */
+    flt_read_keywords(MY_NAME);
+    if (strcmp(MY_NAME, current_filter->filter_name)) {
+	flt_read_keywords(current_filter->filter_name);
+    }
+
+    nextarg = ProcessArgs(1);
+    if (nextarg == 0) {
+	if (strcmp(MY_NAME, default_table)
+	    && strcmp(current_filter->filter_name, default_table)) {
+	    flt_read_keywords(default_table);
+	}
+    }
+    set_symbol_table(default_table);
+}
+
+/*
+ * Remember which filter (and parameters) produced the checkpoints recorded
+ * on the buffer's lines.
+ */
+static char *
+lex_filter_name(void)
+{
+    tb_scopy(&lex_name, current_filter->filter_name);
+    tb_sappend0(&lex_name, " ");
+    tb_sappend0(&lex_name, current_params);
+    return tb_values(lex_name);
+}
+
+static void
+finish_pass(BUFFER *bp)
+{
+    if (lex_used) {
+	bp->b_lexgen = lex_pass;
+	if (bp->b_lexfilter == NULL
+	    || strcmp(bp->b_lexfilter, lex_filter_name())) {
+	    FreeAndNull(bp->b_lexfilter);
+	    bp->b_lexfilter = strmalloc(lex_filter_name());
+	}
+    } else {
+	bp->b_lexgen = 0;
+    }
+    lex_pass = 0;
+    lex_last = 0;
+    lex_state = -1;
+    lex_resume = -1;
+}
+
+static int
+next_pass(BUFFER *bp)
+{
+    int result = bp->b_lexgen + 1;
+    if (result <= 0)
+	result = 1;
+    return result;
+}
+
 int
 flt_start(char *name)
 {
@@ -690,55 +804,247 @@ flt_start(char *name)
 	) {
 	MARK save_dot;
 	MARK save_mk;
-	int nextarg;
 
 	save_dot = DOT;
 	save_mk = MK;
 
-	need_separator = FALSE;
-	mark_in.l = lforw(buf_head(curbp));
-	mark_in.o = w_left_margin(curwp);
-	mark_out = mark_in;
-	tb_init(&gets_data, 0);
+	setup_filter();
+	if (FltOptions('Q')) {
+	    flt_dump_symtab(NULL);
+	} else {
+	    lex_pass = next_pass(curbp);
+	    lex_last = 0;
+	    lex_used = FALSE;
+	    lex_fresh = TRUE;
+	    current_filter->InitFilter(0);
+	    current_filter->DoFilter(stdin);
+	    finish_pass(curbp);
+	}
+#if NO_LEAKS
+	current_filter->FreeFilter();
+#endif
 
-	init_flt_error();
+	DOT = save_dot;
+	MK = save_mk;
+
+	rc = TRUE;
+    }
+    returnCode(rc);
+}
+
+/*
+ * Count the bytes from the given position up to the start of the given line.
+ */
+static B_COUNT
+region_bytes(BUFFER *bp, MARK from, LINE *upto)
+{
+    B_COUNT len_rs = (B_COUNT) len_record_sep(bp);
+    B_COUNT result = 0;
+    LINE *lp;
 
-	(void) ProcessArgs(0);
+    for (lp = from.l; lp != upto && lp != buf_head(bp); lp = lforw(lp))
+	result += line_length(lp);
+    return result - (B_COUNT) from.o;
+}
 
-	flt_initialize(current_filter->filter_name);
+/*
+ * Check an old attribute-region after re-lexing.  If it starts on a line which
+ * was re-lexed, discard it.  If it extends into lines which were re-lexed,
+ * trim it to end before those, and split off the part on unchanged lines
+ * after them (if any) as a new region following this one, to be checked in
+ * turn.  For example, typing the end of a comment into its middle line
+ * re-lexes the rest of it, which must not keep the comment's color.
+ *
+ * Return true if the region was discarded.
+ */
+static int
+prune_old_attrib(BUFFER *bp, AREGION ** rpp)
+{
+    AREGION *ap = *rpp;
+    LINE *head = buf_head(bp);
+    LINE *last = ap->ar_region.r_end.l;
+    LINE *lp;
+    LINE *next;
+
+    if (ap->ar_region.r_orig.l->l_lexgen == lex_pass) {
+	free_attrib2(bp, rpp);
+	return TRUE;
+    }
 
-	current_filter->InitFilter(1);
+    for (lp = ap->ar_region.r_orig.l; lp != last;) {
+	if ((lp = lforw(lp)) == head)
+	    break;
+	if (lp->l_lexgen != lex_pass)
+	    continue;
 
-	/* setup colors for the filter's default-table */
-	flt_read_keywords(MY_NAME);
-	if (strcmp(MY_NAME, current_filter->filter_name)) {
-	    flt_read_keywords(current_filter->filter_name);
+	for (next = lp;
+	     next != last && next != head && next->l_lexgen == lex_pass;
+	     next = lforw(next)) {
+	    ;
 	}
-
-	nextarg = ProcessArgs(1);
-	if (nextarg == 0) {
-	    if (strcmp(MY_NAME, default_table)
-		&& strcmp(current_filter->filter_name, default_table)) {
-		flt_read_keywords(default_table);
+	if (next != head
+	    && next->l_lexgen != lex_pass
+	    && !(next == last && ap->ar_region.r_end.o == 0)) {
+	    AREGION *tail;
+
+	    beginDisplay();
+	    if ((tail = typealloc(AREGION)) != NULL) {
+		*tail = *ap;
+#if OPT_HYPERTEXT
+		if (ap->ar_hypercmd != NULL)
+		    tail->ar_hypercmd = strmalloc(ap->ar_hypercmd);
+#endif
+		tail->ar_region.r_orig.l = next;
+		tail->ar_region.r_orig.o = 0;
+		tail->ar_region.r_size = region_bytes(bp,
+						      tail->ar_region.r_orig,
+						      last)
+		    + (B_COUNT) tail->ar_region.r_end.o;
+		tail->ar_region.r_attr_id = (USHORT) assign_attr_id();
+		tail->ar_next = ap->ar_next;
+		ap->ar_next = tail;
+		index_attrib(bp, tail);
 	    }
+	    endofDisplay();
 	}
-	set_symbol_table(default_table);
-	if (FltOptions('Q')) {
-	    flt_dump_symtab(NULL);
-	} else {
+	ap->ar_region.r_end.l = lp;
+	ap->ar_region.r_end.o = 0;
+	ap->ar_region.r_size = region_bytes(bp, ap->ar_region.r_orig, lp);
+	reindex_attrib(bp, ap);
+	break;
+    }
+    return FALSE;
+}
+
+/*
+ * Given a buffer which was highlighted by a filter that recorded its state
+ * at the start of each line, re-lex only the lines which have changed since
+ * then.  Each run starts from the nearest line whose state is known, and
+ * stops when the filter reaches an unchanged line in the same state that it
+ * had before.  Attributes on the lines which were re-lexed are discarded.
+ *
+ * Return false if this cannot be done, e.g., the filter does not record its
+ * state, or its parameters have changed.  The caller should then discard all
+ * highlighting and use flt_start().
+ */
+int
+flt_update(char *name)
+{
+    BUFFER *bp = curbp;
+    int rc = FALSE;
+
+    TRACE((T_CALLED "flt_update(%s)\n", name));
+    if (bp->b_lexgen != 0
+	&& bp->b_lexfilter != NULL
+#ifdef MDFILTERMSGS
+	&& !b_val(bp, MDFILTERMSGS)
+#endif
+	&& flt_lookup(name)
+#ifdef HAVE_LIBDL
+	&& (current_filter->loaded || load_filter(current_filter->filter_name))
+#endif
+	&& !strcmp(bp->b_lexfilter, lex_filter_name())) {
+	MARK save_dot;
+	MARK save_mk;
+	AREGION *old_attribs = bp->b_attribs;
+	AREGION **rpp;
+	LINE *head = buf_head(bp);
+	LINE *lp;
+	LINE *start;
+
+	save_dot = DOT;
+	save_mk = MK;
+
+	setup_filter();
+
+	lex_last = bp->b_lexgen;
+	lex_pass = next_pass(bp);
+	lex_used = FALSE;
+	rc = TRUE;
+
+	for (lp = lforw(head); lp != head;) {
+	    if (lp->l_lexgen == lex_last) {
+		lp = lforw(lp);
+		continue;
+	    }
+	    for (start = lp;
+		 lback(start) != head && start->l_lexstate < 0;
+		 start = lback(start)) {
+		;
+	    }
+	    TRACE(("...relex from %d\n", line_no(bp, start)));
+	    lex_resume = (lback(start) != head) ? start->l_lexstate : -1;
+	    lex_state = -1;
+	    lex_fresh = TRUE;
+	    need_separator = FALSE;
+	    mark_in.l = start;
+	    mark_in.o = w_left_margin(curwp);
+	    mark_out = mark_in;
+
 	    current_filter->InitFilter(0);
 	    current_filter->DoFilter(stdin);
+
+	    if (mark_in.l == start) {
+		rc = FALSE;	/* the filter did not read anything */
+		break;
+	    }
+	    lp = mark_in.l;
+	}
+
+	/* discard the old multi-line attributes on lines which we re-lexed */
+	rpp = &bp->b_attribs;
+	while (*rpp != NULL && *rpp != old_attribs)
+	    rpp = &(*rpp)->ar_next;
+	while (*rpp != NULL) {
+	    if (!prune_old_attrib(bp, rpp))
+		rpp = &(*rpp)->ar_next;
+	}
+
+	/* the remaining lines are unchanged, carry them into this pass */
+	for_each_line(lp, bp) {
+	    if (lp->l_lexgen == lex_last)
+		lp->l_lexgen = lex_pass;
 	}
+	if (!rc)
+	    lex_used = FALSE;
+	finish_pass(bp);
 #if NO_LEAKS
 	current_filter->FreeFilter();
 #endif
 
 	DOT = save_dot;
 	MK = save_mk;
+    }
+    returnCode(rc);
+}
 
+/*
+ * A line-oriented filter calls this just before reading each line, to record
+ * the state (a nonnegative number) from which it could resume at that line.
+ */
+void
+flt_set_state(int state)
+{
+    lex_state = state;
+    lex_used = TRUE;
+}
+
+/*
+ * A filter which uses flt_set_state calls this before reading the first line,
+ * to see if it is resuming from a recorded state, rather than starting from
+ * the beginning of the buffer.
+ */
+int
+flt_get_state(int *state)
+{
+    int rc = FALSE;
+
+    if (lex_resume >= 0) {
+	*state = lex_resume;
+	lex_resume = -1;
 	rc = TRUE;
     }
-    returnCode(rc);
+    return rc;
 }
 
 /*
@@ -926,6 +1232,7 @@ flt_leaks(void)
     FreeAndNull(default_table);
     FreeAndNull(default_attr);
     tb_free(&filter_list);
+    tb_free(&lex_name);
 }
 #endif
 
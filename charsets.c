@@ -9,6 +9,10 @@
 
 #include <estruct.h>
 #include <chgdfunc.h>
+
+#ifdef DEBUG_CHARSETS
+#define realdef			/* the test-driver defines the editor's data */
+#endif
 #include <edef.h>
 #include <nefsms.h>
 
@@ -16,6 +20,10 @@
 #include <iconv.h>
 #include <locale.h>
 #endif
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 /* *INDENT-OFF* */
 static const UCHAR mark_NONE[]    = { 0x00 };
 static const UCHAR mark_UTF8[]    = { 0xef, 0xbb, 0xbf };
@@ -244,6 +252,272 @@ vl_conv_to_utf32(UINT * target, const char *source, B_COUNT limit)
 #undef CH
 }
 
+/******************************************************************************/
+
+/*
+ * The functions in this section work on a whole file's contents at once,
+ * rather than a line at a time.  Where SSE2 is available, they look at 16
+ * bytes at a time, handling runs of ASCII text with a few instructions.
+ */
+
+#if defined(__SSE2__)
+#define LoadBlock(p) _mm_loadu_si128((const __m128i *) (const void *) (p))
+
+static int
+count_bits(unsigned value)
+{
+    value = value - ((value >> 1) & 0x5555);
+    value = (value & 0x3333) + ((value >> 2) & 0x3333);
+    value = (value + (value >> 4)) & 0x0f0f;
+    return (int) ((value + (value >> 8)) & 0x1f);
+}
+#endif
+
+/*
+ * Return the number of leading bytes which are ASCII.
+ */
+static size_t
+ascii_span(const UCHAR * buffer, size_t length)
+{
+    size_t n = 0;
+
+#if defined(__SSE2__)
+    while (n + 16 <= length
+	   && _mm_movemask_epi8(LoadBlock(buffer + n)) == 0) {
+	n += 16;
+    }
+#else
+#define HIGH_BITS ((~0UL / 0xff) * 0x80)
+    while (n + sizeof(ULONG) <= length) {
+	ULONG word;
+
+	memcpy(&word, buffer + n, sizeof(word));
+	if (word & HIGH_BITS)
+	    break;
+	n += sizeof(word);
+    }
+#undef HIGH_BITS
+#endif
+    while (n < length && buffer[n] < 0x80)
+	++n;
+    return n;
+}
+
+/*
+ * Return the number of bytes in units of the mark's size whose pattern of
+ * null/non-null bytes matches the mark.
+ */
+static B_COUNT
+count_riddled(const UCHAR * mark, size_t size, const UCHAR * buffer, size_t length)
+{
+    B_COUNT total = 0;
+    size_t j = 0;
+    size_t k;
+
+#if defined(__SSE2__)
+    if (16 % size == 0) {
+	const __m128i zero = _mm_setzero_si128();
+	unsigned nulls = 0;	/* bits for the bytes which should be null */
+	unsigned first = 0;	/* bits for the first byte of each unit */
+
+	for (k = 0; k < 16; ++k) {
+	    if (!IsNonNull(mark[k % size]))
+		nulls |= (1U << k);
+	    if (k % size == 0)
+		first |= (1U << k);
+	}
+	for (; j + 16 <= length; j += 16) {
+	    unsigned diff = ((unsigned) _mm_movemask_epi8(_mm_cmpeq_epi8(LoadBlock(buffer + j),
+									 zero))
+			     ^ nulls);
+	    unsigned fail = diff;	/* first bit of each unit with a difference */
+
+	    for (k = 1; k < size; ++k)
+		fail |= (diff >> k);
+	    total += (B_COUNT) (count_bits(~fail & first) * (int) size);
+	}
+    }
+#endif
+    for (; j + size <= length; j += size) {
+	int found = 1;
+	for (k = 0; k < size; ++k) {
+	    UCHAR have = buffer[j + k];
+	    UCHAR want = (UCHAR) IsNonNull(mark[k]);
+	    if (!have ^ !want) {
+		found = 0;
+		break;
+	    }
+	}
+	if (found) {
+	    total += (B_COUNT) size;
+	}
+    }
+    return total;
+}
+
+static UCHAR *
+put_utf8(UCHAR * target, UINT source)
+{
+    if (source < 0x80) {
+	*target++ = (UCHAR) source;
+    } else if (source < 0x800) {
+	*target++ = (UCHAR) (0xc0 | (source >> 6));
+	*target++ = (UCHAR) (0x80 | (source & 0x3f));
+    } else if (source < 0x10000) {
+	*target++ = (UCHAR) (0xe0 | (source >> 12));
+	*target++ = (UCHAR) (0x80 | ((source >> 6) & 0x3f));
+	*target++ = (UCHAR) (0x80 | (source & 0x3f));
+    } else {
+	target += vl_conv_to_utf8(target, source, (B_COUNT) 6);
+    }
+    return target;
+}
+
+static UCHAR *
+utf16_to_utf8(UCHAR * target, const UCHAR * source, size_t units, int big)
+{
+    size_t j = 0;
+
+    while (j < units) {
+	size_t last = units;
+
+#if defined(__SSE2__)
+	if (j + 8 <= units) {
+	    __m128i chunk = LoadBlock(source + (2 * j));
+
+	    if (big)
+		chunk = _mm_or_si128(_mm_slli_epi16(chunk, 8),
+				     _mm_srli_epi16(chunk, 8));
+	    if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(chunk,
+								_mm_set1_epi16((short) 0xff80)),
+						  _mm_setzero_si128())) == 0xffff) {
+		_mm_storel_epi64((__m128i *) (void *) target,
+				 _mm_packus_epi16(chunk, chunk));
+		target += 8;
+		j += 8;
+		continue;
+	    }
+	    last = j + 8;
+	}
+#endif
+	for (; j < last; ++j) {
+	    const UCHAR *p = source + (2 * j);
+	    target = put_utf8(target, (big
+				       ? (((UINT) p[0] << 8) | p[1])
+				       : (((UINT) p[1] << 8) | p[0])));
+	}
+    }
+    return target;
+}
+
+static UCHAR *
+utf32_to_utf8(UCHAR * target, const UCHAR * source, size_t units, int big)
+{
+    size_t j = 0;
+
+    while (j < units) {
+	size_t last = units;
+
+#if defined(__SSE2__)
+	if (j + 4 <= units) {
+	    __m128i chunk = LoadBlock(source + (4 * j));
+	    __m128i check = _mm_set1_epi32(big ? (int) 0x80ffffff : ~0x7f);
+
+	    if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(chunk, check),
+						  _mm_setzero_si128())) == 0xffff) {
+		int packed;
+
+		if (big)
+		    chunk = _mm_srli_epi32(chunk, 24);
+		chunk = _mm_packs_epi32(chunk, chunk);
+		packed = _mm_cvtsi128_si32(_mm_packus_epi16(chunk, chunk));
+		memcpy(target, &packed, (size_t) 4);
+		target += 4;
+		j += 4;
+		continue;
+	    }
+	    last = j + 4;
+	}
+#endif
+	for (; j < last; ++j) {
+	    const UCHAR *p = source + (4 * j);
+	    target = put_utf8(target, (big
+				       ? (((UINT) p[0] << 24) |
+					  ((UINT) p[1] << 16) |
+					  ((UINT) p[2] << 8) |
+					  p[3])
+				       : (((UINT) p[3] << 24) |
+					  ((UINT) p[2] << 16) |
+					  ((UINT) p[1] << 8) |
+					  p[0])));
+	}
+    }
+    return target;
+}
+
+/*
+ * Transcode UTF-16 or UTF-32 text into UTF-8, returning a new buffer, or null
+ * if the encoding is not one of those, or no memory is available.  A partial
+ * unit at the end is padded with nulls.
+ */
+static UCHAR *
+transcode_to_utf8(BOM_CODES code, const UCHAR * buffer, B_COUNT * length)
+{
+    UCHAR *result = NULL;
+    UCHAR *target = NULL;
+    UCHAR *shrunk;
+    UCHAR extra[4];
+    size_t size = 0;
+    size_t most = 0;
+    size_t units = 0;
+    size_t partial = 0;
+    int big = (code == bom_UTF16BE || code == bom_UTF32BE);
+
+    switch (code) {
+    case bom_UTF16LE:
+    case bom_UTF16BE:
+	size = 2;
+	most = 3;
+	break;
+    case bom_UTF32LE:
+    case bom_UTF32BE:
+	size = 4;
+	most = 6;
+	break;
+    default:
+	break;
+    }
+
+    if (size != 0) {
+	units = (size_t) (*length / size);
+	partial = (size_t) (*length % size);
+    }
+    if (size != 0
+	&& (result = typeallocn(UCHAR, (units + 1) * most + 1)) != NULL) {
+	if (size == 2) {
+	    target = utf16_to_utf8(result, buffer, units, big);
+	} else {
+	    target = utf32_to_utf8(result, buffer, units, big);
+	}
+	if (partial) {
+	    memset(extra, 0, sizeof(extra));
+	    memcpy(extra, buffer + (units * size), partial);
+	    if (size == 2) {
+		target = utf16_to_utf8(target, extra, (size_t) 1, big);
+	    } else {
+		target = utf32_to_utf8(target, extra, (size_t) 1, big);
+	    }
+	}
+	*length = (B_COUNT) (target - result);
+	result[*length] = '\0';
+	if ((shrunk = typereallocn(UCHAR, result, *length + 1)) != NULL)
+	    result = shrunk;
+	TRACE(("transcoded %s to %lu bytes of UTF-8\n",
+	       byteorder2s(code), (unsigned long) *length));
+    }
+    return result;
+}
+
 static const BOM_TABLE *
 find_mark_info(BOM_CODES code)
 {
@@ -550,19 +824,20 @@ load_as_utf8(BUFFER *bp, LINE *lp)
 				(unsigned long) lp->l_size));
 			if ((int) k > llength(lp)) {
 			    char *ntext;
+			    size_t nsize = (size_t) k + 1;
 
 			    /*
 			     * We are doing this conversion on the initial load
 			     * of the buffer, do not want to allow undo.  Just
 			     * go ahead and reallocate the line's text buffer.
 			     */
-			    if ((ntext = castalloc(char, (k + 1))) == NULL) {
+			    if ((ntext = ltextalloc(bp, &nsize)) == NULL) {
 				rc = FALSE;
 				break;
 			    }
 			    ltextfree(lp, bp);
 			    lvalue(lp) = ntext;
-			    lp->l_size = k;
+			    lp->l_size = nsize;
 			    llength(lp) = (int) k;
 			} else {
 			    llength(lp) = (int) k;
@@ -661,7 +936,6 @@ riddled_buffer(const BOM_TABLE * mp, UCHAR * buffer, B_COUNT length)
     int result = 0;
     B_COUNT total = 0;
     size_t offset = 0;
-    size_t j, k;
 
     if (mp->size && !(mp->size % 2)) {
 	TRACE(("checking if %s / %u-byte\n",
@@ -679,20 +953,8 @@ riddled_buffer(const BOM_TABLE * mp, UCHAR * buffer, B_COUNT length)
 	    /*
 	     * Now walk through the line and measure the pattern against it.
 	     */
-	    for (j = offset; j < (unsigned) length; j += mp->size) {
-		int found = 1;
-		for (k = 0; k < mp->size; ++k) {
-		    UCHAR have = buffer[j + k];
-		    UCHAR want = (UCHAR) IsNonNull(mp->mark[k]);
-		    if (!have ^ !want) {
-			found = 0;
-			break;
-		    }
-		}
-		if (found) {
-		    total += (B_COUNT) mp->size;
-		}
-	    }
+	    total = count_riddled(mp->mark, mp->size,
+				  buffer + offset, (size_t) (length - offset));
 	}
 	result = (int) (length
 			? (((100.0 * (double) total) / (double) length))
@@ -859,12 +1121,12 @@ decode_charset(BUFFER *bp, LINE *lp)
  * If the encoding is unknown or 8-bit, we can inspect the buffer to see if it
  * makes more sense as UTF-8.
  */
-int
-deduce_charset(BUFFER *bp, UCHAR * buffer, B_COUNT * length, int always)
+static int
+deduce_encoding(BUFFER *bp, UCHAR * buffer, B_COUNT length, int always)
 {
     int rc = FALSE;
 
-    TRACE((T_CALLED "deduce_charset(%s) bom:%s, encoding:%s\n",
+    TRACE(("deduce_encoding(%s) bom:%s, encoding:%s\n",
 	   bp->b_bname,
 	   byteorder2s(b_val(bp, VAL_BYTEORDER_MARK)),
 	   encoding2s(b_val(bp, VAL_FILE_ENCODING))));
@@ -876,7 +1138,7 @@ deduce_charset(BUFFER *bp, UCHAR * buffer, B_COUNT * length, int always)
 	int found = -1;
 
 	for (n = 0; n < TABLESIZE(bom_table); ++n) {
-	    int check = riddled_buffer(&bom_table[n], buffer, *length);
+	    int check = riddled_buffer(&bom_table[n], buffer, length);
 	    if (check > match) {
 		match = check;
 		found = (int) n;
@@ -903,16 +1165,52 @@ deduce_charset(BUFFER *bp, UCHAR * buffer, B_COUNT * length, int always)
 	    rc = TRUE;
 	} else if (always) {
 	    TRACE(("...try looking for UTF-8\n"));
-	    if (check_utf8(buffer, *length) == TRUE)
+	    if (check_utf8(buffer, length) == TRUE)
 		found_utf8(bp);
 	}
     } else {
 	rc = TRUE;
     }
+    return rc;
+}
+
+int
+deduce_charset(BUFFER *bp, UCHAR * buffer, B_COUNT * length, int always)
+{
+    int rc;
+
+    TRACE((T_CALLED "deduce_charset(%s)\n", bp->b_bname));
+    rc = deduce_encoding(bp, buffer, *length, always);
     remove_crlf_nulls(bp, buffer, length);
     returnCode(rc);
 }
 
+/*
+ * This is deduce_charset() for the whole contents of a file.  If the file is
+ * UTF-16 or UTF-32, transcode it into UTF-8 at once, returning the new buffer
+ * via "decoded", so that decode_charset() need not be called for each line.
+ */
+int
+deduce_charset_block(BUFFER *bp, UCHAR * buffer, B_COUNT * length, UCHAR ** decoded)
+{
+    const BOM_TABLE *mp;
+    int rc;
+
+    TRACE((T_CALLED "deduce_charset_block(%s) length %ld\n",
+	   bp->b_bname, *length));
+    *decoded = NULL;
+    rc = deduce_encoding(bp, buffer, *length, TRUE);
+    if ((b_val(bp, VAL_FILE_ENCODING) == enc_UTF16
+	 || b_val(bp, VAL_FILE_ENCODING) == enc_UTF32)
+	&& (mp = find_mark_info2(bp)) != NULL
+	&& mp->size > 1) {
+	*decoded = transcode_to_utf8(inferred_bom(bp, mp), buffer, length);
+    }
+    if (*decoded == NULL)
+	remove_crlf_nulls(bp, buffer, length);
+    returnCode(rc);
+}
+
 /*
  * Check if the given buffer should be treated as UTF-8.
  * For UTF-8, we have to have _some_ UTF-8 encoding, and _all_
@@ -925,13 +1223,13 @@ check_utf8(UCHAR * buffer, B_COUNT length)
     int check = TRUE;
     int skip = 0;
     int found;
-    UINT target;
 
     for (n = 0, found = 0; n < length - 1; n += (B_COUNT) skip) {
-	skip = vl_conv_to_utf32(&target,
-				(char *) (buffer + n),
-				length - n);
-	if (skip == 0) {
+	n += (B_COUNT) ascii_span(buffer + n, (size_t) (length - 1 - n));
+	if (n >= length - 1)
+	    break;
+	skip = vl_check_utf8((char *) (buffer + n), length - n);
+	if (skip == 0 || (B_COUNT) skip > length - n) {
 	    check = FALSE;
 	    break;
 	} else if (skip > 1) {
@@ -1042,3 +1340,345 @@ encoding2s(int code)
 {
     return choice_to_name(&fsm_file_encoding_blist, code);
 }
+
+#ifdef DEBUG_CHARSETS
+/*
+ * Test-driver:  time the block validator and transcoders against the
+ * character-at-a-time functions, for each UTF-8 file given as a parameter,
+ * or for generated ASCII, mostly-ASCII and CJK samples if none are given.
+ */
+#include <time.h>
+
+/* ARGSUSED */
+void
+rebuild_charclasses(int print_lo, int print_hi)
+{
+}
+
+/* ARGSUSED */
+int
+ffputline(const char *buf, int nbuf, const char *ending)
+{
+    return FIOSUC;
+}
+
+/* ARGSUSED */
+char *
+ltextalloc(BUFFER *bp, size_t *sizep)
+{
+    return NULL;
+}
+
+/* ARGSUSED */
+void
+ltextfree(LINE *lp, BUFFER *bp)
+{
+}
+
+/* ARGSUSED */
+const char *
+choice_to_name(FSM_BLIST * data, int code)
+{
+    return "?";
+}
+
+/* ARGSUSED */
+void
+set_bufflags(int glob_vals, unsigned flags)
+{
+}
+
+#define REPEAT 10
+
+static double
+elapsed(clock_t start)
+{
+    return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+static void
+report(const char *what, double slow, double fast, int same)
+{
+    printf("  %-20s %8.4fs vs %8.4fs (%5.1fx)%s\n",
+	   what, slow, fast,
+	   fast > 0.0 ? slow / fast : 0.0,
+	   same ? "" : " MISMATCH");
+}
+
+static UCHAR *
+make_sample(const char *kind, B_COUNT * length)
+{
+    B_COUNT limit = 8000000;
+    B_COUNT used = 0;
+    UCHAR *result = typeallocn(UCHAR, limit + 8);
+    unsigned long seed = 1;
+
+    while (result != NULL && used < limit) {
+	UINT code;
+
+	seed = seed * 1103515245UL + 12345UL;
+	if ((used % 64) == 63) {
+	    code = '\n';
+	} else if (!strcmp(kind, "ascii")) {
+	    code = (UINT) (' ' + ((seed >> 16) % 95));
+	} else if (!strcmp(kind, "mostly-ascii")) {
+	    code = (UINT) (((seed >> 16) % 20)
+			   ? (' ' + ((seed >> 8) % 95))
+			   : (0xa0 + ((seed >> 8) % 0x1b0)));
+	} else {
+	    code = (UINT) (0x4e00 + ((seed >> 8) % 0x5200));
+	}
+	used += (B_COUNT) vl_conv_to_utf8(result + used, code, (B_COUNT) 6);
+    }
+    if (result != NULL)
+	result[used] = '\0';
+    *length = used;
+    return result;
+}
+
+static UCHAR *
+load_sample(const char *name, B_COUNT * length)
+{
+    UCHAR *result = NULL;
+    FILE *fp;
+    size_t have = 0;
+    size_t got;
+
+    if ((fp = fopen(name, "rb")) != NULL) {
+	size_t need = BUFSIZ;
+	result = typeallocn(UCHAR, need + 1);
+	while (result != NULL
+	       && (got = fread(result + have, sizeof(UCHAR), need - have, fp)) != 0) {
+	    have += got;
+	    if (have == need) {
+		need *= 2;
+		result = typereallocn(UCHAR, result, need + 1);
+	    }
+	}
+	fclose(fp);
+    }
+    *length = (B_COUNT) have;
+    return result;
+}
+
+/*
+ * The character-at-a-time check which check_utf8() used.
+ */
+static int
+slow_check_utf8(UCHAR * buffer, B_COUNT length)
+{
+    B_COUNT n;
+    int skip = 0;
+    int found = 0;
+    UINT target;
+
+    for (n = 0; n < length - 1; n += (B_COUNT) skip) {
+	skip = vl_conv_to_utf32(&target, (char *) (buffer + n), length - n);
+	if (skip == 0)
+	    return FALSE;
+	else if (skip > 1)
+	    found = 1;
+    }
+    return found ? TRUE : SORTOFTRUE;
+}
+
+/*
+ * Encode the sample as UTF-16 or UTF-32, substituting for codes that UTF-16
+ * cannot represent in a single unit.
+ */
+static UCHAR *
+encode_sample(const BOM_TABLE * mp, UCHAR * buffer, B_COUNT length, B_COUNT * result_len)
+{
+    UCHAR *result = typeallocn(UCHAR, (length + 1) * mp->size);
+    B_COUNT j = 0;
+    B_COUNT k = 0;
+
+    while (result != NULL && j < length) {
+	UINT code;
+	size_t n;
+	int skip = vl_conv_to_utf32(&code, (char *) (buffer + j), length - j);
+
+	if (skip == 0) {
+	    skip = 1;
+	    code = buffer[j];
+	}
+	j += (B_COUNT) skip;
+	if (mp->size == 2 && code > 0xffff)
+	    code = 0xfffd;
+	for (n = 0; n < mp->size; ++n) {
+	    size_t shift = (mp->code == bom_UTF16BE || mp->code == bom_UTF32BE)
+	    ? (mp->size - 1 - n)
+	    : n;
+	    result[k++] = (UCHAR) (code >> (8 * shift));
+	}
+    }
+    *result_len = k;
+    return result;
+}
+
+/*
+ * The unit-at-a-time conversion which load_as_utf8() does.
+ */
+static UCHAR *
+slow_transcode(const BOM_TABLE * mp, UCHAR * buffer, B_COUNT length, B_COUNT * result_len)
+{
+    size_t units = (size_t) (length / mp->size);
+    UINT *codes = typeallocn(UINT, units + 1);
+    UCHAR *result = NULL;
+    size_t j;
+    B_COUNT k = 0;
+    int big = (mp->code == bom_UTF16BE || mp->code == bom_UTF32BE);
+
+    if (codes != NULL) {
+	for (j = 0; j < units; ++j) {
+	    UCHAR *p = buffer + (j * mp->size);
+	    if (mp->size == 2) {
+		codes[j] = big ? (UINT) ((p[0] << 8) | p[1]) : (UINT) ((p[1] << 8) | p[0]);
+	    } else {
+		codes[j] = (big
+			    ? (((UINT) p[0] << 24) | ((UINT) p[1] << 16) | ((UINT) p[2] << 8) | p[3])
+			    : (((UINT) p[3] << 24) | ((UINT) p[2] << 16) | ((UINT) p[1] << 8) | p[0]));
+	    }
+	}
+	for (j = 0, k = 0; j < units; ++j)
+	    k += (B_COUNT) vl_conv_to_utf8(NULL, codes[j], (B_COUNT) 6);
+	if ((result = typeallocn(UCHAR, k + 1)) != NULL) {
+	    for (j = 0, k = 0; j < units; ++j)
+		k += (B_COUNT) vl_conv_to_utf8(result + k, codes[j], (B_COUNT) 6);
+	    result[k] = '\0';
+	}
+	free(codes);
+    }
+    *result_len = k;
+    return result;
+}
+
+static B_COUNT
+slow_riddled(const BOM_TABLE * mp, UCHAR * buffer, B_COUNT length)
+{
+    B_COUNT total = 0;
+    size_t j, k;
+
+    for (j = 0; j + mp->size <= length; j += mp->size) {
+	int found = 1;
+	for (k = 0; k < mp->size; ++k) {
+	    if (!buffer[j + k] ^ !IsNonNull(mp->mark[k])) {
+		found = 0;
+		break;
+	    }
+	}
+	if (found)
+	    total += (B_COUNT) mp->size;
+    }
+    return total;
+}
+
+static void
+test_sample(const char *name, UCHAR * buffer, B_COUNT length)
+{
+    static const char *names[] =
+    {
+	"none", "utf-8", "utf-32le", "utf-32be", "utf-16le", "utf-16be"
+    };
+    clock_t start;
+    double slow, fast;
+    int n;
+    int slow_rc = 0;
+    int fast_rc = 0;
+    unsigned m;
+
+    printf("%s: %lu bytes\n", name, (unsigned long) length);
+
+    start = clock();
+    for (n = 0; n < REPEAT; ++n)
+	slow_rc = slow_check_utf8(buffer, length);
+    slow = elapsed(start);
+    start = clock();
+    for (n = 0; n < REPEAT; ++n)
+	fast_rc = check_utf8(buffer, length);
+    fast = elapsed(start);
+    report("check_utf8", slow, fast, slow_rc == fast_rc);
+
+    for (m = 2; m < TABLESIZE(bom_table); ++m) {
+	const BOM_TABLE *mp = bom_table + m;
+	B_COUNT encoded_len;
+	UCHAR *encoded = encode_sample(mp, buffer, length, &encoded_len);
+	UCHAR *slow_out = NULL;
+	UCHAR *fast_out = NULL;
+	B_COUNT slow_len = 0;
+	B_COUNT fast_len = 0;
+	B_COUNT slow_total = 0;
+	B_COUNT fast_total = 0;
+	char what[80];
+
+	if (encoded == NULL)
+	    continue;
+
+	start = clock();
+	for (n = 0; n < REPEAT; ++n)
+	    slow_total = slow_riddled(mp, encoded, encoded_len);
+	slow = elapsed(start);
+	start = clock();
+	for (n = 0; n < REPEAT; ++n)
+	    fast_total = count_riddled(mp->mark, mp->size, encoded, (size_t) encoded_len);
+	fast = elapsed(start);
+	sprintf(what, "riddled %s", names[m]);
+	report(what, slow, fast, slow_total == fast_total);
+
+	start = clock();
+	for (n = 0; n < REPEAT; ++n) {
+	    FreeIfNeeded(slow_out);
+	    slow_out = slow_transcode(mp, encoded, encoded_len, &slow_len);
+	}
+	slow = elapsed(start);
+	start = clock();
+	for (n = 0; n < REPEAT; ++n) {
+	    FreeIfNeeded(fast_out);
+	    fast_len = encoded_len;
+	    fast_out = transcode_to_utf8(mp->code, encoded, &fast_len);
+	}
+	fast = elapsed(start);
+	sprintf(what, "transcode %s", names[m]);
+	report(what, slow, fast,
+	       (slow_out != NULL
+		&& fast_out != NULL
+		&& slow_len == fast_len
+		&& !memcmp(slow_out, fast_out, (size_t) slow_len)));
+
+	FreeIfNeeded(slow_out);
+	FreeIfNeeded(fast_out);
+	free(encoded);
+    }
+}
+
+int
+main(int argc, char *argv[])
+{
+    static const char *samples[] =
+    {
+	"ascii", "mostly-ascii", "cjk"
+    };
+    UCHAR *buffer;
+    B_COUNT length;
+    int n;
+
+    if (argc > 1) {
+	for (n = 1; n < argc; ++n) {
+	    if ((buffer = load_sample(argv[n], &length)) != NULL) {
+		test_sample(argv[n], buffer, length);
+		free(buffer);
+	    } else {
+		perror(argv[n]);
+	    }
+	}
+    } else {
+	for (n = 0; n < (int) TABLESIZE(samples); ++n) {
+	    if ((buffer = make_sample(samples[n], &length)) != NULL) {
+		test_sample(samples[n], buffer, length);
+		free(buffer);
+	    }
+	}
+    }
+    return EXIT_SUCCESS;
+}
+#endif /* DEBUG_CHARSETS */
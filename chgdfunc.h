@@ -23,6 +23,7 @@ extern int chgd_window   (CHGD_ARGS);
 extern int chgd_working  (CHGD_ARGS);
 extern int chgd_xterm    (CHGD_ARGS);
 extern int chgd_xtermkeys(CHGD_ARGS);
+extern int chgd_xtermpaste(CHGD_ARGS);
 
 #if OPT_COLOR
 extern int chgd_color    (CHGD_ARGS);
@@ -40,6 +40,23 @@
 #define set_term_attrs(a)  term.rev(a)
 #endif
 
+/*
+ * A blank looks the same in any foreground color or weight, unless it is
+ * also underlined or reversed.  That lets update_line() continue a run of
+ * attributes across such blanks rather than changing attributes for them.
+ */
+#define BLANK_ATTRS (VACOLOR|VASPCOL|VABOLD)
+#ifdef GVAL_VIDEO
+#define PLAIN_BLANKS (((VIDEO_ATTR) global_g_val(GVAL_VIDEO) & (VAREV|VAUL)) == 0)
+#else
+#define PLAIN_BLANKS TRUE
+#endif
+#define SAME_BLANK(plain, attr, ch, cell) \
+	((plain) \
+	 && (ch) == ' ' \
+	 && ((attr) & ~BLANK_ATTRS) == 0 \
+	 && (VATTRIB(cell) & ~BLANK_ATTRS) == 0)
+
 #ifdef WMDLINEWRAP		/* overrides left/right scrolling */
 #define if_LINEWRAP(wp, t, f) w_val(wp, WMDLINEWRAP) ? (t) : (f)
 #else
@@ -71,6 +88,11 @@ static LMAP *lmap;		/* workspace for computing attributes */
 #define CAN_SCROLL 0
 #endif
 
+#if CAN_SCROLL
+static ULONG *vhash;		/* per-row hash of virtual screen text */
+static ULONG *phash;		/* per-row hash of physical screen text */
+#endif
+
 static int i_displayed;		/* false until we're in screen-mode */
 static int mpresf;		/* zero if message-line empty */
 #if OPT_WORKING
@@ -474,6 +496,10 @@ vtalloc(void)
 	GROW(pscreen, VIDEO *, vrows, term.maxrows);
 	GROW(lmap0, LMAP, vrows, ((size_t) term.maxrows + 1));
 	GROW(lmap, LMAP, vrows, ((size_t) term.maxrows + 1));
+#if CAN_SCROLL
+	GROW(vhash, ULONG, vrows, term.maxrows);
+	GROW(phash, ULONG, vrows, term.maxrows);
+#endif
     } else {
 	for (i = term.maxrows; i < vrows; i++) {
 	    freeVIDEO(vscreen[i]);
@@ -518,6 +544,10 @@ vtfree(void)
     }
     FreeIfNeeded(lmap0);
     FreeIfNeeded(lmap);
+#if CAN_SCROLL
+    FreeIfNeeded(vhash);
+    FreeIfNeeded(phash);
+#endif
 }
 #endif
 
@@ -1526,6 +1556,7 @@ update_line(int row, int colfrom, int colto)
     VIDEO_ATTR *ap1 = VideoAttr(vp1);
     VIDEO_ATTR *ap2 = VideoAttr(vp2);
     VIDEO_ATTR Blank = 0;	/* FIXME: Color? */
+    int plain;			/* blanks do not show color/bold */
 #else
     UINT rev;			/* reverse video flag */
     UINT req;			/* reverse video request flag */
@@ -1652,10 +1683,13 @@ update_line(int row, int colfrom, int colto)
 
     movecursor(row, xl - colfrom);	/* Go to start of line. */
 #if OPT_VIDEO_ATTRS
+    plain = PLAIN_BLANKS;
     while (xl < xx) {
 	int j = xl;
 	VIDEO_ATTR attr = VATTRIB(ap1[j]);
-	while ((j < xx) && (attr == VATTRIB(ap1[j])))
+	while ((j < xx)
+	       && (attr == VATTRIB(ap1[j])
+		   || SAME_BLANK(plain, attr, cp1[j], ap1[j])))
 	    j++;
 	set_term_attrs(attr);
 	for (; xl < j; xl++) {
@@ -2405,17 +2439,52 @@ update_line_attrs(WINDOW *wp)
 }
 #endif /* OPT_LINE_ATTRS */
 
+/*
+ * Garbage collect empty visible regions
+ */
+static void
+purge_empty_attribs(BUFFER *bp)
+{
+    AREGION **rpp = &(bp->b_attribs);
+    AREGION *ap;
+
+    while ((ap = *rpp) != NULL) {
+	if (ap->ar_region.r_orig.l == ap->ar_region.r_end.l
+	    && VATTRIB(ap->ar_vattr) != 0
+	    && ap->ar_region.r_orig.o >= ap->ar_region.r_end.o) {
+	    free_attrib2(bp, rpp);
+	} else {
+	    rpp = &(ap->ar_next);
+	}
+    }
+}
+
+/*
+ * Return the line-number of the given line relative to the top of the window,
+ * computing the latter only when needed.
+ */
+static L_NUM
+window_lnum(WINDOW *wp, LINE *lp, L_NUM * top)
+{
+    if (*top < 0)
+	*top = line_no(wp->w_bufp, wp->w_line.l);
+    return line_no(wp->w_bufp, lp) - *top;
+}
+
 static void
 update_window_attrs(WINDOW *wp)
 {
     BUFFER *bp = wp->w_bufp;
-    AREGION **rpp;
     AREGION *ap;
     int i, lmax;
 
     L_NUM start_wlnum, end_wlnum;
+    L_NUM top_wlnum = -1;
+    int n;
     LINE *lp;
+    LINE *key;
     int rows;
+    int empty = 0;
     C_NUM col;
 #if OPT_TRACE
     int total_regions = 0;
@@ -2445,13 +2514,13 @@ update_window_attrs(WINDOW *wp)
 	return;
 
     /*
-     * Compute starting and ending line numbers for the window.  We
-     * also fill in lmap which is used for mapping line numbers to
-     * screen row numbers.
+     * Compute starting and ending line numbers for the window, counting
+     * from its top line.  We also fill in lmap which is used for mapping
+     * line numbers to screen row numbers.
      */
     lp = wp->w_line.l;
     start_wlnum =
-	end_wlnum = line_no(bp, lp);
+	end_wlnum = 0;
     rows = wp->w_ntrows;
 
     lmax = end_wlnum - start_wlnum;
@@ -2477,149 +2546,174 @@ update_window_attrs(WINDOW *wp)
 
     /*
      * Set current attributes in virtual screen associated with window
-     * pointer.
+     * pointer.  Look for regions starting on each line of the window and
+     * the line above it, then for those which span more lines.
      */
-    rpp = &(bp->b_attribs);
-    while ((ap = *rpp) != NULL) {
-	AREGION **next = &(ap->ar_next);
-	VIDEO_ATTR attr;
-	C_NUM start_col, end_col;
-	C_NUM rect_start_col = 0, rect_end_col = 0;
-	L_NUM start_rlnum, end_rlnum, lnum, start_lnum, end_lnum;
-	int visible = TRUE;
-
-	start_rlnum = line_no(bp, ap->ar_region.r_orig.l);
-	end_rlnum = line_no(bp, ap->ar_region.r_end.l);
-
-	/* Garbage collect empty visible regions */
-	if (start_rlnum == end_rlnum
-	    && VATTRIB(ap->ar_vattr) != 0
-	    && ap->ar_region.r_orig.o >= ap->ar_region.r_end.o) {
-	    free_attrib2(bp, rpp);
-	    continue;
-	}
-
-	/* compute starting and ending line-numbers, given the region's */
-	if (start_rlnum > start_wlnum) {
-	    start_lnum = start_rlnum;
-	    lp = ap->ar_region.r_orig.l;
+    for (n = -1; n <= lmax; ++n) {
+	if (n == lmax) {
+	    key = NULL;
+	    ap = bp->b_attrspans;
 	} else {
-	    start_lnum = start_wlnum;
-	    lp = wp->w_line.l;
+	    key = (n < 0) ? lback(wp->w_line.l) : lmap[n].lp;
+	    if (key == buf_head(bp)) {
+		if (n >= 0)
+		    n = lmax - 1;	/* past the end of the buffer */
+		continue;
+	    }
+	    ap = line_attribs(bp, key);
 	}
-	end_lnum = (end_rlnum < end_wlnum) ? end_rlnum : end_wlnum;
+	for (; ap != NULL; ap = ap->ar_index) {
+	    VIDEO_ATTR attr;
+	    C_NUM start_col, end_col;
+	    C_NUM rect_start_col = 0, rect_end_col = 0;
+	    L_NUM start_rlnum, end_rlnum, lnum, start_lnum, end_lnum;
+	    int visible = TRUE;
+
+	    if (key == NULL) {
+		start_rlnum = window_lnum(wp, ap->ar_region.r_orig.l, &top_wlnum);
+		end_rlnum = window_lnum(wp, ap->ar_region.r_end.l, &top_wlnum);
+	    } else if (ap->ar_key != key) {
+		continue;	/* another line in the same bucket */
+	    } else {
+		start_rlnum = n;
+		if (ap->ar_region.r_end.l == key)
+		    end_rlnum = n;
+		else if (ap->ar_region.r_end.l == lforw(key))
+		    end_rlnum = n + 1;
+		else		/* e.g., undo restored a line within it */
+		    end_rlnum = window_lnum(wp, ap->ar_region.r_end.l, &top_wlnum);
+	    }
 
-	/*
-	 * Filter out attribute regions that will not be on the screen.
-	 * Most of the regions generated by syntax filters start/end on
-	 * the same line, which allows us to make a simple/fast check.
-	 */
-	if (start_rlnum == end_rlnum) {
-	    i = (start_rlnum - start_wlnum);
+	    if (start_rlnum == end_rlnum
+		&& VATTRIB(ap->ar_vattr) != 0
+		&& ap->ar_region.r_orig.o >= ap->ar_region.r_end.o) {
+		++empty;
+		continue;
+	    }
+
+	    /* compute starting and ending line-numbers, given the region's */
+	    if (start_rlnum > start_wlnum) {
+		start_lnum = start_rlnum;
+		lp = ap->ar_region.r_orig.l;
+	    } else {
+		start_lnum = start_wlnum;
+		lp = wp->w_line.l;
+	    }
+	    end_lnum = (end_rlnum < end_wlnum) ? end_rlnum : end_wlnum;
 
 	    /*
-	     * Skip lines which don't fall into the vertical range.
+	     * Filter out attribute regions that will not be on the screen.
+	     * Most of the regions generated by syntax filters start/end on
+	     * the same line, which allows us to make a simple/fast check.
 	     */
-	    if (i < 0 || i >= lmax) {
-		visible = FALSE;
-	    } else {
+	    if (start_rlnum == end_rlnum) {
+		i = (start_rlnum - start_wlnum);
 
 		/*
-		 * Compute the left/right offsets for the visible part of the
-		 * line the first time we need to compare it.
+		 * Skip lines which don't fall into the vertical range.
 		 */
-		if (lmap[i].left < 0 && lmap[i].right < 0) {
+		if (i < 0 || i >= lmax) {
+		    visible = FALSE;
+		} else {
+
+		    /*
+		     * Compute the left/right offsets for the visible part of the
+		     * line the first time we need to compare it.
+		     */
+		    if (lmap[i].left < 0 && lmap[i].right < 0) {
 #ifdef WMDLINEWRAP
-		    if (w_val(wp, WMDLINEWRAP)) {
-			int lines_remaining = (lmap[i + 1].map - lmap[i].map);
+			if (w_val(wp, WMDLINEWRAP)) {
+			    int lines_remaining = (lmap[i + 1].map - lmap[i].map);
 
-			col = -((wp->w_line.o * term.cols) + nu_width(wp));
-			lmap[i].left = col2offs(wp, lmap[i].lp, col);
+			    col = -((wp->w_line.o * term.cols) + nu_width(wp));
+			    lmap[i].left = col2offs(wp, lmap[i].lp, col);
 
-			col += (lines_remaining * term.cols);
-			lmap[i].right = col2offs(wp, lmap[i].lp, col);
-		    } else
+			    col += (lines_remaining * term.cols);
+			    lmap[i].right = col2offs(wp, lmap[i].lp, col);
+			} else
 #endif
-		    {
-			col = -((wp->w_line.o * term.cols) + nu_width(wp));
-			lmap[i].left = col2offs(wp, lmap[i].lp, col);
+			{
+			    col = -((wp->w_line.o * term.cols) + nu_width(wp));
+			    lmap[i].left = col2offs(wp, lmap[i].lp, col);
 
-			col += term.cols;
-			lmap[i].right = col2offs(wp, lmap[i].lp, col);
+			    col += term.cols;
+			    lmap[i].right = col2offs(wp, lmap[i].lp, col);
+			}
+			TRACE2(("...update_window_attrs row %d [%d..%d] (%d)\n",
+				lmap[i].map,
+				lmap[i].left,
+				lmap[i].right,
+				lmap[i].right - lmap[i].left));
 		    }
-		    TRACE2(("...update_window_attrs row %d [%d..%d] (%d)\n",
-			    lmap[i].map,
-			    lmap[i].left,
-			    lmap[i].right,
-			    lmap[i].right - lmap[i].left));
-		}
 
-		if (ap->ar_region.r_orig.o >= lmap[i].right) {
-		    visible = FALSE;
-		} else if (ap->ar_region.r_end.o < lmap[i].left) {
-		    visible = FALSE;
+		    if (ap->ar_region.r_orig.o >= lmap[i].right) {
+			visible = FALSE;
+		    } else if (ap->ar_region.r_end.o < lmap[i].left) {
+			visible = FALSE;
+		    }
 		}
 	    }
-	}
 #if OPT_TRACE
-	total_regions++;
+	    total_regions++;
 #endif
-	if (visible) {
+	    if (visible) {
 #if OPT_TRACE
-	    visible_regions++;
+		visible_regions++;
 #endif
 
-	    attr = ap->ar_vattr;
+		attr = ap->ar_vattr;
 
-	    /* if it's a rectangle, precompute the start/end columns */
-	    if (ap->ar_shape == rgn_RECTANGLE) {
-		int n;
-		rect_start_col = mark2col(wp, ap->ar_region.r_orig);
-		rect_end_col = mark2col(wp, ap->ar_region.r_end);
-		if (rect_end_col < rect_start_col) {
-		    col = rect_end_col;
-		    rect_end_col = rect_start_col;
-		    rect_start_col = col;
-		    n = MARK2COL(wp, ap->ar_region.r_orig);
-		} else {
-		    n = MARK2COL(wp, ap->ar_region.r_end);
-		}
-		if (rect_end_col < n)
-		    rect_end_col = n;
-	    }
-	    for (lnum = start_lnum; lnum <= end_lnum; lnum++, lp = lforw(lp)) {
-		int row;
+		/* if it's a rectangle, precompute the start/end columns */
 		if (ap->ar_shape == rgn_RECTANGLE) {
-		    start_col = rect_start_col;
-		} else if (lnum == start_rlnum) {
-		    start_col = mark2col(wp, ap->ar_region.r_orig);
-		} else {
-		    start_col = w_left_margin(wp) + nu_width(wp);
+		    int n;
+		    rect_start_col = mark2col(wp, ap->ar_region.r_orig);
+		    rect_end_col = mark2col(wp, ap->ar_region.r_end);
+		    if (rect_end_col < rect_start_col) {
+			col = rect_end_col;
+			rect_end_col = rect_start_col;
+			rect_start_col = col;
+			n = MARK2COL(wp, ap->ar_region.r_orig);
+		    } else {
+			n = MARK2COL(wp, ap->ar_region.r_end);
+		    }
+		    if (rect_end_col < n)
+			rect_end_col = n;
 		}
+		for (lnum = start_lnum; lnum <= end_lnum; lnum++, lp = lforw(lp)) {
+		    int row;
+		    if (ap->ar_shape == rgn_RECTANGLE) {
+			start_col = rect_start_col;
+		    } else if (lnum == start_rlnum) {
+			start_col = mark2col(wp, ap->ar_region.r_orig);
+		    } else {
+			start_col = w_left_margin(wp) + nu_width(wp);
+		    }
 
-		if (start_col < w_left_margin(wp))
-		    start_col = (lnum == start_rlnum)
-			? w_left_margin(wp) + nu_width(wp)
-			: w_left_margin(wp);
+		    if (start_col < w_left_margin(wp))
+			start_col = (lnum == start_rlnum)
+			    ? w_left_margin(wp) + nu_width(wp)
+			    : w_left_margin(wp);
 
-		if (ap->ar_shape == rgn_RECTANGLE) {
-		    end_col = rect_end_col;
-		} else if (lnum == end_rlnum) {
-		    end_col = mark2col(wp, ap->ar_region.r_end) - 1;
-		} else {
-		    end_col = offs2col(wp, lp, llength(lp) + 1) - 1;
+		    if (ap->ar_shape == rgn_RECTANGLE) {
+			end_col = rect_end_col;
+		    } else if (lnum == end_rlnum) {
+			end_col = mark2col(wp, ap->ar_region.r_end) - 1;
+		    } else {
+			end_col = offs2col(wp, lp, llength(lp) + 1) - 1;
 #ifdef WMDLINEWRAP
-		    if (w_val(wp, WMDLINEWRAP)
-			&& (end_col % term.cols) == 0)
-			end_col--;	/* cannot highlight the newline */
+			if (w_val(wp, WMDLINEWRAP)
+			    && (end_col % term.cols) == 0)
+			    end_col--;      /* cannot highlight the newline */
 #endif
+		    }
+		    row = lmap[lnum - start_wlnum].map;
+		    mergeattr(wp, row, start_col, end_col, attr);
 		}
-		row = lmap[lnum - start_wlnum].map;
-		mergeattr(wp, row, start_col, end_col, attr);
 	    }
 	}
-	rpp = next;
     }
+    if (empty)
+	purge_empty_attribs(bp);
     TRACE2(("update_window_attrs visible %d / %d\n",
 	    visible_regions,
 	    total_regions));
@@ -2854,6 +2948,30 @@ same_video_text(const VIDEO_TEXT * virtual_text, const VIDEO_TEXT *
     return rc;
 }
 
+static ULONG
+hash_video_text(const VIDEO_TEXT * text, int ncols)
+{
+    ULONG result = 0;
+    int j;
+
+    for (j = 0; j < ncols; ++j)
+	result = (result * 31) + (ULONG) text[j];
+    return result;
+}
+
+/*
+ * Compute the row-hashes used by same_row_text(), so that most comparisons
+ * of rows are just a comparison of two numbers.
+ */
+static void
+hash_screen_rows(VIDEO ** screen, ULONG * hashes, int rows)
+{
+    int i;
+
+    for (i = 0; i < rows; ++i)
+	hashes[i] = hash_video_text(screen[i]->v_text, term.cols);
+}
+
 /*
  * return TRUE on text match
  *
@@ -2863,7 +2981,8 @@ same_video_text(const VIDEO_TEXT * virtual_text, const VIDEO_TEXT *
 static int
 same_row_text(int vrow, int prow)
 {
-    return same_video_text(vscreen[vrow]->v_text,
+    return (vhash[vrow] == phash[prow])
+	&& same_video_text(vscreen[vrow]->v_text,
 			   pscreen[prow]->v_text,
 			   term.cols);
 }
@@ -2887,6 +3006,7 @@ scroll_screen(int from, int to, int count)
 {
     beginDisplay();
     ttrow = ttcol = -1;
+    count_screen_stat(scrolls);
     term.scroll(from, to, count);
     endofDisplay();
 }
@@ -2897,9 +3017,11 @@ scroll_screen(int from, int to, int count)
  * version of MicroEMACS.  used by permission.
  *
  * inserts - returns true if it does an optimization
+ * startp - the row at which to begin looking for a mismatch, updated to the
+ *	row just past the mismatch which was considered.
  */
 static int
-simple_scroll(int inserts)
+simple_scroll(int inserts, int *startp)
 {
     struct VIDEO *vpv;		/* virtual screen image */
     struct VIDEO *vpp;		/* physical screen image */
@@ -2920,14 +3042,17 @@ simple_scroll(int inserts)
 
     /* find first line that doesn't match */
     first = -1;
-    for (i = 0; i < rows; i++) {
+    for (i = *startp; i < rows; i++) {
 	if (!same_row_text(i, i)) {
 	    first = i;
 	    break;
 	}
     }
-    if (first < 0)
+    if (first < 0) {
+	*startp = rows;
 	return FALSE;		/* there isn't one */
+    }
+    *startp = first + 1;
 
     vpv = vscreen[first];
     vpp = pscreen[first];
@@ -3076,6 +3201,28 @@ simple_scroll(int inserts)
     return (FALSE);
 }
 
+/*
+ * Look for each block of rows which can be scrolled into place, rather than
+ * only the first.  Rows above the mismatch which simple_scroll() considers
+ * are not altered by it, so we can resume the search just past that row.
+ */
+static void
+scroll_blocks(int inserts)
+{
+    int rows = term.rows - 1;
+    int start = 0;
+
+    if (term.scroll == nullterm_scroll)		/* can't scroll */
+	return;
+
+    hash_screen_rows(vscreen, vhash, rows);
+    hash_screen_rows(pscreen, phash, rows);
+    while (start < rows) {
+	if (simple_scroll(inserts, &start))
+	    hash_screen_rows(pscreen, phash, rows);
+    }
+}
+
 #endif /* CAN_SCROLL */
 
 /*
@@ -3090,9 +3237,9 @@ update_physical_screen(int force GCC_UNUSED)
     TRACE((T_CALLED "update_physical_screen(%d)\n", force));
 #if CAN_SCROLL
     if (scrflags & WFKILLS)
-	(void) simple_scroll(FALSE);
+	scroll_blocks(FALSE);
     if (scrflags & WFINS)
-	(void) simple_scroll(TRUE);
+	scroll_blocks(TRUE);
     scrflags = 0;
 #endif
 
@@ -3103,6 +3250,7 @@ update_physical_screen(int force GCC_UNUSED)
 	    if (TypeAhead(force))
 		returnVoid();
 #endif
+	    count_screen_stat(rows);
 	    update_line(i, 0, term.cols);
 	}
     }
@@ -4151,6 +4299,79 @@ de_extend_lines(void)
     }
 }
 
+#if OPT_SHOW_SCREEN
+static SCREEN_STATS last_update;	/* counters for the latest update */
+static VL_ELAPSED update_began;
+
+static void
+begin_screen_stats(void)
+{
+    last_update = screen_stats;
+    (void) vl_elapsed(&update_began, TRUE);
+}
+
+static void
+end_screen_stats(void)
+{
+    screen_stats.updates++;
+    screen_stats.msecs += vl_elapsed(&update_began, FALSE);
+
+    last_update.updates = screen_stats.updates - last_update.updates;
+    last_update.bytes = screen_stats.bytes - last_update.bytes;
+    last_update.moves = screen_stats.moves - last_update.moves;
+    last_update.attrs = screen_stats.attrs - last_update.attrs;
+    last_update.scrolls = screen_stats.scrolls - last_update.scrolls;
+    last_update.rows = screen_stats.rows - last_update.rows;
+    last_update.msecs = screen_stats.msecs - last_update.msecs;
+}
+
+static void
+show_stats_line(const char *name, ULONG total, ULONG latest)
+{
+    bprintf("\n%20s%14lu%lu", name, total, latest);
+}
+
+/*ARGSUSED*/
+static void
+make_screen_stats(int iarg GCC_UNUSED, void *dummy GCC_UNUSED)
+{
+    ULONG updates = screen_stats.updates;
+
+    bprintf("Output to the terminal by screen updates\n");
+    bprintf("\n%20s%14s%s", "", "total", "latest");
+    bprintf("\n%20s%14s%s", "", "------------", "------------");
+    show_stats_line("updates", updates, last_update.updates);
+    show_stats_line("bytes", screen_stats.bytes, last_update.bytes);
+    show_stats_line("cursor moves", screen_stats.moves, last_update.moves);
+    show_stats_line("attribute changes", screen_stats.attrs, last_update.attrs);
+    show_stats_line("scrolls", screen_stats.scrolls, last_update.scrolls);
+    show_stats_line("rows repainted", screen_stats.rows, last_update.rows);
+    bprintf("\n%20s%14f%f", "milliseconds", screen_stats.msecs, last_update.msecs);
+    if (updates != 0) {
+	bprintf("\n\n%20s%14f", "bytes per update",
+		(double) screen_stats.bytes / (double) updates);
+	bprintf("\n%20s%14f", "msecs per update",
+		screen_stats.msecs / (double) updates);
+    }
+}
+
+/*
+ * Show the counters for output to the terminal.  With an argument, reset the
+ * counters after showing them.
+ */
+int
+show_screen_stats(int f, int n GCC_UNUSED)
+{
+    int rc = liststuff(SCREEN_STATS_BufName, FALSE, make_screen_stats, 0, (void *) 0);
+
+    if (f) {
+	memset(&screen_stats, 0, sizeof(screen_stats));
+	memset(&last_update, 0, sizeof(last_update));
+    }
+    return rc;
+}
+#endif /* OPT_SHOW_SCREEN */
+
 /*
  * Make sure that the display is right. This is a three part process. First,
  * scan through all of the windows looking for dirty ones. Check the framing,
@@ -4330,6 +4551,10 @@ update(int force /* force update past type ahead? */ )
     if (sgarbf || need_update)
 	update_garbaged_screen();
 
+#if OPT_SHOW_SCREEN
+    begin_screen_stats();
+#endif
+
     /* update the virtual screen to the physical screen */
     update_physical_screen(force);
 
@@ -4352,6 +4577,9 @@ update(int force /* force update past type ahead? */ )
     }
 #endif
     term.flush();
+#if OPT_SHOW_SCREEN
+    end_screen_stats();
+#endif
     endofDisplay();
     i_displayed = TRUE;
 
@@ -4439,6 +4667,7 @@ movecursor(int row, int col)
 	&& (col >= 0 && col < term.cols)) {
 	ttrow = row;
 	ttcol = col;
+	count_screen_stat(moves);
 	term.curmove(row, col);
     }
     endofDisplay();
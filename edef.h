@@ -92,9 +92,13 @@ decl_init( int i_am_dead, 0 );		/* have we been burned? */
 decl_init( int autoindented , -1 );	/* how many chars (not cols) indented */
 decl_uninit( int isnamedcmd );		/* are we typing a command name */
 decl_uninit( int calledbefore );	/* called before during this command? */
+decl_uninit( UINT namebst_gen );	/* changes with the command-names */
 decl_uninit( CHARTYPE vl_chartypes_[N_chars + 1] );	/* character types */
 decl_uninit( char vl_uppercase[N_chars + 1] );
 decl_uninit( char vl_lowercase[N_chars + 1] );
+decl_uninit( UINT vl_ctype_gen );		/* changes with vl_chartypes_ */
+decl_uninit( ULONG regcache_hits );	/* compiled regexps reused... */
+decl_uninit( ULONG regcache_misses );	/* ...and those compiled anew */
 decl_uninit( int reading_msg_line );	/* flag set during msgline reading */
 decl_uninit( jmp_buf read_jmp_buf );	/* for setjmp/longjmp on SIGINT */
 #ifndef insertmode
@@ -217,12 +221,16 @@ decl_init( int vl_echo, TRUE );		/* echo user input 		*/
 decl_init( int qpasswd, FALSE );	/* querying for password	*/
 decl_init( int in_autocolor, FALSE );	/* Autocoloring			*/
 decl_init( int filter_only, FALSE );	/* command-line -F option	*/
+decl_init( int lazy_readin, FALSE );	/* readin may finish file later	*/
 
 decl_uninit( int vtrow );		/* Row location of SW cursor	*/
 decl_uninit( int vtcol );		/* Column location of SW cursor */
 decl_uninit( int vtcol0 );		/* Column location of first row */
 decl_init( int ttrow, VL_HUGE );	/* Row location of HW cursor	*/
 decl_init( int ttcol, VL_HUGE );	/* Column location of HW cursor */
+#if OPT_SHOW_SCREEN
+decl_uninit( SCREEN_STATS screen_stats ); /* totals for show-screen-stats */
+#endif
 decl_uninit( int horscroll );		/* line offset when displaying	*/
 decl_init( int ntildes, 100 );		/* number of tildes displayed at eob
 					  (expressed as percent of window) */
@@ -495,6 +503,12 @@ decl_init_const( char SYSMAP_BufName[],		"" );
 #if OPT_SHOW_MARKS
 decl_init_const( char MARKS_BufName[],		"[Named Marks]" );
 #endif
+#if OPT_SHOW_MEMORY
+decl_init_const( char MEMORY_BufName[],		"[Line Memory]" );
+#endif
+#if OPT_SHOW_SCREEN
+decl_init_const( char SCREEN_STATS_BufName[],	"[Screen Stats]" );
+#endif
 #if OPT_SHOW_WHICH
 decl_init_const( char WHICH_BufName[],		"[Which Files]" );
 #endif
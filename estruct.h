@@ -615,6 +615,20 @@ typedef unsigned short	mode_t;
 #define OPT_WORKING 0
 #endif
 
+/* reader-policy "lazy" reads the rest of a large file after showing it */
+#if !SMALLER && !SYS_VMS
+#define OPT_LAZY_READER 1
+#else
+#define OPT_LAZY_READER 0
+#endif
+
+/* check-modtime can use inotify to learn when files change, rather than stat */
+#if !SMALLER && defined(HAVE_INOTIFY_INIT1) && defined(HAVE_SYS_INOTIFY_H)
+#define OPT_FILE_WATCH 1
+#else
+#define OPT_FILE_WATCH 0
+#endif
+
 #define OPT_SCROLLBARS (XTOOLKIT | DISP_NTWIN)	/* scrollbars */
 
 #ifndef OPT_VMS_PATH
@@ -665,6 +679,7 @@ typedef unsigned short	mode_t;
 #define OPT_SHOW_WHICH	!SMALLER		/* which-source, etc. */
 #define OPT_TAGS_CMPL   (!SMALLER && OPT_TAGS)	/* name-completion for tags */
 #define OPT_TERMCHRS    !SMALLER		/* set/show-terminal */
+#define OPT_UNDOFILE    (!SMALLER && !SYS_VMS)	/* persistent undo-history */
 #define OPT_UPBUFF      !SMALLER		/* animated buffer-update */
 #define OPT_WIDE_CTYPES !SMALLER		/* extra char-types tests */
 #define OPT_WORDCOUNT   !SMALLER		/* "count-words" command" */
@@ -675,7 +690,9 @@ typedef unsigned short	mode_t;
 #define OPT_SHOW_EVAL   (!SMALLER && OPT_EVAL)	/* "show-variables" */
 #define OPT_SHOW_MAPS   !SMALLER		/* display mapping for ":map" */
 #define OPT_SHOW_MARKS  !SMALLER		/* "show-marks" */
+#define OPT_SHOW_MEMORY !SMALLER		/* "show-memory" */
 #define OPT_SHOW_REGS   !SMALLER		/* "show-registers" */
+#define OPT_SHOW_SCREEN !SMALLER		/* "show-screen-stats" */
 #define OPT_SHOW_TAGS   (!SMALLER && OPT_TAGS)	/* ":tags" displays tag-stack */
 
 /* selections and attributed regions */
@@ -1413,6 +1430,7 @@ typedef enum {
 	RP_QUICK
 	, RP_SLOW
 	, RP_BOTH
+	, RP_LAZY
 } READERPOLICY_CHOICES;
 
 #if CRLF_LINES
@@ -1492,6 +1510,7 @@ typedef UINT KBD_OPTIONS;	/* big enough to hold bits defined above */
 #define WATCHWRITE  iBIT(1)
 #define WATCHEXCEPT iBIT(2)
 typedef UINT WATCHTYPE;
+typedef void (*WatchFunc) (int fd);
 
 /* reserve space for ram-usage option */
 #if OPT_HEAPSIZE
@@ -1750,9 +1769,12 @@ typedef struct	LINE {
 		C_NUM	l_fo;		/* forward undo dot offs (undo only) */
 	} l_s_fo;
 	union {
-		L_NUM	l_nmbr;		/* line-# iff b_numlines > 0	*/
+		L_NUM	l_nmbr;		/* line's index in l_chunk	*/
 		C_NUM	l_bo;		/* backward undo dot offs (undo only) */
 	} l_n_bo;
+#if !SMALLER
+	struct LINECHUNK *l_chunk;	/* group of lines for numbering	*/
+#endif
 	int	l_used;			/* Used size (may be negative)	*/
 	union {
 	    char *l_txt;		/* The data for this line	*/
@@ -1767,8 +1789,26 @@ typedef struct	LINE {
 	UCHAR  *l_attrs;		/* indexes into the line_attr_tbl
 					   hash table */
 #endif
+#if OPT_FILTER
+	int	l_lexgen;		/* syntax-filter pass that saw line */
+	int	l_lexstate;		/* filter's state at start of line */
+#endif
 }	LINE;
 
+/*
+ * Except for SMALLER, the lines of a buffer are numbered in chunks of up to
+ * LCHUNK_MAX consecutive lines, which are kept up to date as lines are linked
+ * into or out of the buffer (see lindex_insert).  A line's number is the
+ * number of lines before its chunk, which is computed as needed, plus its
+ * index within the chunk.
+ */
+typedef struct LINECHUNK {
+	struct LINE *lc_first;		/* first line in the chunk	*/
+	L_NUM	lc_count;		/* number of lines in the chunk	*/
+	L_NUM	lc_index;		/* index in b_lchunks		*/
+	L_NUM	lc_start;		/* number of lines before it	*/
+} LINECHUNK;
+
 #define l_size		l_s_fo.l_sze
 #define l_forw_offs	l_s_fo.l_fo
 #define l_number	l_n_bo.l_nmbr
@@ -1783,6 +1823,18 @@ typedef struct	LINE {
 #define LCOPIED  lBIT(0)	/* original line is already on an undo stack */
 #define LGMARK   lBIT(1)	/* line matched a global scan */
 #define LTRIMMED lBIT(2)	/* line doesn't have newline to display */
+#define LDELTA   lBIT(3)	/* line's undo copy is a delta (see undo.c) */
+#define LHILITE  lBIT(4)	/* line's matches are highlighted (search.c) */
+
+/*
+ * One replacement made by lsplice(), in terms of offsets into the line as it
+ * was before the change.
+ */
+typedef struct {
+	C_NUM	sp_offset;		/* where the old text began	*/
+	C_NUM	sp_delete;		/* length of the old text	*/
+	C_NUM	sp_insert;		/* length of the new text	*/
+} SPLICE;
 
 /* macros to ease the use of lines */
 #define dot_next_bol()  do { \
@@ -1807,6 +1859,7 @@ typedef struct	LINE {
 #define STACKSEP	((int)(-4)) /* delimit set of changes on undo stack */
 #define PURESTACKSEP	((int)(-3)) /* as above, but buffer unmodified before */
 					/* this change */
+#define LINEUNDODELTA	((int)(-5)) /* for undo, the changed part of a line */
 
 #define set_lforw(a,b)	lforw(a) = (b)
 #define set_lback(a,b)	lback(a) = (b)
@@ -1836,10 +1889,33 @@ typedef struct	LINE {
 #define lsetnottrimmed(lp)	((lp)->l.l_flag &= (USHORT) ~LTRIMMED)
 #define lsetclear(lp)		((lp)->l.l_flag = (lp)->l.l_undo_cookie = 0)
 
+#define lisdelta(lp)		((lp)->l.l_flag & LDELTA)
+#define lsetdelta(lp)		((lp)->l.l_flag |= LDELTA)
+#define lsetnotdelta(lp)	((lp)->l.l_flag &= (USHORT) ~LDELTA)
+
+#define lishilited(lp)		((lp)->l.l_flag & LHILITE)
+#define lsethilited(lp)		((lp)->l.l_flag |= LHILITE)
+#define lsetnothilited(lp)	((lp)->l.l_flag &= (USHORT) ~LHILITE)
+
+	/*
+	 * A syntax filter may record its state at the start of each line, so
+	 * that it can later resume from an unchanged line rather than from
+	 * the top of the buffer.  A "dirty" line's text has changed, while a
+	 * "stale" line also has an unknown starting state.
+	 */
+#if OPT_FILTER
+#define lsetlexdirty(lp)	((lp)->l_lexgen = 0)
+#define lsetlexstale(lp)	((lp)->l_lexgen = 0, (lp)->l_lexstate = -1)
+#else
+#define lsetlexdirty(lp)	/* nothing */
+#define lsetlexstale(lp)	/* nothing */
+#endif
+
 #define lisreal(lp)		(llength(lp) >= 0)
 #define lisnotreal(lp)		(llength(lp) == LINENOTREAL)
 #define lislinepatch(lp)	(llength(lp) == LINEUNDOPATCH)
 #define lispatch(lp)		(lislinepatch(lp))
+#define lisundodelta(lp)	(llength(lp) == LINEUNDODELTA)
 #define lisstacksep(lp)		(llength(lp) == STACKSEP || \
 					llength(lp) == PURESTACKSEP)
 #define lispurestacksep(lp)	(llength(lp) == PURESTACKSEP)
@@ -1969,6 +2045,8 @@ typedef UCHAR VIDEO_ATTR;
 
 typedef struct vl_aregion {
 	struct vl_aregion	*ar_next;
+	struct vl_aregion	*ar_index;	/* next in b_attrindex bucket */
+	LINE		*ar_key;	/* ...its line, if not a span	*/
 	REGION		ar_region;
 	VIDEO_ATTR	ar_vattr;
 	REGIONSHAPE	ar_shape;
@@ -2170,7 +2248,21 @@ typedef struct {
 typedef int FUID;
 #endif
 
-#if (OPT_AUTOCOLOR || OPT_ELAPSED) && !defined(VL_ELAPSED)
+/*
+ * The list of buffers is also indexed by hash tables, to find a buffer by its
+ * address, name, filename or (where supported) file unique id.
+ */
+typedef enum {
+	bx_ADDR = 0
+	, bx_NAME
+	, bx_FILE
+#ifdef CAN_CHECK_INO
+	, bx_FUID
+#endif
+	, bx_MAX
+} BUF_INDEX;
+
+#if (OPT_AUTOCOLOR || OPT_ELAPSED || OPT_SHOW_SCREEN) && !defined(VL_ELAPSED)
 #ifdef HAVE_GETTIMEOFDAY
 #define VL_ELAPSED struct timeval
 #elif SYS_WINNT
@@ -2195,12 +2287,45 @@ typedef int FUID;
 
 typedef	int	(*UpBuffFunc) ( struct BUFFER * );
 
+/*
+ * Each buffer allocates its LINE structs and short line-text from a list of
+ * large blocks, so that editing does not fragment the heap, and so that the
+ * blocks can be released together when the buffer is cleared.  Freed text is
+ * kept on a list for each size-class (powers of two, starting with NBLOCK),
+ * and reused for the same class.  Longer text is malloc'd.
+ */
+#define ARENA_BLOCK	65536			/* size of each arena block	*/
+#define ARENA_CLASSES	8			/* text size-classes		*/
+#define ARENA_TEXTMAX	(NBLOCK << (ARENA_CLASSES - 1))
+
+typedef union vl_arena_blk {
+	union vl_arena_blk *ab_next;		/* next block in the arena	*/
+	double	ab_align;			/* ...forces alignment		*/
+} ARENA_BLK;
+
+typedef struct {
+	ARENA_BLK *a_blocks;			/* list of blocks		*/
+	char	*a_next;			/* unused part of newest block	*/
+	char	*a_last;			/* ...end of that block		*/
+	UINT	a_nblocks;			/* # of blocks allocated	*/
+	B_COUNT	a_lines;			/* # of LINEs carved		*/
+	void	*a_free[ARENA_CLASSES];		/* freed text, by size-class	*/
+	B_COUNT	a_used[ARENA_CLASSES];		/* # of text chunks in use	*/
+	B_COUNT	a_idle[ARENA_CLASSES];		/* # of text chunks freed	*/
+	B_COUNT	a_large;			/* # of malloc'd text chunks	*/
+	B_COUNT	a_large_bytes;			/* ...their total size		*/
+} ARENA;
+
 typedef struct	BUFFER {
 	MARK	b_line;		/* Link to the header LINE (offset unused) */
 	struct	BUFFER *b_bufp;		/* Link to next BUFFER		*/
 	MARK	*b_nmmarks;		/* named marks a-z		*/
 #if OPT_SELECTIONS
 	AREGION	*b_attribs;		/* attributed regions		*/
+	AREGION	**b_attrindex;		/* ...hashed by starting line	*/
+	UINT	b_attrindex_max;	/* # of buckets allocated	*/
+	UINT	b_attrindex_used;	/* # of regions in buckets	*/
+	AREGION	*b_attrspans;		/* ...those spanning more lines	*/
 #endif
 #if OPT_MAJORMODE
 	MAJORMODE *majr;		/* majormode, if any */
@@ -2221,14 +2346,31 @@ typedef struct	BUFFER {
 	LINE	*b_LINEs;		/* block-malloced LINE structs	*/
 	LINE	*b_LINEs_end;		/* end of	"	"	*/
 	LINE	*b_freeLINEs;		/* list of free "	"	*/
+	ARENA	b_arena;		/* LINEs and text, after loading */
 	UCHAR	*b_ltext;		/* block-malloced text		*/
 	UCHAR	*b_ltext_end;		/* end of block-malloced text	*/
+#if OPT_LAZY_READER
+	FILE	*b_lazyfp;		/* file still being read, if any */
+	B_COUNT	b_lazy_read;		/* bytes of b_ltext read so far	*/
+	B_COUNT	b_lazy_split;		/* ...and split into lines	*/
+#endif
 	LINE	*b_ulinep;		/* pointer at 'Undo' line	*/
+#if !SMALLER
+	LINECHUNK **b_lchunks;		/* line-numbering, if not null	*/
+	L_NUM	b_lchunks_len;		/* # of chunks in use		*/
+	L_NUM	b_lchunks_max;		/* # of chunks allocated	*/
+	L_NUM	b_lchunks_ok;		/* # of chunks with lc_start set */
+	L_NUM	b_lchunks_lines;	/* # of lines in the chunks	*/
+#endif
 	int	b_active;		/* window activated flag	*/
 	int	b_refcount;		/* counts levels of source'ing	*/
 	UINT	b_nwnd;			/* Count of windows on buffer	*/
 	UINT	b_flag;			/* Flags			*/
 	short	b_inuse;		/* nonzero if executing macro	*/
+	UINT	b_changes;		/* counts changes to the text	*/
+#if !SMALLER
+	struct MACCODE *b_maccode;	/* statements compiled by dobuf() */
+#endif
 	short	b_acount;		/* auto-save count		*/
 	const char *b_recordsep_str;	/* string for recordsep		*/
 	int	b_recordsep_len;	/* ...its length		*/
@@ -2239,6 +2381,11 @@ typedef struct	BUFFER {
 	double	last_autocolor_time;	/* millisecond for last autocolor */
 	long	next_autocolor_time;	/* count for skipping autocolor */
 #endif
+#if OPT_FILTER
+	int	b_lexgen;		/* last syntax-filter pass, if lines
+					   have its checkpoints */
+	char	*b_lexfilter;		/* ...filter name/params used	*/
+#endif
 #if OPT_CURTOKENS
 	struct VAL buf_fname_expr;	/* $buf-fname-expr		*/
 #endif
@@ -2252,6 +2399,10 @@ typedef struct	BUFFER {
 #ifdef	MDCHK_MODTIME
 	time_t	b_modtime;		/* file's last-modification time */
 	time_t	b_modtime_at_warn;	/* file's modtime when user warned */
+#if OPT_FILE_WATCH
+	int	b_watch_wd;		/* inotify watch, 0 if none, -1 if failed */
+	int	b_watch_stale;		/* ...true if file may have changed */
+#endif
 #endif
 #if	OPT_NAMEBST
 	TBUFF	*b_procname;		/* full procedure name		*/
@@ -2266,6 +2417,9 @@ typedef struct	BUFFER {
 	struct	BUFFER *b_relink;	/* Link to next BUFFER (sorting) */
 	int	b_created;
 	int	b_last_used;
+	struct	BUFFER *b_hnext[bx_MAX]; /* next in each hash-index bucket */
+	UINT	b_hcode[bx_MAX];	/* ...hash codes for those indexes */
+	UINT	b_hmember;		/* ...bit-mask of indexes holding it */
 #if OPT_HILITEMATCH
 	USHORT	b_highlight;
 #endif
@@ -2491,6 +2645,7 @@ extern MARK *api_mark_iterator(BUFFER *bp, int *iter);
 		statement				\
 		mp = &dmi_ap->ar_region.r_end;		\
 		statement				\
+		reindex_attrib(curbp, dmi_ap);		\
 		dmi_ap = dmi_ap->ar_next;		\
 	    }						\
 	    sel_reassert_ownership(curbp);		\
@@ -2667,6 +2822,26 @@ typedef struct	{
 
 #define term_is_utfXX()         (term.get_enc() >= enc_UTF8)
 
+#if OPT_SHOW_SCREEN
+/*
+ * Counters for the output which update() sends to the terminal, shown by
+ * "show-screen-stats".
+ */
+typedef struct {
+	ULONG	updates;		/* screen updates done		*/
+	ULONG	bytes;			/* bytes written to terminal	*/
+	ULONG	moves;			/* cursor movements		*/
+	ULONG	attrs;			/* video attribute/color changes */
+	ULONG	scrolls;		/* scrolling operations		*/
+	ULONG	rows;			/* rows repainted		*/
+	double	msecs;			/* time spent in updates	*/
+} SCREEN_STATS;
+
+#define count_screen_stat(name) screen_stats.name++
+#else
+#define count_screen_stat(name) /* nothing */
+#endif
+
 #if DISP_CURSES && defined(HAVE_ADDNWSTR)
 #define WIDE_CURSES 1
 #else
@@ -1470,11 +1470,14 @@ run_func(int fnum)
     case UFCMATCH:
 	if ((exp = new_regexval(arg[0], TRUE)) != NULL) {
 	    value = nregexec(exp->reg, arg[1], (char *) 0, 0, -1, TRUE);
+	    free_regexval(exp);
 	}
 	break;
     case UFMATCH:
-	if ((exp = new_regexval(arg[0], TRUE)) != NULL)
+	if ((exp = new_regexval(arg[0], TRUE)) != NULL) {
 	    value = nregexec(exp->reg, arg[1], (char *) 0, 0, -1, FALSE);
+	    free_regexval(exp);
+	}
 	break;
     case UFRANDOM:		/* FALLTHRU */
     case UFRND:
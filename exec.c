@@ -36,6 +36,35 @@ typedef struct WHLOOP {
     struct WHLOOP *w_next;
 } WHLOOP;
 
+/*
+ * dobuf() keeps a copy of each buffer's statements, which perform_dobuf()
+ * runs until the buffer is changed, rather than rereading its lines.  Lines
+ * ending with a backslash are joined, leading whitespace is stripped, and
+ * directive names and literal command-names are looked up when compiling.
+ */
+typedef struct {
+    LINE *ms_first;		/* first line of the statement */
+    LINE *ms_last;		/* last line, if continued */
+    char *ms_text;		/* the text, without leading whitespace */
+    size_t ms_length;		/* length of the text from the last line */
+    DIRECTIVE ms_dirnum;	/* leading directive, if any */
+    size_t ms_after;		/* ...offset past its name */
+    const CMDFUNC *ms_cfp;	/* command, if named by a literal */
+    UINT ms_cfp_gen;		/* ...namebst_gen when it was found */
+    size_t ms_cmdlen;		/* ...length of its name */
+    size_t ms_args;		/* ...offset of its arguments */
+    LINE *ms_jumpfrom;		/* line a directive went to */
+    int ms_jump;		/* ...index of the statement after it */
+} MACSTMT;
+
+typedef struct MACCODE {
+    UINT mc_changes;		/* b_changes when compiled */
+    int mc_refs;		/* number of perform_dobuf() calls using it */
+    int mc_count;		/* number of statements */
+    MACSTMT *mc_stmts;		/* the statements */
+    WHLOOP *mc_whlist;		/* while-loops, from setup_dobuf() */
+} MACCODE;
+
 static int token_ended_line;	/* did the last token end at end of line? */
 
 #if !SMALLER
@@ -237,9 +266,9 @@ parse_linespec(const char *s, LINE **markptr)
 	    tb_append(&searchpat, EOS);
 
 	    if (tb_length(searchpat) > 1 &&
-		(gregexp = regcomp(tb_values(searchpat),
-				   tb_length(searchpat) - 1,
-				   b_val(curbp, MDMAGIC))) != NULL) {
+		(gregexp = regcomp_cached(tb_values(searchpat),
+					  tb_length(searchpat) - 1,
+					  b_val(curbp, MDMAGIC))) != NULL) {
 
 		scanboundry(TRUE, DOT, last_srch_direc);
 		if (scanner(gregexp,
@@ -1071,6 +1100,43 @@ docmd(char *cline, int execflag, int f, int n)
     returnCode(status);
 }
 
+#if !SMALLER
+/*
+ * Execute a command from a macro, whose name was a literal already looked up
+ * when the macro was compiled.  This does what docmd() would do after getting
+ * the name as a token; "args" points past the name and the blanks after it.
+ */
+static int
+docmd_resolved(const CMDFUNC * cfp, char *args)
+{
+    int status;
+    int oldcle;
+    char *oldestr;
+
+    TRACE((T_CALLED "docmd_resolved(%s, args=%s)\n",
+	   fnc2engl(cfp), str_visible(args)));
+
+    set_end_string(EOS);
+    oldestr = execstr;
+    execstr = args;
+
+    /* as if mac_unquotedarg() had just read the name */
+    token_ended_line = isreturn(*args) || *args == EOS;
+    if (*skip_blanks(args) == EOS)
+	set_end_string('\n');
+
+    oldcle = clexec;
+    clexec = TRUE;
+    calledbefore = FALSE;
+    status = execute(cfp, FALSE, 1);
+    setcmdstatus(status);
+    clexec = oldcle;
+
+    execstr = oldestr;
+    returnCode(status);
+}
+#endif
+
 /*
  *  Call the appropriate action for a given CMDFUNC
  */
@@ -1136,6 +1202,9 @@ execute(const CMDFUNC * execfunc, int f, int n)
 	   TRACE_CMDFUNC(execfunc),
 	   f, n));
 
+    /* a command may look at any line, so finish reading files first */
+    lazyreadf_finish_all();
+
     flags = execfunc->c_flags;
 
     /* commands following operators can't be redone or undone */
@@ -2531,14 +2600,6 @@ compute_indent(char *cmd, size_t length, int *indent, int *indstate)
     }
 }
 
-static char *
-add_indent(char *dst, int indent)
-{
-    while (indent-- > 0) {
-	*dst++ = '\t';
-    }
-    return dst;
-}
 #endif
 
 static void
@@ -2554,75 +2615,43 @@ handle_endm(void)
     }
 }
 
+/*
+ * Read the statement which begins on the line after "lp", joining lines which
+ * end with a backslash, and stripping leading whitespace from each.  Return
+ * TRUE if a statement was read (its text is malloc'd), FALSE at the end of
+ * the buffer, or ABORT if there was no memory.
+ */
 static int
-perform_dobuf(BUFFER *bp, WHLOOP * whlist)
+read_statement(BUFFER *bp, LINE *lp, MACSTMT * st)
 {
-    int status = TRUE;
-    int glue = 0;		/* nonzero to append lines */
-    LINE *lp;
+    char *linebuf = NULL;	/* buffer holding copy of the lines */
+    char *cmdp;
+    size_t glue = 0;		/* nonzero to append lines */
     size_t linlen;
-    DIRECTIVE dirnum;
-    WINDOW *wp;
-    char *linebuf = NULL;	/* buffer holding copy of line executing */
-    char *cmdp;			/* text to execute */
-    int save_clhide = clhide;
-    int save_no_errs = no_errs;
-    int save_quiet = quiet;
-    int indent = 0;
-#if !SMALLER
-    int indstate = 0;
-#endif
-
-    static BUFFER *dobuferrbp = NULL;
-
-    (void) whlist;
-
-    TRACE((T_CALLED "perform_dobuf(bp=%p, whlist=%p) buffer '%s'\n",
-	   (void *) bp, (void *) whlist, bp->b_bname));
-
-    bp->b_inuse++;
-
-    /* starting at the beginning of the buffer */
-    for_each_line(lp, bp) {
-	bp->b_dot.l = lp;
 
-	/* calculate the line length and make a local copy */
+    st->ms_first = NULL;
+    while ((lp = lforw(lp)) != buf_head(bp)) {
+	if (st->ms_first == NULL)
+	    st->ms_first = lp;
 
 	if (llength(lp) <= 0)
 	    linlen = 0;
 	else
 	    linlen = (size_t) llength(lp);
 
-	if (glue) {
-	    safe_castrealloc(char, linebuf, (size_t) glue + linlen + 1);
-	    if (linebuf == NULL) {
-		status = no_memory("during macro execution");
-		break;
-	    }
-	    cmdp = linebuf + glue;
-	} else {
-	    FreeIfNeeded(linebuf);
-
-#if !SMALLER
-	    compute_indent(lvalue(lp), linlen, &indent, &indstate);
-#endif
-	    linebuf = cmdp = castalloc(char, (size_t) indent + linlen + 1);
-	    if (linebuf == NULL) {
-		status = no_memory("during macro execution");
-		break;
-	    }
+	safe_castrealloc(char, linebuf, glue + linlen + 1);
+	if (linebuf == NULL) {
+	    (void) no_memory("during macro execution");
+	    return ABORT;
 	}
+	cmdp = linebuf + glue;
 
 	if (linlen == 0) {
 	    cmdp[0] = EOS;	/* make sure it ends */
 	} else {
 	    char *src;
 	    char *dst;
-#if !SMALLER
-	    if (!glue) {
-		cmdp = add_indent(cmdp, indent);
-	    }
-#endif
+
 	    (void) memcpy(cmdp, lvalue(lp), linlen);
 	    cmdp[linlen] = EOS;	/* make sure it ends */
 
@@ -2634,12 +2663,7 @@ perform_dobuf(BUFFER *bp, WHLOOP * whlist)
 	    }
 	    linlen -= (size_t) (src - dst);
 	}
-	glue = 0;
-
-	TPRINTF(("%s:%d (%d/%d):%s\n", bp->b_bname,
-		 line_no(bp, lp),
-		 ifstk.level, ifstk.disabled,
-		 cmdp));
+	st->ms_last = lp;
 
 	/*
 	 * If the last character on the line is a backslash, glue the
@@ -2648,10 +2672,274 @@ perform_dobuf(BUFFER *bp, WHLOOP * whlist)
 	if (lforw(lp) != buf_head(bp)
 	    && linlen != 0
 	    && isEscaped(cmdp + linlen)) {
-	    glue = (int) (linlen + (size_t) (cmdp - linebuf) - 1);
+	    glue = linlen + (size_t) (cmdp - linebuf) - 1;
 	    continue;
 	}
-	cmdp = skip_space_tab(linebuf);
+	st->ms_text = linebuf;
+	st->ms_length = linlen;
+	return TRUE;
+    }
+    FreeIfNeeded(linebuf);
+    return FALSE;
+}
+
+/*
+ * Look up the leading directive of a statement, and (if "resolve" is set) the
+ * command named by a leading literal.
+ */
+static void
+classify_statement(MACSTMT * st, int resolve)
+{
+    char *cmdp = st->ms_text;
+
+    st->ms_dirnum = D_UNKNOWN;
+    st->ms_after = 0;
+    st->ms_cfp = NULL;
+    st->ms_jumpfrom = NULL;
+    st->ms_jump = -1;
+
+    if (*cmdp == DIRECTIVE_CHAR) {
+	st->ms_dirnum = dname_to_dirnum(&cmdp, st->ms_length);
+	st->ms_after = (size_t) (cmdp - st->ms_text);
+    }
+#if !SMALLER
+    else if (resolve && isAlpha(*cmdp)) {
+	char *name = cmdp;
+	int c;
+
+	/* only names which mac_unquotedarg() would return unchanged */
+	while ((c = *cmdp) != EOS && !isBlank(c)) {
+	    if (c == BACKSLASH || c == SQUOTE || c == DQUOTE || c == ':')
+		return;
+	    ++cmdp;
+	}
+	c = *cmdp;
+	*cmdp = EOS;
+	st->ms_cfp = engl2fnc(name);
+	st->ms_cfp_gen = namebst_gen;
+	*cmdp = (char) c;
+	st->ms_cmdlen = (size_t) (cmdp - name);
+	st->ms_args = (size_t) (skip_space_tab(cmdp) - st->ms_text);
+    }
+#else
+    (void) resolve;
+#endif
+}
+
+#if !SMALLER
+static void
+discard_maccode(MACCODE * code)
+{
+    int n;
+
+    for (n = 0; n < code->mc_count; ++n)
+	free(code->mc_stmts[n].ms_text);
+    FreeIfNeeded(code->mc_stmts);
+    free_all_whiles(code->mc_whlist);
+    free(code);
+}
+
+/*
+ * Free the statements compiled for a buffer, e.g., when it is cleared.  If a
+ * macro is running from them, perform_dobuf() frees them when it is done.
+ */
+void
+free_maccode(BUFFER *bp)
+{
+    MACCODE *code = bp->b_maccode;
+
+    if (code != NULL) {
+	bp->b_maccode = NULL;
+	if (code->mc_refs == 0)
+	    discard_maccode(code);
+    }
+}
+
+/*
+ * Return the statements for a buffer, compiling them if the buffer has
+ * changed since the last time.  Return NULL on error.
+ */
+static MACCODE *
+compile_dobuf(BUFFER *bp)
+{
+    MACCODE *code = bp->b_maccode;
+    LINE *lp;
+    size_t limit = 0;
+    int rc;
+
+    bp->b_dot.o = 0;
+    if (code != NULL) {
+	if (code->mc_changes == bp->b_changes)
+	    return code;
+	free_maccode(bp);
+    }
+
+    TRACE(("compile_dobuf(%s)\n", bp->b_bname));
+    if ((code = typecalloc(MACCODE)) == NULL) {
+	(void) no_memory("compiling macro");
+	return NULL;
+    }
+    code->mc_changes = bp->b_changes;
+
+    if (setup_dobuf(bp, &(code->mc_whlist)) != TRUE) {
+	discard_maccode(code);
+	return NULL;
+    }
+
+    lp = buf_head(bp);
+    for_ever {
+	MACSTMT *st;
+
+	if ((size_t) code->mc_count >= limit) {
+	    limit = (limit + 8) * 2;
+	    safe_typereallocn(MACSTMT, code->mc_stmts, limit);
+	    if (code->mc_stmts == NULL) {
+		code->mc_count = 0;
+		(void) no_memory("compiling macro");
+		discard_maccode(code);
+		return NULL;
+	    }
+	}
+	st = &(code->mc_stmts[code->mc_count]);
+	if ((rc = read_statement(bp, lp, st)) != TRUE) {
+	    if (rc == ABORT) {
+		discard_maccode(code);
+		return NULL;
+	    }
+	    break;
+	}
+	classify_statement(st, TRUE);
+	lp = st->ms_last;
+	code->mc_count++;
+    }
+
+    bp->b_maccode = code;
+    return code;
+}
+
+/*
+ * A directive moved execution to the line "lp".  Return the index of the
+ * statement after that line, or -1 if it is not the last line of one.
+ */
+static int
+statement_after(MACCODE * code, BUFFER *bp, LINE *lp)
+{
+    int n;
+
+    if (lforw(lp) == buf_head(bp))
+	return code->mc_count;
+    for (n = 0; n < code->mc_count; ++n) {
+	if (code->mc_stmts[n].ms_first == lforw(lp))
+	    return n;
+    }
+    return -1;
+}
+#endif /* !SMALLER */
+
+static int
+perform_dobuf(BUFFER *bp, MACCODE * code)
+{
+    int status = TRUE;
+    LINE *lp;
+    size_t linlen;
+    DIRECTIVE dirnum;
+    WINDOW *wp;
+    TBUFF *linebuf = NULL;	/* buffer holding copy of line executing */
+    TBUFF *stored = NULL;	/* buffer holding line for macrobuffer */
+    char *cmdp;			/* text to execute */
+    MACSTMT *st = NULL;		/* statement executing */
+    MACSTMT from_lines;		/* ...if read from the buffer's lines */
+    int next = 0;		/* index of the next compiled statement */
+    int save_clhide = clhide;
+    int save_no_errs = no_errs;
+    int save_quiet = quiet;
+#if !SMALLER
+    int indent = 0;
+    WHLOOP *whlist = NULL;
+    MACCODE *held = code;	/* owns whlist until we return */
+    int indstate = 0;
+#endif
+
+    static BUFFER *dobuferrbp = NULL;
+
+    TRACE((T_CALLED "perform_dobuf(bp=%p, code=%p) buffer '%s'\n",
+	   (void *) bp, (void *) code, bp->b_bname));
+
+    bp->b_inuse++;
+#if !SMALLER
+    if (code != NULL) {
+	code->mc_refs++;
+	whlist = code->mc_whlist;
+    }
+#endif
+    from_lines.ms_text = NULL;
+
+    /* starting at the beginning of the buffer */
+    lp = buf_head(bp);
+    for_ever {
+	int resolved = FALSE;
+
+#if !SMALLER
+	/*
+	 * Use the compiled statements unless the buffer has changed while
+	 * running them, and then continue by reading its lines.
+	 */
+	if (code != NULL) {
+	    if (code->mc_changes != bp->b_changes) {
+		TRACE(("buffer changed, reading lines\n"));
+		code = NULL;
+	    } else if (st != NULL && lp != st->ms_last) {
+		/* a directive moved to another line */
+		if (st->ms_jumpfrom != lp) {
+		    st->ms_jumpfrom = lp;
+		    st->ms_jump = statement_after(code, bp, lp);
+		}
+		if (st->ms_jump < 0) {
+		    code = NULL;
+		} else {
+		    next = st->ms_jump;
+		}
+	    }
+	}
+	if (code != NULL) {
+	    if (next >= code->mc_count)
+		break;
+	    st = &(code->mc_stmts[next++]);
+	} else
+#endif
+	{
+	    int rc;
+
+	    FreeAndNull(from_lines.ms_text);
+	    if ((rc = read_statement(bp, lp, &from_lines)) != TRUE) {
+		if (rc == ABORT)
+		    status = FALSE;
+		break;
+	    }
+	    classify_statement(&from_lines, FALSE);
+	    st = &from_lines;
+	}
+	lp = st->ms_last;
+	bp->b_dot.l = lp;
+	linlen = st->ms_length;
+
+#if !SMALLER
+	if (macrobuffer != NULL)
+	    compute_indent(lvalue(st->ms_first),
+			   (size_t) ((llength(st->ms_first) > 0)
+				     ? llength(st->ms_first)
+				     : 0),
+			   &indent, &indstate);
+	else
+	    compute_indent((char *) 0, (size_t) 0, &indent, &indstate);
+#endif
+
+	cmdp = st->ms_text;
+
+	TPRINTF(("%s:%d (%d/%d):%s\n", bp->b_bname,
+		 line_no(bp, lp),
+		 ifstk.level, ifstk.disabled,
+		 cmdp));
 
 	/* Skip comments and blank lines.
 	 * ';' for uemacs backward compatibility, and
@@ -2662,6 +2950,13 @@ perform_dobuf(BUFFER *bp, WHLOOP * whlist)
 	    || *cmdp == EOS) {
 	    continue;
 	}
+
+	/* make a local copy of the statement, which commands may modify */
+	if (tb_scopy(&linebuf, st->ms_text) == NULL) {
+	    status = no_memory("during macro execution");
+	    break;
+	}
+	cmdp = tb_values(linebuf);
 #if OPT_DEBUGMACROS
 	/* echo lines and get user confirmation when debugging */
 	if (tracemacros) {
@@ -2689,7 +2984,8 @@ perform_dobuf(BUFFER *bp, WHLOOP * whlist)
 
 	if (*cmdp == DIRECTIVE_CHAR) {
 
-	    dirnum = dname_to_dirnum(&cmdp, linlen);
+	    dirnum = st->ms_dirnum;
+	    cmdp += st->ms_after;
 	    if (dirnum == D_UNKNOWN) {
 		mlforce("[Unknown directive \"%s\"]", cmdp);
 		status = FALSE;
@@ -2708,12 +3004,24 @@ perform_dobuf(BUFFER *bp, WHLOOP * whlist)
 	    }
 	} else {
 	    dirnum = D_UNKNOWN;
+	    resolved = (st->ms_cfp != NULL);
 	}
 
 	/* if macro store is on, just salt this away */
 	if (macrobuffer != NULL) {
+	    char *text = tb_values(linebuf);
+#if !SMALLER
+	    /* indent the stored line to show the nesting of directives */
+	    if (indent > 0) {
+		tb_init(&stored, EOS);
+		while (tb_length(stored) < (size_t) indent)
+		    tb_append(&stored, '\t');
+		tb_sappend0(&stored, st->ms_text);
+		text = tb_values(stored);
+	    }
+#endif
 	    /* allocate the space for the line */
-	    if (addline(macrobuffer, linebuf, -1) == FALSE) {
+	    if (text == NULL || addline(macrobuffer, text, -1) == FALSE) {
 		mlforce("[Out of memory while storing macro]");
 		status = FALSE;
 		break;
@@ -2731,28 +3039,28 @@ perform_dobuf(BUFFER *bp, WHLOOP * whlist)
 #if ! SMALLER
 	/* deal with directives */
 	if (dirnum != D_UNKNOWN) {
-	    int code;
+	    int code2;
 
 	  next_directive:
 	    /* move past directive */
 	    cmdp = skip_space_tab(cmdp);
 
-	    code = begin_directive(&cmdp, dirnum, whlist, bp, &lp);
-	    if (code == DDIR_FAILED) {
+	    code2 = begin_directive(&cmdp, dirnum, whlist, bp, &lp);
+	    if (code2 == DDIR_FAILED) {
 		status = FALSE;
 		break;
-	    } else if (code == DDIR_COMPLETE) {
+	    } else if (code2 == DDIR_COMPLETE) {
 		continue;
-	    } else if (code == DDIR_INCOMPLETE) {
+	    } else if (code2 == DDIR_INCOMPLETE) {
 		status = TRUE;	/* not exactly an error */
 		break;
-	    } else if (code == DDIR_FORCE) {
+	    } else if (code2 == DDIR_FORCE) {
 		TRACE(("~force\n"));
 		no_errs = TRUE;
-	    } else if (code == DDIR_HIDDEN) {
+	    } else if (code2 == DDIR_HIDDEN) {
 		TRACE(("~hidden\n"));
 		clhide = TRUE;
-	    } else if (code == DDIR_QUIET) {
+	    } else if (code2 == DDIR_QUIET) {
 		TRACE(("~quiet\n"));
 		quiet = TRUE;
 	    }
@@ -2771,22 +3079,42 @@ perform_dobuf(BUFFER *bp, WHLOOP * whlist)
 	} else if (*cmdp != DIRECTIVE_CHAR) {
 	    /* prefix lines with "WITH" value, if any */
 	    if (tb_length(with_prefix)) {
-		char *temp = typeallocn(char, tb_length(with_prefix)
-					+ strlen(cmdp) + 2);
-		if (temp == NULL) {
+		TBUFF *temp = NULL;
+
+		if (tb_scopy(&temp, tb_values(with_prefix)) == NULL
+		    || tb_sappend0(&temp, " ") == NULL
+		    || tb_sappend0(&temp, cmdp) == NULL) {
+		    tb_free(&temp);
 		    status = no_memory("performing ~with");
 		    break;
 		}
-		(void) lsprintf(temp, "%s %s", tb_values(with_prefix), cmdp);
-		free(linebuf);
-		cmdp = linebuf = temp;
+		tb_free(&linebuf);
+		linebuf = temp;
+		cmdp = tb_values(linebuf);
+		resolved = FALSE;
 	    }
 	}
+
+	/* the name may have been redefined since it was looked up */
+	if (resolved && st->ms_cfp_gen != namebst_gen) {
+	    char *name = cmdp;
+	    int c = name[st->ms_cmdlen];
+
+	    name[st->ms_cmdlen] = EOS;
+	    st->ms_cfp = engl2fnc(name);
+	    st->ms_cfp_gen = namebst_gen;
+	    name[st->ms_cmdlen] = (char) c;
+	    resolved = (st->ms_cfp != NULL);
+	}
 #endif
 
 	/* if we are only scanning, come back here */
 	if (ifstk.disabled)
 	    status = TRUE;
+#if !SMALLER
+	else if (resolved)
+	    status = docmd_resolved(st->ms_cfp, cmdp + st->ms_args);
+#endif
 	else
 	    status = docmd(cmdp, TRUE, FALSE, 1);
 
@@ -2823,7 +3151,20 @@ perform_dobuf(BUFFER *bp, WHLOOP * whlist)
 	}
     }
 
-    FreeIfNeeded(linebuf);
+    tb_free(&linebuf);
+    tb_free(&stored);
+    FreeIfNeeded(from_lines.ms_text);
+#if !SMALLER
+    /*
+     * Though we may have stopped using the compiled statements, the while-
+     * loops are still ours.  Discard them only if nothing else uses them.
+     */
+    if (held != NULL) {
+	held->mc_refs--;
+	if (held != bp->b_maccode && held->mc_refs == 0)
+	    discard_maccode(held);
+    }
+#endif
 
     if (--(bp->b_inuse) < 0)
 	bp->b_inuse = 0;
@@ -2838,7 +3179,7 @@ dobuf(BUFFER *bp, int limit, int real_cmd_count)
 {
     TBUFF *macro_result = NULL;
     int status = FALSE;
-    WHLOOP *whlist;
+    MACCODE *code;
     int save_vl_msgs;
     int save_cmd_count;
     int counter;
@@ -2864,21 +3205,20 @@ dobuf(BUFFER *bp, int limit, int real_cmd_count)
 				     : counter);
 
 #if ! SMALLER
-		    if (setup_dobuf(bp, &whlist) != TRUE) {
+		    if ((code = compile_dobuf(bp)) == NULL) {
 			status = FALSE;
 		    } else
 #else
-		    whlist = NULL;
+		    code = NULL;
 #endif
 		    {
 			IFSTK save_ifstk;
 			push_buffer(&save_ifstk);
-			status = perform_dobuf(bp, whlist);
+			status = perform_dobuf(bp, code);
 			pop_buffer(&save_ifstk);
 		    }
 
 		    handle_endm();
-		    free_all_whiles(whlist);
 
 		    if (status != TRUE)
 			break;
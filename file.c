@@ -30,6 +30,13 @@
 #include <io.h>
 #endif
 
+#if OPT_FILE_WATCH
+#include <sys/inotify.h>
+#ifdef HAVE_SYS_VFS_H
+#include <sys/vfs.h>
+#endif
+#endif
+
 #if CC_CSETPP
 #define isFileMode(mode) (mode & S_IFREG) == S_IFREG
 #else
@@ -90,6 +97,190 @@ file_modified(char *path)
     return the_time;
 }
 
+#if defined(MDCHK_MODTIME) && OPT_FILE_WATCH
+/*
+ * Watch the files of check-modtime buffers with inotify, so that we need not
+ * stat each one to see if it has changed.  Events for a file mark its buffers
+ * stale, and only those are checked.  A buffer whose file cannot be watched,
+ * e.g., because it does not exist yet, is always checked.
+ */
+#define WATCH_EVENTS (IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE \
+		      | IN_MOVE_SELF | IN_DELETE_SELF)
+
+static int watch_fd = -1;	/* the inotify instance, if any */
+
+/*
+ * inotify does not see changes made on other hosts to a network filesystem,
+ * so we must keep checking those files with stat.
+ */
+static int
+watch_is_reliable(const char *path)
+{
+    int result = TRUE;
+#ifdef HAVE_SYS_VFS_H
+    static const UINT remote_fs[] =
+    {
+	0x00006969,		/* NFS */
+	0x0000517b,		/* SMB */
+	0xff534d42,		/* CIFS */
+	0xfe534d42,		/* SMB2 */
+	0x65735546,		/* FUSE, e.g., sshfs */
+	0x73757245,		/* CODA */
+	0x5346414f,		/* AFS */
+	0x00c36400,		/* CEPH */
+	0x01021997,		/* 9P */
+    };
+    struct statfs sb;
+    size_t n;
+
+    if (statfs(path, &sb) == 0) {
+	for (n = 0; n < TABLESIZE(remote_fs); ++n) {
+	    if ((UINT) sb.f_type == remote_fs[n]) {
+		result = FALSE;
+		break;
+	    }
+	}
+    }
+#endif
+    return result;
+}
+
+/*
+ * Mark the buffers watched by the given descriptor as stale.  If the watch is
+ * gone (the file was deleted), forget it, since the number may be reused.
+ */
+static void
+watch_mark_stale(int wd, UINT mask)
+{
+    BUFFER *bp;
+
+    for_each_buffer(bp) {
+	if ((mask & IN_Q_OVERFLOW)
+	    ? (bp->b_watch_wd > 0)
+	    : (bp->b_watch_wd == wd)) {
+	    bp->b_watch_stale = TRUE;
+	    if (mask & IN_IGNORED)
+		bp->b_watch_wd = 0;
+	}
+    }
+}
+
+/*
+ * Read the pending events, marking buffers stale.  This is called when the
+ * descriptor is readable, as well as before checking a buffer.
+ */
+static void
+watch_read_events(int fd)
+{
+    union {
+	struct inotify_event event;
+	char data[BUFSIZ + sizeof(struct inotify_event) + NFILEN];
+    } buffer;
+    ssize_t got;
+
+    while ((got = read(fd, &buffer, sizeof(buffer))) > 0) {
+	char *next = buffer.data;
+	char *last = buffer.data + got;
+	int last_wd = 0;
+
+	while (next < last) {
+	    struct inotify_event *event = (struct inotify_event *) (void *) next;
+
+	    /* a write is reported many times; mark its buffers once */
+	    if (event->wd != last_wd
+		|| (event->mask & (IN_IGNORED | IN_Q_OVERFLOW)) != 0) {
+		watch_mark_stale(event->wd, (UINT) event->mask);
+		last_wd = event->wd;
+	    }
+	    next += sizeof(struct inotify_event) + event->len;
+	}
+    }
+}
+
+static int
+watch_init(void)
+{
+    if (watch_fd < 0) {
+	if ((watch_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) >= 0)
+	    (void) watchfd_func(watch_fd, WATCHREAD, watch_read_events);
+    }
+    return (watch_fd >= 0);
+}
+
+/*
+ * Stop watching the buffer's file, unless another buffer shares the watch.
+ */
+void
+unwatch_buffer_file(BUFFER *bp)
+{
+    int wd = bp->b_watch_wd;
+
+    if (wd > 0) {
+	BUFFER *bp2;
+	int shared = FALSE;
+
+	bp->b_watch_wd = 0;
+	bp->b_watch_stale = TRUE;
+	for_each_buffer(bp2) {
+	    if (bp2->b_watch_wd == wd) {
+		shared = TRUE;
+		break;
+	    }
+	}
+	if (!shared)
+	    (void) inotify_rm_watch(watch_fd, wd);
+    }
+}
+
+/*
+ * Watch the buffer's file.  Do this before getting the modification time and
+ * file-id, so that any later change is seen.
+ */
+void
+watch_buffer_file(BUFFER *bp)
+{
+    int wd = 0;
+
+    if (b_val(bp, MDCHK_MODTIME)) {
+	wd = -1;
+	if (bp->b_fname != NULL
+	    && !isInternalName(bp->b_fname)
+	    && watch_is_reliable(bp->b_fname)
+	    && watch_init()) {
+	    /* discard older events; the caller will stat the file */
+	    watch_read_events(watch_fd);
+	    wd = inotify_add_watch(watch_fd, bp->b_fname, WATCH_EVENTS);
+	    if (wd < 0)
+		wd = -1;
+	}
+    }
+    if (wd != bp->b_watch_wd)
+	unwatch_buffer_file(bp);
+    bp->b_watch_wd = wd;
+    bp->b_watch_stale = (wd <= 0);
+}
+
+/*
+ * Returns true if the buffer's file may have changed since we last checked,
+ * i.e., if we must stat it.  Since the caller will look at the file, renew
+ * the watch, e.g., in case the file was replaced.  Do not retry files which
+ * could not be watched; writing or rereading the buffer does that.
+ */
+static int
+watch_file_changed(BUFFER *bp)
+{
+    if (watch_fd >= 0)
+	watch_read_events(watch_fd);
+
+    if (bp->b_watch_wd > 0 && !bp->b_watch_stale)
+	return FALSE;
+
+    if (bp->b_watch_wd >= 0)
+	watch_buffer_file(bp);
+    return TRUE;
+}
+#endif /* OPT_FILE_WATCH */
+
 #ifdef MDCHK_MODTIME
 static int
 PromptFileChanged(BUFFER *bp, char *fname, const char *question, int iswrite)
@@ -111,7 +302,11 @@ PromptFileChanged(BUFFER *bp, char *fname, const char *question, int iswrite)
     if (isInternalName(bp->b_fname) || !bp->b_active)
 	return SORTOFTRUE;
 
-    if (b_val(bp, MDCHK_MODTIME)) {
+    if (b_val(bp, MDCHK_MODTIME)
+#if OPT_FILE_WATCH
+	&& (!same_fname(fname, bp, FALSE) || watch_file_changed(bp))
+#endif
+	) {
 
 	if (same_fname(fname, bp, FALSE)
 	    && get_modtime(bp, &curtime)) {
@@ -237,9 +432,14 @@ set_modtime(BUFFER *bp, char *fn)
 {
     time_t current;
 
-    if (same_fname(fn, bp, FALSE) && get_modtime(bp, &current)) {
-	bp->b_modtime = current;
-	bp->b_modtime_at_warn = 0;
+    if (same_fname(fn, bp, FALSE)) {
+#if OPT_FILE_WATCH
+	watch_buffer_file(bp);
+#endif
+	if (get_modtime(bp, &current)) {
+	    bp->b_modtime = current;
+	    bp->b_modtime_at_warn = 0;
+	}
     }
 }
 #endif /* MDCHK_MODTIME */
@@ -463,6 +663,7 @@ fileuid_set(BUFFER *bp GCC_UNUSED, FUID * fuid GCC_UNUSED)
 {
 #ifdef CAN_CHECK_INO
     bp->b_fileuid = *fuid;	/* struct copy */
+    reindex_buffer(bp);
 #endif
 }
 
@@ -474,6 +675,7 @@ fileuid_invalidate(BUFFER *bp GCC_UNUSED)
     bp->b_fileuid.dev = 0;
     bp->b_fileuid.valid = FALSE;
     bp->b_fileuid_at_warn = bp->b_fileuid;
+    reindex_buffer(bp);
 #endif
 }
 
@@ -735,7 +937,9 @@ set_files_to_edit(const char *prompt, int appflag)
 	    }
 	}
 	if (find_bp(firstbp) != NULL) {
+	    lazy_readin = TRUE;
 	    status = bp2swbuffer(firstbp, FALSE, TRUE);
+	    lazy_readin = FALSE;
 	    if (status == ABORT)
 		reset_to_unnamed(firstbp);
 	}
@@ -1024,21 +1228,15 @@ getfile2bp(const char *fname,	/* file name to find */
 #ifdef CAN_CHECK_INO
 	if (global_g_val(GMDUNIQ_BUFS)) {
 	    have_fuid = fileuid_get(nfname, &fuid);
-	    if (have_fuid) {
-		for_each_buffer(bp) {
-		    /* is the same unique file */
-		    if (fileuid_same(bp, &fuid)) {
-			return bp;
-		    }
-		}
+	    /* is the same unique file */
+	    if (have_fuid && (bp = find_b_fuid(&fuid)) != NULL) {
+		return bp;
 	    }
 	}
 #endif
-	for_each_buffer(bp) {
-	    /* is it here by that filename? */
-	    if (same_fname(nfname, bp, FALSE)) {
-		return bp;
-	    }
+	/* is it here by that filename? */
+	if ((bp = find_b_fname(nfname)) != NULL) {
+	    return bp;
 	}
 
 	/* it's not here */
@@ -1178,8 +1376,9 @@ strip_if_dosmode(BUFFER *bp)
 		if ((chr == '\r')
 		    || (len == 1 && chr == '\032')) {
 		    if (b_val(bp, MDUNDO_DOS_TRIM)) {
-			CopyForUndo(lp);
+			CopyPartForUndo(lp, len - 1, 1);
 		    }
+		    lsetlexdirty(lp);
 		    llength(lp)--;
 		    flag = TRUE;
 		}
@@ -1334,26 +1533,33 @@ guess_recordseparator(BUFFER *bp, UCHAR * buffer, B_COUNT length, L_NUM * lines)
     B_COUNT count_cr = 0;
     B_COUNT count_dos = 0;	/* CRLF's */
     B_COUNT count_unix = 0;	/* LF's w/o preceding CR */
-    B_COUNT n;
+    UCHAR *last = buffer + length;
+    UCHAR *next;
     RECORD_SEP result;
 
+    /*
+     * Use memchr() rather than testing each character, since it is much
+     * faster on large files.
+     */
     *lines = 0;
-    for (n = 0; n < length; ++n) {
-	switch (buffer[n]) {
-	case '\r':
-	    ++count_cr;
-	    break;
-	case '\n':
-	    ++count_lf;
-	    if (n != 0) {
-		if (buffer[n - 1] == '\r')
-		    ++count_dos;
-		else
-		    ++count_unix;
-	    }
-	    break;
+    for (next = buffer;
+	 (next < last)
+	 && (next = (UCHAR *) memchr(next, '\n', (size_t) (last - next))) != NULL;
+	 ++next) {
+	++count_lf;
+	if (next != buffer) {
+	    if (next[-1] == '\r')
+		++count_dos;
+	    else
+		++count_unix;
 	}
     }
+    for (next = buffer;
+	 (next < last)
+	 && (next = (UCHAR *) memchr(next, '\r', (size_t) (last - next))) != NULL;
+	 ++next) {
+	++count_cr;
+    }
 
     TRACE(("guess_recordseparator assume %s, rs=%s CR:%ld, LF:%ld, CRLF:%ld\n",
 	   global_b_val(MDDOS) ? "dos" : "unix",
@@ -1401,35 +1607,273 @@ static B_COUNT
 next_recordseparator(UCHAR * buffer, B_COUNT length, RECORD_SEP rscode,
 		     B_COUNT offset)
 {
-    B_COUNT result = offset;
-    B_COUNT n;
-    int done = FALSE;
+    B_COUNT result = length;
+    UCHAR *next;
 
-    for (n = offset; !done && (n < length); ++n) {
-	switch (buffer[n]) {
-	case '\r':
-	    if (rscode == RS_CR) {
-		result = n + 1;
-		done = TRUE;
-	    }
+    if (offset < length
+	&& (next = (UCHAR *) memchr(buffer + offset,
+				    (rscode == RS_CR) ? '\r' : '\n',
+				    (size_t) (length - offset))) != NULL) {
+	result = (B_COUNT) (next - buffer) + 1;
+    }
+    return result;
+}
+
+#if OPT_LAZY_READER
+#define LAZY_FIRST	((B_COUNT) 0x10000)	/* read this much before showing */
+#define LAZY_CHUNK	((B_COUNT) 0x100000)	/* ...and the rest in this size */
+
+/*
+ * Check if the first part of a file is plain enough that the rest can be read
+ * later:  no byte order mark or other encoding which must be decoded as a
+ * whole, and only newlines for record separators.
+ */
+static int
+lazyreadf_usable(BUFFER *bp, UCHAR * buffer, B_COUNT length)
+{
+    int rc = (buffer[0] < 0x80
+	      && memchr(buffer, '\n', (size_t) length) != NULL
+	      && memchr(buffer, '\r', (size_t) length) == NULL
+	      && memchr(buffer, '\0', (size_t) length) == NULL);
+
+#if OPT_ENCRYPT
+    if (b_val(bp, MDCRYPT))
+	rc = FALSE;
+#endif
+#if OPT_MULTIBYTE
+    if (b_val(bp, VAL_FILE_ENCODING) == enc_UTF16
+	|| b_val(bp, VAL_FILE_ENCODING) == enc_UTF32)
+	rc = FALSE;
+#else
+    (void) bp;
+#endif
+    return rc;
+}
+
+/*
+ * Append a line for each newline in the text read so far.  Text past the last
+ * newline waits for the next chunk, unless the whole file has been read.
+ */
+static int
+lazyreadf_split(BUFFER *bp)
+{
+    UCHAR *buffer = bp->b_ltext;
+    B_COUNT length = bp->b_lazy_read;
+    B_COUNT offset = bp->b_lazy_split;
+    int whole = (buffer + length == bp->b_ltext_end);
+    int rc = TRUE;
+
+    beginDisplay();
+    while (offset < length) {
+	UCHAR *next = (UCHAR *) memchr(buffer + offset, '\n',
+				       (size_t) (length - offset));
+	B_COUNT end = (next != NULL) ? (B_COUNT) (next - buffer) : length;
+	LINE *lp;
+
+	if (next == NULL && !whole)
 	    break;
-	case '\n':
-	    if (rscode == RS_CRLF || rscode == RS_LF) {
-		result = n + 1;
-		done = TRUE;
-	    }
+	if ((lp = lalloc(0, bp)) == NULL) {
+	    rc = FALSE;
 	    break;
 	}
+	llength(lp) = (C_NUM) (end - offset);
+	lp->l_size = (size_t) llength(lp) + 1;
+	lvalue(lp) = (char *) (buffer + offset);
+	set_lforw(lback(buf_head(bp)), lp);
+	set_lback(lp, lback(buf_head(bp)));
+	set_lforw(lp, buf_head(bp));
+	set_lback(buf_head(bp), lp);
+	bp->b_linecount += 1;
+	offset = end + 1;
+    }
+    if (offset > length)
+	offset = length;
+    bp->b_lazy_split = offset;
+    lindex_clear(bp);
+    endofDisplay();
+    return rc;
+}
+
+/*
+ * Read another chunk of a file which was read lazily, and split it into lines.
+ * When the file is done, close it and finish what readin() left undone.
+ */
+static void
+lazyreadf_step(BUFFER *bp)
+{
+    UCHAR *buffer = bp->b_ltext;
+    B_COUNT length = (B_COUNT) (bp->b_ltext_end - buffer);
+    B_COUNT want = length - bp->b_lazy_read;
+    B_COUNT have = 0;
+    int rc = FIOSUC;
+
+    TRACE((T_CALLED "lazyreadf_step(%s) %lu of %lu\n",
+	   bp->b_bname, (unsigned long) bp->b_lazy_read, (unsigned long) length));
+
+    if (want > LAZY_CHUNK)
+	want = LAZY_CHUNK;
+    if (ffreadmore(bp->b_lazyfp, (char *) (buffer + bp->b_lazy_read),
+		   want, &have) < 0
+	|| have != want) {
+	/* the file was truncated while we were reading it */
+	bp->b_ltext_end = buffer + bp->b_lazy_read + have;
+	rc = FIOERR;
+    }
+    bp->b_lazy_read += have;
+    if (!lazyreadf_split(bp)) {
+	bp->b_ltext_end = buffer + bp->b_lazy_split;
+	rc = FIOMEM;
+    }
+
+    if (buffer + bp->b_lazy_read >= bp->b_ltext_end) {
+	(void) fclose(bp->b_lazyfp);
+	bp->b_lazyfp = NULL;
+	if (bp->b_ltext_end == buffer
+	    || bp->b_ltext_end[-1] != '\n') {
+	    set_b_val(bp, MDNEWLINE, FALSE);
+	}
+	bp->b_lines_on_disk = bp->b_linecount;
+	b_clr_counted(bp);
+	markWFMODE(bp);
+	if (rc == FIOERR) {
+	    mlwarn("[File %s was truncated while reading]", bp->b_fname);
+	} else {
+	    readlinesmsg(bp->b_linecount, rc, bp->b_fname, ffronly(bp->b_fname));
+	}
     }
-    if (!done)
-	result = length;
-    return result;
+    returnVoid();
+}
+
+/*
+ * Read the rest of the given buffer's file, e.g., before running a command
+ * which may look at all of its lines.
+ */
+void
+lazyreadf_finish(BUFFER *bp)
+{
+    if (valid_buffer(bp)) {
+	while (lazyreadf_pending(bp))
+	    lazyreadf_step(bp);
+    }
+}
+
+void
+lazyreadf_finish_all(void)
+{
+    BUFFER *bp;
+
+    for_each_buffer(bp) {
+	lazyreadf_finish(bp);
+    }
+}
+
+/*
+ * Read the files which are pending, a chunk at a time, until a key is typed.
+ * Return true if there is more to read.
+ */
+int
+lazyreadf_idle(void)
+{
+    BUFFER *bp;
+    int pending = FALSE;
+
+    for_each_buffer(bp) {
+	while (lazyreadf_pending(bp) && !keystroke_avail()) {
+	    lazyreadf_step(bp);
+	    if (!lazyreadf_pending(bp))
+		(void) update(FALSE);
+	}
+	if (lazyreadf_pending(bp))
+	    pending = TRUE;
+    }
+    return pending;
+}
+
+/*
+ * Start a lazy read, given the first part of the file.  Only the lines which
+ * it completes are built now.
+ */
+static int
+lazyreadf_start(BUFFER *bp, UCHAR * buffer, B_COUNT request, B_COUNT length,
+		int *nlinep)
+{
+    int rc = FIOSUC;
+#if OPT_MULTIBYTE
+    B_COUNT first = length;
+    UCHAR *decoded = NULL;
+
+    /* guess the encoding from whole lines, not a split character */
+    while (first != 0 && buffer[first - 1] != '\n')
+	--first;
+    decode_bom(bp, buffer, &first);
+    deduce_charset_block(bp, buffer, &first, &decoded);
+    if (decoded != NULL)	/* not for a file without nulls */
+	free(decoded);
+#endif
+
+    bp->b_ltext = buffer;
+    bp->b_ltext_end = buffer + request;
+    bp->b_lazy_read = length;
+    bp->b_lazy_split = 0;
+    bp->b_bytecount = request;
+    bp->b_linecount = 0;
+    if (lazyreadf_split(bp)) {
+	init_b_traits(bp);
+	set_record_sep(bp, RS_LF);
+	bp->b_lazyfp = ffkeep();
+	*nlinep = bp->b_linecount;
+    } else {
+	rc = FIOMEM;
+    }
+    return rc;
+}
+#endif /* OPT_LAZY_READER */
+
+/*
+ * Read the file into the buffer allocated by quickreadf(), returning the
+ * number of bytes wanted, or zero on error.  That is the whole file, unless
+ * reader-policy "lazy" lets us read only the first part now.
+ */
+static B_COUNT
+quickreadf_fill(BUFFER *bp, UCHAR * buffer, B_COUNT request, B_COUNT * length)
+{
+    B_COUNT want = request;
+
+#if OPT_LAZY_READER
+    if (global_g_val(GVAL_READER_POLICY) == RP_LAZY
+	&& lazy_readin
+	&& request > LAZY_CHUNK) {
+	B_COUNT more;
+
+	if (ffread((char *) buffer, LAZY_FIRST, length) < 0) {
+	    want = 0;
+	} else if (*length == LAZY_FIRST
+		   && lazyreadf_usable(bp, buffer, *length)) {
+	    want = LAZY_FIRST;
+	} else if (ffread((char *) (buffer + *length),
+			  request - *length, &more) < 0) {
+	    want = 0;
+	} else {
+	    *length += more;
+	}
+	return want;
+    }
+#else
+    (void) bp;
+#endif
+    if (ffread((char *) buffer, request, length) < 0)
+	want = 0;
+    return want;
 }
 
 /*
  * If reading from an external file, read the whole file into memory at once
  * and split it into lines.  That is potentially much faster than allocating
  * each line separately.
+ *
+ * With reader-policy "lazy", only the first part of a large file is read and
+ * split into lines here.  The rest is read into the same block later, while
+ * waiting for keys, or before the next command.
  */
 static int
 quickreadf(BUFFER *bp, int *nlinep)
@@ -1438,14 +1882,15 @@ quickreadf(BUFFER *bp, int *nlinep)
     B_COUNT request;
     B_COUNT offset;
     LINE *lp;
-    L_NUM lineno = 0;
     L_NUM nlines;
     RECORD_SEP rscode;
+    B_COUNT want;
     UCHAR *buffer;
+#if OPT_MULTIBYTE
+    UCHAR *decoded = NULL;
+#endif
     int rc;
 
-    (void) lineno;
-
     TRACE((T_CALLED "quickreadf(buffer=%s, file=%s)\n", bp->b_bname, bp->b_fname));
 
     beginDisplay();
@@ -1463,7 +1908,7 @@ quickreadf(BUFFER *bp, int *nlinep)
 	free(buffer);
     }
 #endif
-    else if (ffread((char *) buffer, request, &length) < 0
+    else if ((want = quickreadf_fill(bp, buffer, request, &length)) == 0
 #if !SYS_VMS
 	/*
 	 * For most systems, the advertised size of the file will match the
@@ -1471,13 +1916,19 @@ quickreadf(BUFFER *bp, int *nlinep)
 	 * filetypes such as VFC or VAR/CR will return fewer since we are not
 	 * using the structure information.
 	 */
-	     || (length != request)
+	     || (length != want)
 #endif
 	) {
 	free(buffer);
 	mlerror("reading");
 	rc = FIOERR;
-    } else {
+    }
+#if OPT_LAZY_READER
+    else if (want != request) {
+	rc = lazyreadf_start(bp, buffer, request, length, nlinep);
+    }
+#endif
+    else {
 #if OPT_ENCRYPT
 	if (b_val(bp, MDCRYPT)
 	    && bp->b_cryptkey[0]) {	/* decrypt the file */
@@ -1487,7 +1938,11 @@ quickreadf(BUFFER *bp, int *nlinep)
 #endif
 #if OPT_MULTIBYTE
 	decode_bom(bp, buffer, &length);
-	deduce_charset(bp, buffer, &length, TRUE);
+	deduce_charset_block(bp, buffer, &length, &decoded);
+	if (decoded != NULL) {
+	    free(buffer);
+	    buffer = decoded;
+	}
 #endif
 
 	/*
@@ -1525,7 +1980,7 @@ quickreadf(BUFFER *bp, int *nlinep)
 		    break;
 		}
 #if !SMALLER
-		lp->l_number = ++lineno;
+		lp->l_chunk = NULL;
 #endif
 		llength(lp) = (C_NUM) (next - offset - 1);
 		if (!b_val(bp, MDNEWLINE) && next == length)
@@ -1536,11 +1991,15 @@ quickreadf(BUFFER *bp, int *nlinep)
 		if (lp != bp->b_LINEs)
 		    set_lback(lp, lp - 1);
 		lsetclear(lp);
+		lsetlexstale(lp);
 		lp->l_nxtundo = NULL;
 #if OPT_LINE_ATTRS
 		lp->l_attrs = NULL;
 #endif
-		decode_charset(bp, lp);
+#if OPT_MULTIBYTE
+		if (decoded == NULL)
+		    decode_charset(bp, lp);
+#endif
 		offset = next;
 	    }
 	    if (lp != bp->b_LINEs)
@@ -1553,6 +2012,7 @@ quickreadf(BUFFER *bp, int *nlinep)
 	    /* connect the front of the list */
 	    set_lback(bp->b_LINEs, buf_head(bp));
 	    set_lforw(buf_head(bp), bp->b_LINEs);
+	    lindex_clear(bp);
 
 	    init_b_traits(bp);
 
@@ -1672,7 +2132,8 @@ readin(char *fname, int lockfl, BUFFER *bp, int mflg)
 	    s = quickreadf(bp, &nline);
 	    if (s == FIONUL
 		|| (s == FIOMEM
-		    && global_g_val(GVAL_READER_POLICY) == RP_BOTH))
+		    && (global_g_val(GVAL_READER_POLICY) == RP_BOTH
+			|| global_g_val(GVAL_READER_POLICY) == RP_LAZY)))
 		s = slowreadf(bp, &nline);
 	}
 
@@ -1691,7 +2152,7 @@ readin(char *fname, int lockfl, BUFFER *bp, int mflg)
 		set_febuff(bp->b_bname);
 #endif
 	    (void) ffclose();	/* Ignore errors.       */
-	    if (mflg)
+	    if (mflg && !lazyreadf_pending(bp))
 		readlinesmsg(nline, s, fname, ffronly(fname));
 
 	    if (ffronly(fname)) {
@@ -1700,6 +2161,9 @@ readin(char *fname, int lockfl, BUFFER *bp, int mflg)
 
 	    bp->b_active = TRUE;
 	    bp->b_lines_on_disk = bp->b_linecount;
+#if OPT_UNDOFILE
+	    read_undo_file(bp);
+#endif
 	}
 
     }
@@ -2363,6 +2827,10 @@ actually_write(REGION * rp, char *fn, int msgf, BUFFER *bp, int forced, int enco
 
 #ifdef MDCHK_MODTIME
     set_modtime(bp, fn);
+#endif
+#if OPT_UNDOFILE
+    if (whole_file && same_fname(fn, bp, FALSE))
+	write_undo_file(bp);
 #endif
     fileuid_set_if_valid(bp, fn);
     /*
@@ -2830,6 +3298,77 @@ create_save_dir(char *dirnam)
     return result;
 }
 
+#if OPT_UNDOFILE
+/*
+ * The undo-history for a file is kept in the buffer's "undo-directory", named
+ * by the file's full pathname with its slashes replaced by "%".
+ */
+static char *
+undo_file_path(BUFFER *bp, char *result, int create)
+{
+    char dirnam[NFILEN];
+    char leaf[NFILEN];
+    char *s;
+
+    if (!valid_buffer(bp)
+	|| no_file_name(bp->b_fname)
+	|| isInternalName(bp->b_fname)
+	|| isShellOrPipe(bp->b_fname)
+	|| (s = b_val_ptr(bp, VAL_UNDODIR)) == NULL
+	|| *s == EOS)
+	return NULL;
+
+    (void) lengthen_path(vl_strncpy(dirnam, s, sizeof(dirnam)));
+    if (!is_directory(dirnam)) {
+	int ok = FALSE;
+#if defined(HAVE_MKDIR)
+	if (create) {
+	    mode_t omask = vl_umask(0077);
+	    ok = (vl_mkdir(dirnam, 0700) == 0);
+	    (void) vl_umask(omask);
+	}
+#endif
+	if (!ok)
+	    return NULL;
+    }
+
+    (void) lengthen_path(vl_strncpy(leaf, bp->b_fname, sizeof(leaf)));
+    for (s = leaf; *s != EOS; ++s) {
+	if (is_slashc(*s) || *s == ':')
+	    *s = '%';
+    }
+    return pathcat(result, dirnam, leaf);
+}
+
+FILE *
+open_undo_file(BUFFER *bp, int writing)
+{
+    char path[NFILEN];
+    FILE *fp = NULL;
+
+    if (undo_file_path(bp, path, writing) != NULL) {
+	if (writing) {
+	    mode_t omask = vl_umask(0077);
+	    if ((fp = fopen(SL_TO_BSL(path), FOPEN_WRITE)) == NULL)
+		mlwarn("[Cannot write undo-file %s]", path);
+	    (void) vl_umask(omask);
+	} else {
+	    fp = fopen(SL_TO_BSL(path), FOPEN_READ);
+	}
+    }
+    return fp;
+}
+
+void
+remove_undo_file(BUFFER *bp)
+{
+    char path[NFILEN];
+
+    if (undo_file_path(bp, path, FALSE) != NULL)
+	(void) unlink(SL_TO_BSL(path));
+}
+#endif /* OPT_UNDOFILE */
+
 #if SYS_UNIX
 static const char *mailcmds[] =
 {
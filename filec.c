@@ -187,6 +187,7 @@ makeString(BUFFER *bp, LINE *lp, char *text, size_t len)
 	set_lback(np, lback(lp));
 	set_lback(lp, np);
 	set_lforw(np, lp);
+	lindex_insert(bp, np);
 	lp = np;
     }
     endofDisplay();
@@ -534,6 +535,7 @@ sortMyBuff(BUFFER *bp)
 	    lp = buf_head(bp);
 	    set_lforw(plp, lp);
 	    set_lback(lp, plp);
+	    lindex_clear(bp);
 	    remove_duplicates(bp);
 	    b_clr_counted(bp);
 
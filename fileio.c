@@ -634,8 +634,8 @@ ffexists(char *p)
 #define LONG_MAX (((unsigned long)(~0)) >> 1)
 #endif
 
-int
-ffread(char *buf, B_COUNT want, B_COUNT * have)
+static int
+ffread_from(FILE *fp, char *buf, B_COUNT want, B_COUNT * have)
 {
     int result = 0;
     long got;
@@ -655,9 +655,9 @@ ffread(char *buf, B_COUNT want, B_COUNT * have)
 
 #if FFREAD_FREAD
 	    /* size_t may not fit in long, making a sign-extension */
-	    got = (long) fread(buf + *have, 1, ask, ffp);
+	    got = (long) fread(buf + *have, 1, ask, fp);
 #else
-	    got = read(fileno(ffp), buf + *have, ask);
+	    got = read(fileno(fp), buf + *have, ask);
 #endif
 	    if (got <= 0)
 		break;
@@ -670,6 +670,33 @@ ffread(char *buf, B_COUNT want, B_COUNT * have)
     return result;
 }
 
+int
+ffread(char *buf, B_COUNT want, B_COUNT * have)
+{
+    return ffread_from(ffp, buf, want, have);
+}
+
+#if OPT_LAZY_READER
+/*
+ * Take over the file which is open for reading, so that the rest of it can be
+ * read later with ffreadmore().  ffclose() will not close it.
+ */
+FILE *
+ffkeep(void)
+{
+    FILE *result = ffp;
+
+    ffp = NULL;
+    return result;
+}
+
+int
+ffreadmore(FILE *fp, char *buf, B_COUNT want, B_COUNT * have)
+{
+    return ffread_from(fp, buf, want, have);
+}
+#endif /* OPT_LAZY_READER */
+
 void
 ffseek(B_COUNT n)
 {
@@ -745,6 +772,47 @@ ffclose(void)
     return (FIOSUC);
 }
 
+/*
+ * Write a block of text to the already opened file.  Unlike ffputc(), this
+ * checks for errors once per block, and encrypts the text a chunk at a time.
+ */
+static int
+ffputblok(const char *buf, size_t nbuf)
+{
+    int status = FIOSUC;
+
+    if (i_am_dead) {
+	while (nbuf-- != 0) {
+	    if ((status = ffputc(CharOf(*buf++))) != FIOSUC)
+		break;
+	}
+    } else if (nbuf != 0) {
+#if OPT_ENCRYPT
+	if (ffcrypting && (ffstatus != file_is_pipe)) {
+	    char chunk[BUFSIZ];
+
+	    while (nbuf != 0) {
+		size_t part = (nbuf > sizeof(chunk)) ? sizeof(chunk) : nbuf;
+
+		memcpy(chunk, buf, part);
+		vl_encrypt_blok(chunk, (UINT) part);
+		if (fwrite(chunk, sizeof(char), part, ffp) != part)
+		    break;
+		buf += part;
+		nbuf -= part;
+	    }
+	} else
+#endif
+	    (void) fwrite(buf, sizeof(char), nbuf, ffp);
+
+	if (ferror(ffp)) {
+	    mlerror("writing");
+	    status = FIOERR;
+	}
+    }
+    return status;
+}
+
 /*
  * Write a line to the already opened file. The "buf" points to the buffer,
  * and the "nbuf" is its length, less the free newline. Return the status.
@@ -752,28 +820,28 @@ ffclose(void)
 int
 ffputline(const char *buf, int nbuf, const char *ending)
 {
-    int i = 0;
-
-    if (buf != NULL) {
-	for (i = 0; i < nbuf; ++i)
-	    if (ffputc(CharOf(buf[i])) == FIOERR)
-		return FIOERR;
-    }
-
-    if (ending != NULL) {
-	while (*ending != EOS) {
-	    if (*ending != '\r' || i == 0 || buf[i - 1] != '\r')
-		ffputc(*ending);
+    int status = FIOSUC;
+
+    if (buf != NULL && nbuf > 0)
+	status = ffputblok(buf, (size_t) nbuf);
+
+    if (status == FIOSUC && ending != NULL) {
+	char temp[NSTRING];
+	size_t len = 0;
+
+	/* do not repeat a carriage-return which ends the line */
+	while (*ending != EOS && len < sizeof(temp)) {
+	    if (*ending != '\r'
+		|| buf == NULL
+		|| nbuf <= 0
+		|| buf[nbuf - 1] != '\r')
+		temp[len++] = *ending;
 	    ending++;
 	}
+	status = ffputblok(temp, len);
     }
 
-    if (ffp != NULL && ferror(ffp)) {
-	mlerror("writing");
-	return (FIOERR);
-    }
-
-    return (FIOSUC);
+    return status;
 }
 
 /*
@@ -505,6 +505,24 @@ parse_prepro(char *s, int *literal)
     return tt;
 }
 
+/*
+ * Everything which carries from one line to the next, so that the filter can
+ * resume at a line whose starting state was recorded.
+ */
+#define PackState() \
+	((comment << 11) \
+	 | (CharOf(literal) << 3) \
+	 | (verbatim ? 4 : 0) \
+	 | (was_esc ? 2 : 0) \
+	 | (maybeRX ? 1 : 0))
+
+#define UnpackState(state) \
+	comment = ((state) >> 11); \
+	literal = (((state) >> 3) & 0xff); \
+	verbatim = (((state) & 4) != 0); \
+	was_esc = (((state) & 2) != 0); \
+	maybeRX = ((state) & 1)
+
 static void
 init_filter(int before GCC_UNUSED)
 {
@@ -526,6 +544,7 @@ do_filter(FILE *input GCC_UNUSED)
     int maybeRX;
     int was_esc;
     unsigned len;
+    int state;
 
     (void) input;
 
@@ -543,7 +562,14 @@ do_filter(FILE *input GCC_UNUSED)
     maybeRX = 0;
     was_esc = 0;
 
-    while (flt_gets(&line, &used) != NULL) {
+    if (flt_get_state(&state)) {
+	UnpackState(state);
+    }
+
+    for (;;) {
+	flt_set_state(PackState());
+	if (flt_gets(&line, &used) == NULL)
+	    break;
 	escaped = was_esc;
 	was_esc = 0;
 	s = line;
@@ -183,6 +183,22 @@ flt_get_col(void)
     return my_col;
 }
 
+/*
+ * External filters always read their input from the beginning.
+ */
+int
+flt_get_state(int *state GCC_UNUSED)
+{
+    (void) state;
+    return 0;
+}
+
+void
+flt_set_state(int state GCC_UNUSED)
+{
+    (void) state;
+}
+
 int
 flt_succeeds(void)
 {
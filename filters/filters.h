@@ -349,10 +349,12 @@ extern const void *vl_lookup_cmd(const char *name);
 extern int chop_newline(char *s);
 extern int flt_get_col(void);
 extern int flt_get_line(void);
+extern int flt_get_state(int *state);
 extern int flt_input(char *buffer, int max_size);
 extern int flt_lookup(char *name);
 extern int flt_restart(char *name);
 extern int flt_start(char *name);
+extern int flt_update(char *name);
 extern int vl_check_cmd(const void *cmd, unsigned long flags);
 extern int vl_is_majormode(const void *cmd);
 extern int vl_is_setting(const void *cmd);
@@ -368,6 +370,7 @@ extern void flt_finish(void);
 extern void flt_message(const char *fmt, ...) VILE_PRINTF(1,2);
 extern void flt_putc(int ch);
 extern void flt_puts(const char *string, int length, const char *attribute);
+extern void flt_set_state(int state);
 
 /* potential symbol conflict with ncurses */
 #define define_key vl_define_key
@@ -377,7 +377,7 @@ convert_pattern(ERR_PATTERN * errp, LINE *lp)
 		   get_token_name((ErrTokens) word)));
 #endif
 	TPRINTF(("-> %s\n", temp));
-	exp = regcomp(temp, strlen(temp), TRUE);
+	exp = regcomp_cached(temp, strlen(temp), TRUE);
 	/* FIXME:  this might be null if the pattern was incorrect, or if we
 	 * ran out of memory.  We only want the latter condition.
 	 */
@@ -33,6 +33,7 @@ globber(int f GCC_UNUSED, int n GCC_UNUSED, int g_or_v)
     char cmd[NLINE];
     const CMDFUNC *cfp;
     int foundone;
+    L_NUM marked;		/* lines marked, but not yet visited */
     int status;
     WINDOW *wp, *sw_wp;
     L_NUM before;
@@ -69,9 +70,13 @@ globber(int f GCC_UNUSED, int n GCC_UNUSED, int g_or_v)
 
     calledbefore = FALSE;
 
-    if (g_or_v == 'v') {	/* invert the sense of all the matches */
-	for_each_line(lp, curbp)
+    /* count the marked lines, inverting the sense of the matches for 'v' */
+    marked = 0;
+    for_each_line(lp, curbp) {
+	if (g_or_v == 'v')
 	    lflipmark(lp);
+	if (lismarked(lp))
+	    ++marked;
     }
     /* loop through the buffer -- we must clear the marks no matter what */
     s = TRUE;
@@ -81,7 +86,7 @@ globber(int f GCC_UNUSED, int n GCC_UNUSED, int g_or_v)
     foundone = FALSE;
     before = vl_line_count(curbp);
     save_report = global_g_val(GVAL_REPORT);
-    while (lp != NULL) {
+    while (lp != NULL && marked > 0) {
 	if (lp == win_head(wp)) {
 	    /* at the end -- only quit if we found no
 	       marks on the last pass through. otherwise,
@@ -95,6 +100,7 @@ globber(int f GCC_UNUSED, int n GCC_UNUSED, int g_or_v)
 	if (lismarked(lp)) {
 	    foundone = TRUE;
 	    lsetnotmarked(lp);
+	    --marked;
 	    /* call the function, if there is one, and results
 	       have been ok so far */
 	    if (cfp && s) {
@@ -116,6 +122,13 @@ globber(int f GCC_UNUSED, int n GCC_UNUSED, int g_or_v)
 		lp = wp->w_dot.l;
 		havemotion = NULL;
 		calledbefore = TRUE;
+		/*
+		 * If the function left us on a marked line, e.g., the one
+		 * after a deleted line, do that next rather than skipping it
+		 * until another pass through the buffer.
+		 */
+		if (lismarked(lp))
+		    continue;
 	    }
 	}
 	lp = lforw(lp);
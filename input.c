@@ -2217,6 +2217,13 @@ kbd_reply(const char *prompt,	/* put this out first */
 	if ((c == 0 && c != esc_c) && !(options & KBD_0CHAR))
 	    continue;
 
+	/*
+	 * Ignore the brackets around pasted text (xterm-paste mode).  The
+	 * text itself is read as if it were typed, as xvile does.
+	 */
+	if ((c == KEY_Paste || c == KEY_PasteEnd) && !quotef)
+	    continue;
+
 	/* if we echoed ^V, erase it now */
 	if (quotef) {
 	    firstch = FALSE;
@@ -1550,6 +1550,95 @@ quote_next(int f, int n)
     return s;
 }
 
+#if OPT_XTERM || DISP_X11
+/*
+ * Add a pasted character to the text to insert, encoding it for the current
+ * buffer as lins_chars() would.
+ */
+static int
+add_pasted_char(TBUFF **tb, int c)
+{
+#if OPT_MULTIBYTE
+    if ((c > 127) && b_is_utfXX(curbp)) {
+	UCHAR target[MAX_UTF8];
+	int nbytes = vl_conv_to_utf8(target, (UINT) c, sizeof(target));
+
+	return (tb_bappend(tb, (char *) target, (size_t) nbytes) != NULL);
+    } else if (okCTYPE2(vl_wide_enc) && !vl_mb_is_8bit(c)) {
+	int mapped;
+
+	if (vl_ucs_to_8bit(&mapped, c))
+	    c = mapped;
+    }
+#endif
+    return (tb_append(tb, c) != NULL);
+}
+
+/*
+ * Insert the text which follows KEY_Paste, up to KEY_PasteEnd.  Those come
+ * from xterm's bracketed-paste sequences, or from xvile when it pastes a
+ * selection.  The text is inserted literally in one operation rather than
+ * typed, so that autoindent, abbreviations and wrapping do not apply to it,
+ * and a carriage return is treated as the end of a line.
+ */
+/* ARGSUSED */
+int
+ins_pasted(int f GCC_UNUSED, int n GCC_UNUSED)
+{
+    TBUFF *pasted = NULL;
+    int was_inserting = insertmode;
+    int status = TRUE;
+    int last = EOS;
+    int c;
+
+    TRACE((T_CALLED "ins_pasted\n"));
+
+    /*
+     * If the text was not recorded along with KEY_Paste, e.g., when repeating
+     * an insertion, there is nothing to paste.
+     */
+    if (!keystroke_avail()) {
+	(void) catnap(global_g_val(GVAL_TIMEOUTVAL), TRUE);
+	if (!keystroke_avail())
+	    returnCode(FALSE);
+    }
+
+    if (tb_init(&pasted, EOS) == NULL)
+	returnCode(FALSE);
+
+    /* read multibyte characters whole, cf. sysmapped_c() */
+    if (!insertmode)
+	insertmode = INSMODE_INS;
+
+    while ((c = keystroke()) != KEY_PasteEnd) {
+	if (c == '\n' && last == '\r') {
+	    last = c;
+	    continue;
+	}
+	last = c;
+	if (c == '\r')
+	    c = '\n';
+	else if (isSpecial(c))
+	    continue;
+	if (status == TRUE && !add_pasted_char(&pasted, c))
+	    status = FALSE;
+    }
+    insertmode = was_inserting;
+
+    if (status == TRUE && tb_length(pasted) != 0) {
+	TRACE(("...pasting %lu bytes\n", (ULONG) tb_length(pasted)));
+	status = lins_text(tb_values(pasted), tb_length(pasted));
+	/* leave dot on the last character, as if ending an insert */
+	if (status == TRUE
+	    && !insertmode
+	    && DOT.o > w_left_margin(curwp))
+	    backchar(TRUE, 1);
+    }
+    tb_free(&pasted);
+    returnCode(status);
+}
+#endif
+
 #if OPT_EVAL
 const char *
 current_modename(void)
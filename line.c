@@ -55,6 +55,60 @@ do_report(L_NUM value)
 	    && global_g_val(GVAL_REPORT) <= value);
 }
 
+#define ARENA_ALIGN	sizeof(ARENA_BLK)
+#define arena_round(n)	((((n) + ARENA_ALIGN - 1) / ARENA_ALIGN) * ARENA_ALIGN)
+
+/*
+ * Carve a chunk from the newest block of the buffer's arena, adding a block
+ * if there is not enough left in that one.
+ */
+static void *
+arena_carve(ARENA * ap, size_t size)
+{
+    char *result;
+
+    if (ap->a_next == NULL || (size_t) (ap->a_last - ap->a_next) < size) {
+	ARENA_BLK *blk = (ARENA_BLK *) malloc((size_t) ARENA_BLOCK);
+
+	if (blk == NULL)
+	    return NULL;
+	TRACE2(("arena_carve new block %p\n", (void *) blk));
+	blk->ab_next = ap->a_blocks;
+	ap->a_blocks = blk;
+	ap->a_nblocks += 1;
+	ap->a_next = (char *) (blk + 1);
+	ap->a_last = (char *) blk + ARENA_BLOCK;
+    }
+    result = ap->a_next;
+    ap->a_next += size;
+    return (void *) result;
+}
+
+static void
+arena_release(ARENA * ap)
+{
+    ARENA_BLK *blk;
+
+    while ((blk = ap->a_blocks) != NULL) {
+	ap->a_blocks = blk->ab_next;
+	free(blk);
+    }
+    memset(ap, 0, sizeof(*ap));
+}
+
+static int
+arena_class(size_t size)
+{
+    int result = 0;
+    size_t have = NBLOCK;
+
+    while (have < size) {
+	have <<= 1;
+	++result;
+    }
+    return result;
+}
+
 static LINE *
 alloc_LINE(BUFFER *bp)
 {
@@ -62,15 +116,61 @@ alloc_LINE(BUFFER *bp)
 
     if (lp != NULL) {
 	bp->b_freeLINEs = lp->l_nxtundo;
-    } else {
+    } else if (buf_head(bp) == NULL) {
+	/* the header line outlives the arena */
 	if ((lp = typealloc(LINE)) == NULL) {
 	    (void) no_memory("LINE");
 	}
+    } else {
+	lp = (LINE *) arena_carve(&(bp->b_arena), arena_round(sizeof(LINE)));
+	if (lp == NULL) {
+	    (void) no_memory("LINE");
+	} else {
+	    bp->b_arena.a_lines += 1;
+	}
 	TRACE2(("alloc_LINE %p\n", lp));
     }
     return lp;
 }
 
+/*
+ * Allocate text for a line, at least "*sizep" bytes.  Short text comes from
+ * the buffer's arena, rounded up to its size-class; "*sizep" is updated to
+ * the actual size, which the caller stores in l_size so that ltextfree()
+ * can find the class again.  Return NULL if there is no memory left.
+ */
+char *
+ltextalloc(BUFFER *bp, size_t *sizep)
+{
+    ARENA *ap = &(bp->b_arena);
+    size_t size = *sizep;
+    char *result;
+
+    beginDisplay();
+    if (size > ARENA_TEXTMAX) {
+	if ((result = castalloc(char, size)) != NULL) {
+	    ap->a_large += 1;
+	    ap->a_large_bytes += size;
+	}
+    } else {
+	int n = arena_class(size);
+
+	size = ((size_t) NBLOCK << n);
+	if ((result = (char *) ap->a_free[n]) != NULL) {
+	    ap->a_free[n] = *(void **) ap->a_free[n];
+	    ap->a_idle[n] -= 1;
+	} else {
+	    result = (char *) arena_carve(ap, size);
+	}
+	if (result != NULL) {
+	    ap->a_used[n] += 1;
+	    *sizep = size;
+	}
+    }
+    endofDisplay();
+    return result;
+}
+
 /*
  * This routine allocates a block of memory large enough to hold a LINE
  * containing "used" characters. The block is always rounded up a bit. Return
@@ -93,17 +193,21 @@ lalloc(int used, BUFFER *bp)
     }
     if ((lp = alloc_LINE(bp)) != NULL) {
 	lvalue(lp) = NULL;
-	if (size && (lvalue(lp) = castalloc(char, size)) == NULL) {
+	if (size && (lvalue(lp) = ltextalloc(bp, &size)) == NULL) {
 	    (void) no_memory("LINE text");
 	    poison(lp, sizeof(*lp));
-	    FreeAndNull(lp);
+	    lp->l_nxtundo = bp->b_freeLINEs;
+	    bp->b_freeLINEs = lp;
+	    lp = NULL;
 	} else {
 	    lp->l_size = size;
 #if !SMALLER
 	    lp->l_number = 0;
+	    lp->l_chunk = NULL;
 #endif
 	    llength(lp) = used;
 	    lsetclear(lp);
+	    lsetlexstale(lp);
 	    lp->l_nxtundo = NULL;
 #if OPT_LINE_ATTRS
 	    lp->l_attrs = NULL;
@@ -119,17 +223,15 @@ void
 lfree(LINE *lp, BUFFER *bp)
 {
     beginDisplay();
-    if (lisreal(lp))
+    if (lisreal(lp) || lisundodelta(lp))
 	ltextfree(lp, bp);
 
-    /* if the buffer doesn't have its own block of LINEs, or this
-       one isn't in that range, free it */
-    if (!bp->b_LINEs || lp < bp->b_LINEs || lp >= bp->b_LINEs_end) {
+    if (lp == buf_head(bp)) {
 	TRACE2(("lfree(%p)\n", lp));
 	poison(lp, sizeof(*lp));
 	free((char *) lp);
     } else {
-	/* keep track of freed buffer LINEs here */
+	/* LINEs from the arena or quickreadf's block are reused */
 	lp->l_nxtundo = bp->b_freeLINEs;
 	bp->b_freeLINEs = lp;
 #ifdef POISON
@@ -143,6 +245,355 @@ lfree(LINE *lp, BUFFER *bp)
     endofDisplay();
 }
 
+#if !SMALLER
+/*
+ * The line-numbering index groups the lines of a buffer into chunks (see
+ * LINECHUNK).  Each edit which links a line into the buffer or out of it
+ * renumbers only the lines after it in the same chunk, and marks the starting
+ * numbers of the following chunks as stale.  Those are recomputed, a chunk at
+ * a time, when a line-number is next needed.  Chunks which grow past
+ * LCHUNK_MAX lines are split, and those which shrink below LCHUNK_MIN are
+ * merged with a neighbor.
+ *
+ * Code which relinks many lines at once (e.g., sorting or reading a file)
+ * calls lindex_clear, and the index is rebuilt when next needed.
+ */
+#define LCHUNK_MAX 256
+#define LCHUNK_MIN (LCHUNK_MAX / 8)
+
+static LINECHUNK *
+lchunk_alloc(BUFFER *bp, L_NUM inx)
+{
+    LINECHUNK *cp = NULL;
+
+    if (bp->b_lchunks_len >= bp->b_lchunks_max) {
+	L_NUM need = (bp->b_lchunks_max * 2) + 16;
+	LINECHUNK **grown = typereallocn(LINECHUNK *, bp->b_lchunks, need);
+
+	if (grown == NULL)
+	    return NULL;
+	bp->b_lchunks = grown;
+	bp->b_lchunks_max = need;
+    }
+    if ((cp = typealloc(LINECHUNK)) != NULL) {
+	L_NUM n;
+
+	for (n = bp->b_lchunks_len; n > inx; --n) {
+	    bp->b_lchunks[n] = bp->b_lchunks[n - 1];
+	    bp->b_lchunks[n]->lc_index = n;
+	}
+	bp->b_lchunks[inx] = cp;
+	bp->b_lchunks_len += 1;
+	cp->lc_first = NULL;
+	cp->lc_count = 0;
+	cp->lc_index = inx;
+	cp->lc_start = 0;
+	if (bp->b_lchunks_ok > inx)
+	    bp->b_lchunks_ok = inx;
+    }
+    return cp;
+}
+
+static void
+lchunk_free(BUFFER *bp, LINECHUNK * cp)
+{
+    L_NUM n;
+
+    for (n = cp->lc_index; n + 1 < bp->b_lchunks_len; ++n) {
+	bp->b_lchunks[n] = bp->b_lchunks[n + 1];
+	bp->b_lchunks[n]->lc_index = n;
+    }
+    bp->b_lchunks_len -= 1;
+    if (bp->b_lchunks_ok > cp->lc_index)
+	bp->b_lchunks_ok = cp->lc_index;
+    free(cp);
+}
+
+/*
+ * Number the lines of a chunk from the given line and index to its end.
+ */
+static void
+lchunk_number(LINECHUNK * cp, LINE *lp, L_NUM inx)
+{
+    while (inx < cp->lc_count) {
+	lp->l_chunk = cp;
+	lp->l_number = inx++;
+	lp = lforw(lp);
+    }
+}
+
+/*
+ * Move the second half of a chunk's lines to a new chunk after it.
+ */
+static void
+lchunk_split(BUFFER *bp, LINECHUNK * cp)
+{
+    LINECHUNK *np;
+
+    if ((np = lchunk_alloc(bp, cp->lc_index + 1)) != NULL) {
+	L_NUM keep = cp->lc_count / 2;
+	LINE *lp = cp->lc_first;
+	L_NUM n;
+
+	for (n = 0; n < keep; ++n)
+	    lp = lforw(lp);
+	np->lc_first = lp;
+	np->lc_count = cp->lc_count - keep;
+	cp->lc_count = keep;
+	lchunk_number(np, lp, 0);
+    }
+}
+
+/*
+ * Move the lines of a chunk to the end of the one before it.
+ */
+static void
+lchunk_merge(BUFFER *bp, LINECHUNK * cp)
+{
+    LINECHUNK *pp = bp->b_lchunks[cp->lc_index - 1];
+    L_NUM first = pp->lc_count;
+
+    pp->lc_count += cp->lc_count;
+    lchunk_number(pp, cp->lc_first, first);
+    lchunk_free(bp, cp);
+}
+
+/*
+ * Discard the index, e.g., after relinking many lines.
+ */
+void
+lindex_clear(BUFFER *bp)
+{
+    if (bp->b_lchunks != NULL) {
+	L_NUM n;
+
+	beginDisplay();
+	for (n = 0; n < bp->b_lchunks_len; ++n)
+	    free(bp->b_lchunks[n]);
+	FreeAndNull(bp->b_lchunks);
+	endofDisplay();
+    }
+    bp->b_lchunks_len = 0;
+    bp->b_lchunks_max = 0;
+    bp->b_lchunks_ok = 0;
+    bp->b_lchunks_lines = 0;
+}
+
+/*
+ * Build the index if we do not have one, returning false if there is not
+ * enough memory.
+ */
+int
+lindex_check(BUFFER *bp)
+{
+    if (bp->b_lchunks == NULL) {
+	LINECHUNK *cp = NULL;
+	LINE *lp;
+
+	beginDisplay();
+	bp->b_lchunks_len = 0;
+	bp->b_lchunks_max = 0;
+	bp->b_lchunks_ok = 0;
+	bp->b_lchunks_lines = 0;
+	if ((bp->b_lchunks = typeallocn(LINECHUNK *, 16)) != NULL) {
+	    bp->b_lchunks_max = 16;
+	    for_each_line(lp, bp) {
+		if (cp == NULL || cp->lc_count >= LCHUNK_MAX / 2) {
+		    if ((cp = lchunk_alloc(bp, bp->b_lchunks_len)) == NULL) {
+			lindex_clear(bp);
+			break;
+		    }
+		    cp->lc_first = lp;
+		}
+		lp->l_chunk = cp;
+		lp->l_number = cp->lc_count++;
+		bp->b_lchunks_lines += 1;
+	    }
+	}
+	endofDisplay();
+    }
+    return (bp->b_lchunks != NULL);
+}
+
+/*
+ * Return the number of lines before the given chunk, updating the starting
+ * numbers of the chunks before it as needed.
+ */
+static L_NUM
+lchunk_start(BUFFER *bp, LINECHUNK * cp)
+{
+    while (bp->b_lchunks_ok <= cp->lc_index) {
+	L_NUM n = bp->b_lchunks_ok++;
+
+	bp->b_lchunks[n]->lc_start = ((n != 0)
+				      ? (bp->b_lchunks[n - 1]->lc_start
+					 + bp->b_lchunks[n - 1]->lc_count)
+				      : 0);
+    }
+    return cp->lc_start;
+}
+
+/*
+ * Return the number (counting from 1) of a line in the buffer, or zero if
+ * it is not in the index, e.g., the buffer's header line.
+ */
+L_NUM
+lindex_number(BUFFER *bp, LINE *lp)
+{
+    L_NUM result = 0;
+    LINECHUNK *cp = lp->l_chunk;
+
+    if (lindex_check(bp)
+	&& cp != NULL
+	&& cp->lc_index < bp->b_lchunks_len
+	&& bp->b_lchunks[cp->lc_index] == cp) {
+	result = lchunk_start(bp, cp) + lp->l_number + 1;
+    }
+    return result;
+}
+
+/*
+ * Return the line with the given number (counting from 1), or null if there
+ * is none.
+ */
+LINE *
+lindex_line(BUFFER *bp, L_NUM num)
+{
+    LINE *result = NULL;
+
+    if (lindex_check(bp)
+	&& num > 0
+	&& num <= bp->b_lchunks_lines) {
+	L_NUM lo = 0;
+	L_NUM hi = bp->b_lchunks_len - 1;
+	LINECHUNK *cp;
+
+	/* find the last chunk which starts before the line */
+	(void) lchunk_start(bp, bp->b_lchunks[hi]);
+	while (lo < hi) {
+	    L_NUM mid = (lo + hi + 1) / 2;
+
+	    if (bp->b_lchunks[mid]->lc_start < num)
+		lo = mid;
+	    else
+		hi = mid - 1;
+	}
+	cp = bp->b_lchunks[lo];
+	num -= cp->lc_start + 1;
+	for (result = cp->lc_first; num > 0; --num)
+	    result = lforw(result);
+    }
+    return result;
+}
+
+/*
+ * Call this after linking a line into the buffer.
+ */
+void
+lindex_insert(BUFFER *bp, LINE *lp)
+{
+    LINE *prev = lback(lp);
+    LINE *next = lforw(lp);
+    LINECHUNK *cp;
+    L_NUM inx;
+
+    lp->l_chunk = NULL;
+    if (bp->b_lchunks == NULL)
+	return;
+
+    beginDisplay();
+    if (prev != buf_head(bp)) {
+	cp = prev->l_chunk;
+	inx = prev->l_number + 1;
+    } else if (next != buf_head(bp)) {
+	cp = next->l_chunk;
+	inx = 0;
+    } else {
+	cp = lchunk_alloc(bp, 0);
+	inx = 0;
+    }
+    if (cp == NULL) {		/* not indexed, or out of memory */
+	lindex_clear(bp);
+    } else {
+	if (inx == 0)
+	    cp->lc_first = lp;
+	cp->lc_count += 1;
+	lchunk_number(cp, lp, inx);
+	bp->b_lchunks_lines += 1;
+	if (bp->b_lchunks_ok > cp->lc_index + 1)
+	    bp->b_lchunks_ok = cp->lc_index + 1;
+	if (cp->lc_count > LCHUNK_MAX)
+	    lchunk_split(bp, cp);
+    }
+    endofDisplay();
+}
+
+/*
+ * Call this before unlinking a line from the buffer.
+ */
+void
+lindex_remove(BUFFER *bp, LINE *lp)
+{
+    LINECHUNK *cp = lp->l_chunk;
+
+    lp->l_chunk = NULL;
+    if (bp->b_lchunks == NULL)
+	return;
+
+    beginDisplay();
+    if (cp == NULL) {		/* not indexed */
+	lindex_clear(bp);
+    } else {
+	L_NUM inx = lp->l_number;
+
+	cp->lc_count -= 1;
+	if (inx == 0)
+	    cp->lc_first = lforw(lp);
+	if (inx < cp->lc_count)
+	    lchunk_number(cp, lforw(lp), inx);
+	bp->b_lchunks_lines -= 1;
+	if (bp->b_lchunks_ok > cp->lc_index + 1)
+	    bp->b_lchunks_ok = cp->lc_index + 1;
+	if (cp->lc_count == 0) {
+	    lchunk_free(bp, cp);
+	} else if (cp->lc_count < LCHUNK_MIN) {
+	    if (cp->lc_index + 1 < bp->b_lchunks_len
+		&& (cp->lc_count
+		    + bp->b_lchunks[cp->lc_index + 1]->lc_count) <= LCHUNK_MAX) {
+		lchunk_merge(bp, bp->b_lchunks[cp->lc_index + 1]);
+	    } else if (cp->lc_index > 0
+		       && (cp->lc_count
+			   + bp->b_lchunks[cp->lc_index - 1]->lc_count) <= LCHUNK_MAX) {
+		lchunk_merge(bp, cp);
+	    }
+	}
+    }
+    endofDisplay();
+}
+
+/*
+ * Call this when one line takes the place of another, e.g., in undo.
+ */
+void
+lindex_replace(BUFFER *bp, LINE *olp, LINE *nlp)
+{
+    LINECHUNK *cp = olp->l_chunk;
+
+    olp->l_chunk = NULL;
+    nlp->l_chunk = cp;
+    if (bp->b_lchunks == NULL)
+	return;
+
+    if (cp == NULL) {		/* not indexed */
+	lindex_clear(bp);
+    } else {
+	nlp->l_number = olp->l_number;
+	if (cp->lc_first == olp)
+	    cp->lc_first = nlp;
+    }
+}
+#endif /* !SMALLER */
+
 /*ARGSUSED*/
 void
 ltextfree(LINE *lp, BUFFER *bp)
@@ -153,16 +604,24 @@ ltextfree(LINE *lp, BUFFER *bp)
     ltextp = (UCHAR *) lvalue(lp);
     if (ltextp) {
 	lvalue(lp) = NULL;
-	if (bp->b_ltext) {	/* could it be in the big range? */
-	    if (ltextp < bp->b_ltext || ltextp >= bp->b_ltext_end) {
-		poison(ltextp, lp->l_size);
-		free((char *) ltextp);
-	    }			/* else {
-				   could keep track of freed big range text here;
-				   } */
-	} else {
+	if (bp->b_ltext != NULL
+	    && ltextp >= bp->b_ltext
+	    && ltextp < bp->b_ltext_end) {
+	    ;			/* part of the block read by quickreadf */
+	} else if (lp->l_size > ARENA_TEXTMAX) {
+	    bp->b_arena.a_large -= 1;
+	    bp->b_arena.a_large_bytes -= lp->l_size;
 	    poison(ltextp, lp->l_size);
 	    free((char *) ltextp);
+	} else {
+	    ARENA *ap = &(bp->b_arena);
+	    int n = arena_class(lp->l_size);
+
+	    poison(ltextp, lp->l_size);
+	    *(void **) ltextp = ap->a_free[n];
+	    ap->a_free[n] = ltextp;
+	    ap->a_used[n] -= 1;
+	    ap->a_idle[n] += 1;
 	}
     }
     /* else nothing to free */
@@ -172,6 +631,62 @@ ltextfree(LINE *lp, BUFFER *bp)
     endofDisplay();
 }
 
+/*
+ * Free all of the lines in a buffer, e.g., when clearing it.  The LINEs and
+ * short text are released with the arena's blocks rather than one by one.
+ * Marks which pointed into the buffer are moved to its header line.  Undo
+ * stacks and attributed regions must have been freed already.
+ */
+void
+lremove_all(BUFFER *bp)
+{
+    LINE *head = buf_head(bp);
+    LINE *lp;
+    LINE *next;
+    WINDOW *wp;
+    MARK at_head;
+
+    beginDisplay();
+    at_head.l = head;
+    at_head.o = 0;
+
+    for (lp = lforw(head); lp != head; lp = next) {
+	next = lforw(lp);
+#if !WINMARK
+	if (MK.l == lp)
+	    MK = at_head;
+#endif
+	if (lvalue(lp) != NULL && lp->l_size > ARENA_TEXTMAX) {
+	    ltextfree(lp, bp);
+	}
+#if OPT_LINE_ATTRS
+	FreeAndNull(lp->l_attrs);
+#endif
+    }
+    set_lforw(head, head);
+    set_lback(head, head);
+    lindex_clear(bp);
+
+    for_each_window(wp) {
+	if (wp->w_bufp == bp) {
+	    wp->w_line = at_head;
+	    wp->w_dot = at_head;
+#if WINMARK
+	    wp->w_mark = at_head;
+#endif
+	}
+    }
+    bp->b_wline = at_head;
+    bp->b_dot = at_head;
+#if WINMARK
+    bp->b_mark = at_head;
+#endif
+
+    bp->b_freeLINEs = NULL;
+    arena_release(&(bp->b_arena));
+    endofDisplay();
+}
+
 /*
  * Delete line "lp".  Fix all of the links that might point at it (they are
  * moved to offset 0 of the next line.  Unlink the line from whatever buffer it
@@ -251,14 +766,17 @@ lremove(BUFFER *bp, LINE *lp)
 		next = rpp;
 	    } else if (samestart) {
 		ap->ar_region.r_orig = mark_after;
+		reindex_attrib(bp, ap);
 	    } else if (sameend) {
 		ap->ar_region.r_end.l = lback(lp);
 		ap->ar_region.r_end.o = llength(ap->ar_region.r_end.l);
+		reindex_attrib(bp, ap);
 	    }
 	    rpp = next;
 	}
     }
 #endif /* OPT_VIDEO_ATTRS */
+    lindex_remove(bp, lp);
     set_lforw(lback(lp), lforw(lp));
     set_lback(lforw(lp), lback(lp));
 
@@ -339,7 +857,7 @@ lreplc(LINE *lp, C_NUM off, int c)
 	return FALSE;
 
     if (lvalue(lp)[off] != (char) c) {
-	CopyForUndo(lp);
+	CopyPartForUndo(lp, off, 1);
 	lvalue(lp)[off] = (char) c;
 
 	chg_buff(curbp, WFEDIT);
@@ -424,6 +942,7 @@ lins_bytes(int n, int c)
 	    set_lforw(lp2, lp1);
 	    set_lback(lp1, lp2);
 	    set_lback(lp2, lp3);
+	    lindex_insert(curbp, lp2);
 	    (void) memset(lvalue(lp2), c, (size_t) n);
 
 	    TagForUndo(lp2);
@@ -440,8 +959,8 @@ lins_bytes(int n, int c)
 	if (nsize > lp1->l_size) {	/* Hard: reallocate     */
 	    /* first, create the new image */
 	    nsize = roundlenup(nsize);
-	    CopyForUndo(lp1);
-	    if ((ntext = castalloc(char, nsize)) == NULL) {
+	    CopyPartForUndo(lp1, doto, 0);
+	    if ((ntext = ltextalloc(curbp, &nsize)) == NULL) {
 		rc = FALSE;
 	    } else {
 		if (lvalue(lp1) && doto) {	/* possibly NULL if l_size == 0 */
@@ -470,7 +989,7 @@ lins_bytes(int n, int c)
 		assert((size_t) llength(lp1) <= lp1->l_size);
 	    }
 	} else {		/* Easy: in place       */
-	    CopyForUndo(lp1);
+	    CopyPartForUndo(lp1, doto, 0);
 	    changed = (WFEDIT);
 	    /* don't use memcpy:  overlapping regions.... */
 	    llength(lp1) += n;
@@ -527,6 +1046,138 @@ lins_bytes(int n, int c)
     return (rc);
 }
 
+/*
+ * Map an offset in a line through the replacements made by lsplice(), giving
+ * the same result as deleting and inserting each with ldel_bytes() and
+ * lins_bytes().
+ */
+static C_NUM
+splice_offset(C_NUM offset, const SPLICE * edits, int count)
+{
+    C_NUM delta = 0;
+    int n;
+
+    for (n = 0; n < count; ++n) {
+	if (offset <= edits[n].sp_offset)
+	    break;
+	if (offset <= edits[n].sp_offset + edits[n].sp_delete)
+	    return edits[n].sp_offset + delta;
+	delta += edits[n].sp_insert - edits[n].sp_delete;
+    }
+    return offset + delta;
+}
+
+#define SpliceOff(name, lp, edits, count) \
+	if (name.l == lp) name.o = splice_offset(name.o, edits, count)
+
+/*
+ * Adjust DOT and MK in the given window, which may be the minibuffer.
+ */
+static void
+after_lsplice(WINDOW *wp, LINE *lp, const SPLICE * edits, int count)
+{
+    if (wp != curwp) {
+	SpliceOff(wp->w_dot, lp, edits, count);
+    }
+#if WINMARK
+    SpliceOff(wp->w_mark, lp, edits, count);
+#endif
+    SpliceOff(wp->w_lastdot, lp, edits, count);
+}
+
+/*
+ * Replace the text of the current line with "text", which differs from it by
+ * the given list of replacements (in order, not overlapping).  The line is
+ * saved for undo once, and marks and attributes are adjusted once, rather
+ * than for each byte.  The caller sets dot.
+ */
+int
+lsplice(const char *text, size_t length, const SPLICE * edits, int count)
+{
+    LINE *lp = DOT.l;
+    WINDOW *wp;
+    char *ntext;
+    size_t nsize;
+    int rc = TRUE;
+    int did_wminip = FALSE;
+
+    if (count <= 0)
+	return TRUE;
+    if (lp == buf_head(curbp)) {
+	mlforce("BUG: lsplice");
+	return FALSE;
+    }
+
+    beginDisplay();
+
+    CopyPartForUndo(lp, edits[0].sp_offset,
+		    (edits[count - 1].sp_offset
+		     + edits[count - 1].sp_delete
+		     - edits[0].sp_offset));
+    nsize = length + 1;
+    if (nsize > lp->l_size) {	/* Hard: reallocate     */
+	nsize = roundlenup(nsize);
+	if ((ntext = ltextalloc(curbp, &nsize)) == NULL) {
+	    rc = FALSE;
+	} else {
+	    (void) memcpy(ntext, text, length);
+	    if (lvalue(lp)) {
+#if OPT_LINE_ATTRS
+		UCHAR *l_attrs = lp->l_attrs;
+		lp->l_attrs = NULL;	/* momentarily detach */
+#endif
+		ltextfree(lp, curbp);
+#if OPT_LINE_ATTRS
+		lp->l_attrs = l_attrs;	/* reattach */
+#endif
+	    }
+	    lvalue(lp) = ntext;
+	    lp->l_size = nsize;
+	}
+    } else if (length != 0) {	/* Easy: in place       */
+	(void) memcpy(lvalue(lp), text, length);
+    }
+
+    if (rc != FALSE) {
+	llength(lp) = (int) length;
+
+#if ! WINMARK
+	SpliceOff(MK, lp, edits, count);
+#endif
+	for_each_window(wp) {	/* Update windows       */
+	    after_lsplice(wp, lp, edits, count);
+	    if (wp == wminip)
+		did_wminip = TRUE;
+	}
+	if (!did_wminip) {
+	    after_lsplice(wminip, lp, edits, count);
+	}
+	do_mark_iterate(mp, {
+	    SpliceOff((*mp), lp, edits, count);
+	});
+#if OPT_LINE_ATTRS
+	if (lp->l_attrs) {
+	    C_NUM delta = 0;
+	    int n;
+
+	    for (n = 0; n < count; ++n) {
+		C_NUM at = edits[n].sp_offset + delta;
+		if (!lattr_shift(curbp, lp, at, -edits[n].sp_delete)
+		    || !lattr_shift(curbp, lp, at, edits[n].sp_insert)) {
+		    rc = FALSE;
+		    break;
+		}
+		delta += edits[n].sp_insert - edits[n].sp_delete;
+	    }
+	}
+#endif
+	chg_buff(curbp, WFEDIT);
+    }
+
+    endofDisplay();
+    return (rc);
+}
+
 #if OPT_MULTIBYTE
 /*
  * Insert 'n' copies of (potentially) multibyte character 'c'.  We could get
@@ -608,6 +1259,7 @@ lnewline(void)
 	    set_lforw(lp1, lp2);
 	    set_lback(lforw(lp2), lp2);
 	    set_lback(lp2, lp1);
+	    lindex_insert(curbp, lp2);
 
 	    TagForUndo(lp2);
 
@@ -626,7 +1278,7 @@ lnewline(void)
 	lp2 = lalloc(doto, curbp);	/* New first half line */
 	if (lp2 != NULL) {
 	    if (doto > 0) {
-		CopyForUndo(lp1);
+		CopyPartForUndo(lp1, 0, doto);
 #if OPT_LINE_ATTRS
 		if (lp1->l_attrs != NULL) {
 		    if (doto == llength(lp1)) {
@@ -664,6 +1316,7 @@ lnewline(void)
 	    set_lback(lp1, lp2);
 	    set_lforw(lback(lp2), lp2);
 	    set_lforw(lp2, lp1);
+	    lindex_insert(curbp, lp2);
 
 	    TagForUndo(lp2);
 	    dumpuline(lp1);
@@ -722,6 +1375,83 @@ lnewline(void)
     return rc;
 }
 
+/*
+ * Copy 'length' bytes into the current line at dot, opening up space for them
+ * with a single call to lins_bytes().
+ */
+static int
+lins_part(const char *text, size_t length)
+{
+    int rc = TRUE;
+
+    if (length != 0
+	&& (rc = lins_bytes((int) length, ' ')) == TRUE) {
+	(void) memcpy(lvalue(DOT.l) + DOT.o - (int) length, text, length);
+    }
+    return rc;
+}
+
+/*
+ * Insert a block of text, which may contain newlines, at dot, leaving dot just
+ * past it.  This gives the same result as inserting it a byte at a time with
+ * lins_bytes() and lnewline(), but the lines between the first and last are
+ * built and linked into the buffer directly, since no marks can point into
+ * them.
+ */
+int
+lins_text(const char *text, size_t length)
+{
+    const char *last = text + length;
+    const char *next;
+    LINE *lp;
+    LINE *tail;
+    int rc = TRUE;
+
+    TRACE((T_CALLED "lins_text(%lu)\n", (ULONG) length));
+
+    next = (length != 0) ? memchr(text, '\n', length) : NULL;
+    if (next == NULL) {
+	returnCode(lins_part(text, length));
+    }
+
+    /* finish the current line, and split it at dot */
+    if ((rc = lins_part(text, (size_t) (next - text))) != TRUE
+	|| (rc = lnewline()) != TRUE) {
+	returnCode(rc);
+    }
+    text = next + 1;
+    tail = DOT.l;
+
+    beginDisplay();
+    while (text < last
+	   && (next = memchr(text, '\n', (size_t) (last - text))) != NULL) {
+	int used = (int) (next - text);
+
+	if ((lp = lalloc(used, curbp)) == NULL) {
+	    rc = FALSE;
+	    break;
+	}
+	if (used != 0)
+	    (void) memcpy(lvalue(lp), text, (size_t) used);
+
+	/* put lp in above the tail of the split line */
+	set_lback(lp, lback(tail));
+	set_lforw(lp, tail);
+	set_lforw(lback(tail), lp);
+	set_lback(tail, lp);
+	lindex_insert(curbp, lp);
+
+	TagForUndo(lp);
+	text = next + 1;
+    }
+    endofDisplay();
+    chg_buff(curbp, WFHARD | WFINS);
+
+    if (rc == TRUE)
+	rc = lins_part(text, (size_t) (last - text));
+    returnCode(rc);
+}
+
 /*
  * This function deletes bytes, starting at dot.  It understands how to deal
  * with end of lines, etc.  It returns TRUE if all of the bytes were deleted,
@@ -804,7 +1534,7 @@ ldel_bytes(B_COUNT nbytes, int kflag)
 	    lines_deleted++;
 	    continue;
 	}
-	CopyForUndo(DOT.l);
+	CopyPartForUndo(dotp, doto, (C_NUM) schunk);
 	chg_buff(curbp, WFEDIT);
 
 	cp1 = lvalue(dotp) + doto;	/* Scrunch text.     */
@@ -1043,7 +1773,7 @@ ldelnewline(void)
     }
 
     beginDisplay();
-    CopyForUndo(DOT.l);
+    CopyPartForUndo(lp1, len, 0);
 
     /* no room in line above, make room */
     if (add > (C_NUM) lp1->l_size - len) {
@@ -1051,7 +1781,7 @@ ldelnewline(void)
 	size_t nsize;
 	/* first, create the new image */
 	nsize = roundlenup((size_t) len + (size_t) add);
-	if ((ntext = castalloc(char, nsize)) == NULL)
+	if ((ntext = ltextalloc(curbp, &nsize)) == NULL)
 	      return (FALSE);
 	if (lvalue(lp1)) {	/* possibly NULL if l_size == 0 */
 	    (void) memcpy(&ntext[0], &lvalue(lp1)[0], (size_t) len);
@@ -1097,6 +1827,7 @@ ldelnewline(void)
 #endif
     llength(lp1) += add;
     assert((size_t) llength(lp1) <= lp1->l_size);
+    lindex_remove(curbp, lp2);
     set_lforw(lp1, lforw(lp2));
     set_lback(lforw(lp2), lp1);
     dumpuline(lp1);
@@ -1943,6 +2674,74 @@ show_Registers(BUFFER *bp)
 
 #endif /* OPT_SHOW_REGS */
 
+#if OPT_SHOW_MEMORY
+/*ARGSUSED*/
+static void
+makememlist(int iarg GCC_UNUSED, void *dummy GCC_UNUSED)
+{
+    BUFFER *bp;
+    B_COUNT used[ARENA_CLASSES];
+    B_COUNT idle[ARENA_CLASSES];
+    B_COUNT blocks = 0;
+    int n;
+
+    for (n = 0; n < ARENA_CLASSES; ++n) {
+	used[n] = 0;
+	idle[n] = 0;
+    }
+
+    bprintf("Memory used for lines, in %d-byte blocks\n", ARENA_BLOCK);
+    bprintf("\nBlocks LINEs    free     text     free     large    bytes    Buffer");
+    bprintf("\n------ -------- -------- -------- -------- -------- -------- ------");
+    for_each_buffer(bp) {
+	ARENA *ap = &(bp->b_arena);
+	LINE *lp;
+	B_COUNT free_lines = 0;
+	B_COUNT text_used = 0;
+	B_COUNT text_idle = 0;
+
+	for (lp = bp->b_freeLINEs; lp != NULL; lp = lp->l_nxtundo)
+	    ++free_lines;
+	for (n = 0; n < ARENA_CLASSES; ++n) {
+	    text_used += ap->a_used[n];
+	    text_idle += ap->a_idle[n];
+	    used[n] += ap->a_used[n];
+	    idle[n] += ap->a_idle[n];
+	}
+	blocks += ap->a_nblocks;
+	bprintf("\n%6u %8lu %8lu %8lu %8lu %8lu %8lu %s",
+		ap->a_nblocks,
+		(ULONG) ap->a_lines,
+		(ULONG) free_lines,
+		(ULONG) text_used,
+		(ULONG) text_idle,
+		(ULONG) ap->a_large,
+		(ULONG) ap->a_large_bytes,
+		bp->b_bname);
+    }
+
+    bprintf("\n\nText by size-class, in %lu blocks", (ULONG) blocks);
+    bprintf("\n\nSize   in use   free");
+    bprintf("\n------ -------- --------");
+    for (n = 0; n < ARENA_CLASSES; ++n) {
+	bprintf("\n%6d %8lu %8lu",
+		NBLOCK << n,
+		(ULONG) used[n],
+		(ULONG) idle[n]);
+    }
+}
+
+/*
+ * Show how much of each buffer's arena is used for LINEs and text.
+ */
+/*ARGSUSED*/
+int
+showarenas(int f, int n GCC_UNUSED)
+{
+    return liststuff(MEMORY_BufName, FALSE, makememlist, f, (void *) 0);
+}
+#endif /* OPT_SHOW_MEMORY */
+
 #if OPT_REGS_CMPL
 KBD_OPTIONS
 regs_kbd_options(void)
@@ -972,9 +972,14 @@ MainProgram(int argc, char *argv[])
      * have removed the first buffer.
      */
     if (havebp && find_bp(havebp)) {
+	int s;
+
 	if (find_bp(bp) && is_empty_buf(bp) && !b_is_changed(bp))
 	    b_set_scratch(bp);	/* remove the unnamed-buffer */
-	if (swbuffer(havebp) == TRUE) {
+	lazy_readin = !filter_only;	/* finish reading it after showing it */
+	s = swbuffer(havebp);
+	lazy_readin = FALSE;
+	if (s == TRUE) {
 #if OPT_MAJORMODE && OPT_HOOKS
 	    /*
 	     * Partial fix in case we edit .vilerc (vile.rc) or
@@ -1139,6 +1144,12 @@ main_loop(void)
 	/* bring the screen up to date */
 	s = update(FALSE);
 
+	/* read the rest of any large file while waiting for a command */
+	(void) lazyreadf_idle();
+
+	/* highlight the remaining matches while waiting for a command */
+	attrib_more_matches();
+
 	/* get a user command */
 	kbd_mac_check();
 	c = kbd_seq();
@@ -1598,6 +1609,9 @@ init_mode_value(struct VAL *d, MODECLASS v_class, int v_which)
 #ifdef GMDXTERM_MOUSE
 	    setINT(GMDXTERM_MOUSE, FALSE);	/* mouse-clicking */
 #endif
+#ifdef GMDXTERM_PASTE
+	    setINT(GMDXTERM_PASTE, TRUE);	/* bracketed paste */
+#endif
 #ifdef GMDXTERM_TITLE
 	    setINT(GMDXTERM_TITLE, FALSE);	/* xterm window-title */
 #endif
@@ -1811,6 +1825,9 @@ init_mode_value(struct VAL *d, MODECLASS v_class, int v_which)
 #endif
 #ifdef VAL_STRIPSUFFIX
 	    setPAT(VAL_STRIPSUFFIX, DFT_STRIPSUFFIX);
+#endif
+#ifdef VAL_UNDODIR
+	    setTXT(VAL_UNDODIR, "");	/* no persistent undo */
 #endif
 	default:
 	    setIntValue(d, 0);
@@ -3221,6 +3238,7 @@ free_all_leaks(void)
     /* free all of the global data structures */
     onel_leaks();
     path_leaks();
+    regexp_leaks();
     kbs_leaks();
     bind_leaks();
     map_leaks();
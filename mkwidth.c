@@ -0,0 +1,6 @@
+/*
+ * Build the width-table generator from wcwidth.c, so that its object file
+ * does not collide with the one linked into vile.
+ */
+#define MAKE_WCWTBL 1
+#include "wcwidth.c"
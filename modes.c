@@ -49,12 +49,26 @@ static char **my_varmodes;	/* list for modename-completion */
 
 #define mmShortName(n) my_majormodes[majormodes_order[n]].shortname
 
+/*
+ * Most majormodes' suffixes and filename patterns are just a list of words,
+ * e.g., '\.\(c\|h\)$'.  We match those by comparing strings, rather than
+ * running the regular expression for each majormode.
+ */
+typedef struct {
+    char *pattern;		/* the pattern from which "words" was made */
+    char *words;		/* null-separated list, or null if not plain */
+} MM_WORDS;
+
+#define MM_SUFFIXES 0
+#define MM_FILENAME 1
+
 typedef struct {
     char *shortname;		/* copy of MAJORMODE.shortname */
     char *longname;		/* copy of MAJORMODE.longname */
     MAJORMODE *data;		/* pointer to actual data */
     int init;			/* predefined during initialization */
     int flag;			/* true when majormode is active/usable */
+    MM_WORDS words[2];		/* plain suffixes/filename, if any */
     struct VALNAMES qual[MAX_M_VALUES + 1];	/* majormode qualifier names */
     struct VALNAMES used[MAX_B_VALUES + 1];	/* submode names */
     struct VALNAMES subq[MAX_Q_VALUES + 1];	/* submode qualifier names */
@@ -670,7 +684,7 @@ new_regexval(const char *pattern, int magic)
 	beginDisplay();
 	if ((rp = typecalloc(REGEXVAL)) != NULL) {
 	    if ((rp->pat = strmalloc(pattern)) == NULL
-		|| (rp->reg = regcomp(rp->pat, strlen(rp->pat), magic)) == NULL)
+		|| (rp->reg = regcomp_cached(rp->pat, strlen(rp->pat), magic)) == NULL)
 		rp = free_regexval(rp);
 	}
 	endofDisplay();
@@ -2731,6 +2745,24 @@ chgd_xterm(BUFFER *bp GCC_UNUSED,
     return TRUE;
 }
 
+/* Change the xterm-paste mode */
+/*ARGSUSED*/
+int
+chgd_xtermpaste(BUFFER *bp GCC_UNUSED,
+		VALARGS * args GCC_UNUSED,
+		int glob_vals GCC_UNUSED,
+		int testing GCC_UNUSED)
+{
+#if OPT_XTERM
+    if (glob_vals && !testing) {
+	term.kclose();
+	term.kopen();
+	vile_refresh(FALSE, 0);
+    }
+#endif
+    return TRUE;
+}
+
 /* Change the xterm-fkeys mode */
 /*ARGSUSED*/
 int
@@ -4008,6 +4040,10 @@ free_majormode(const char *name)
 		free(ptr->shortname);
 		free(ptr->longname);
 		free(ptr);
+		for (k = 0; k < TABLESIZE(my_majormodes[j].words); k++) {
+		    FreeIfNeeded(my_majormodes[j].words[k].pattern);
+		    FreeIfNeeded(my_majormodes[j].words[k].words);
+		}
 		endofDisplay();
 
 		do {
@@ -4367,6 +4403,7 @@ alloc_mode(const char *shortname, int predef)
 
     my_majormodes[j].init = predef;
     my_majormodes[j].flag = TRUE;
+    memset(my_majormodes[j].words, 0, sizeof(my_majormodes[j].words));
 
     if ((my_majormodes[j].data = typecalloc(MAJORMODE)) != NULL) {
 	my_majormodes[j].data->shortname = my_majormodes[j].shortname;
@@ -4684,40 +4721,177 @@ get_sm_rexp(int n, int m)
     return NULL;
 }
 
+/*
+ * Parse a pattern which is just a list of words, e.g., '\.\(c\|h\)$' for
+ * suffixes or '^\(Makefile\|makefile\)$' for filenames.  Return the words as
+ * a null-separated list (ending with an empty string), or null if the pattern
+ * is not that simple.  Suffix words cannot contain a '.', so they can only
+ * match the last part of the buffer's suffix.
+ */
+static char *
+parse_mm_words(const char *pattern, int suffixes)
+{
+    const char *s = pattern;
+    char *result;
+    char *d;
+    int group = FALSE;
+
+    if (suffixes ? strncmp(s, "\\.", (size_t) 2) : (*s != '^'))
+	return NULL;
+    s += suffixes ? 2 : 1;
+    if (!strncmp(s, "\\(", (size_t) 2)) {
+	group = TRUE;
+	s += 2;
+    }
+
+    beginDisplay();
+    result = typeallocn(char, strlen(s) + 2);
+    endofDisplay();
+
+    if ((d = result) != NULL) {
+	for (;;) {
+	    char *word = d;
+
+	    while (*s != EOS) {
+		if (isascii(CharOf(*s))
+		    && (isalnum(CharOf(*s)) || *s == '_' || *s == '-')) {
+		    *d++ = *s++;
+		} else if (!suffixes && !strncmp(s, "\\.", (size_t) 2)) {
+		    *d++ = '.';
+		    s += 2;
+		} else {
+		    break;
+		}
+	    }
+	    if (d == word)
+		break;
+	    *d++ = EOS;
+	    if (group && !strncmp(s, "\\|", (size_t) 2)) {
+		s += 2;
+		continue;
+	    }
+	    if (group && !strncmp(s, "\\)", (size_t) 2)) {
+		group = FALSE;
+		s += 2;
+	    }
+	    if (!group && !strcmp(s, "$")) {
+		*d = EOS;
+		return result;
+	    }
+	    break;
+	}
+	beginDisplay();
+	free(result);
+	endofDisplay();
+    }
+    return NULL;
+}
+
+/*
+ * Return the list of words for the majormode's suffixes or filename pattern,
+ * reparsing it if the pattern has changed.
+ */
+static const char *
+get_mm_words(int n, int m)
+{
+    MM_WORDS *p = &(my_majormodes[n].words[(m == MVAL_MODE_SUFFIXES)
+					   ? MM_SUFFIXES
+					   : MM_FILENAME]);
+    struct VAL *mv = my_majormodes[n].data->mm.mv;
+    const char *pattern = mv[m].vp->r->pat;
+
+    if (p->pattern == NULL || strcmp(p->pattern, pattern)) {
+	beginDisplay();
+	FreeIfNeeded(p->pattern);
+	FreeIfNeeded(p->words);
+	endofDisplay();
+	p->pattern = strmalloc(pattern);
+	p->words = ((p->pattern != NULL)
+		    ? parse_mm_words(pattern, (m == MVAL_MODE_SUFFIXES))
+		    : NULL);
+    }
+    return p->words;
+}
+
+/*
+ * Match the majormode's suffixes or filename pattern (given by the mode value
+ * 'm'), using its list of words if it is simple enough.
+ */
+static int
+match_mm_rexp(int n, int m, regexp * exp, char *text, int ic)
+{
+    const char *words = get_mm_words(n, m);
+
+    if (words != NULL) {
+	if (m == MVAL_MODE_SUFFIXES)
+	    text = strrchr(text, '.') + 1;
+	while (*words != EOS) {
+	    if (!cs_strcmp(ic, words, text))
+		return TRUE;
+	    words += strlen(words) + 1;
+	}
+	return FALSE;
+    }
+    return nregexec(exp, text, (char *) 0, 0, -1, ic);
+}
+
+/*
+ * Return the buffer's pathname, after stripping the version (for VMS) and
+ * the part matched by the ignoresuffix pattern.
+ */
+typedef struct {
+    regexp *strip;		/* the ignoresuffix pattern which was used */
+    TBUFF *path;		/* the resulting pathname */
+} MM_PATH;
+
+static char *
+strip_mm_pathname(BUFFER *bp, regexp * exp, int ic, TBUFF **result)
+{
+    char *pathname;
+
+    if (tb_scopy(result, bp->b_fname) == NULL)
+	return bp->b_fname;
+
+    pathname = tb_values(*result);
+#if OPT_VMS_PATH
+    strip_version(pathname);
+#endif
+    if (exp != NULL
+	&& nregexec(exp, pathname, (char *) 0, 0, -1, ic)) {
+	char *tail = exp->endp[0];
+	memmove(exp->startp[0], tail, strlen(tail) + 1);
+    }
+    return pathname;
+}
+
 /*
  * Use a regular expression (normally a suffix, such as ".c") to match the
  * buffer's filename.
+ *
+ * Most majormodes share the same ignoresuffix pattern, so the stripped
+ * pathname is saved in 'paths' (for each setting of ignorecase) for reuse
+ * while checking the other majormodes.
  */
 static int
-test_by_suffix(int n, BUFFER *bp)
+test_by_suffix(int n, BUFFER *bp, MM_PATH * paths)
 {
     int result = -1;
 
     if (my_majormodes[n].flag) {
 	regexp *exp;
-	char *pathname = bp->b_fname;
+	char *pathname;
 	char *filename;
 	char *suffix;
-	TBUFF *savename = NULL;
-#if OPT_VMS_PATH
-	TBUFF *stripname = 0;
-#endif
 
 	int ic = global_g_val(GMDFILENAME_IC) || get_sm_b_val(n, MDIGNCASE);
-#if OPT_VMS_PATH
-	tb_scopy(&stripname, pathname);
-	pathname = tb_values(stripname);
-	strip_version(pathname);
-#endif
 
-	if (((exp = get_sm_rexp(n, VAL_STRIPSUFFIX)) != NULL
-	     || (exp = b_val_rexp(bp, VAL_STRIPSUFFIX)->reg) != NULL)
-	    && nregexec(exp, pathname, (char *) 0, 0, -1, ic)) {
-	    if (tb_scopy(&savename, pathname) != NULL) {
-		strcpy(tb_values(savename) + (exp->startp[0] - pathname),
-		       exp->endp[0]);
-		pathname = tb_values(savename);
-	    }
+	if ((exp = get_sm_rexp(n, VAL_STRIPSUFFIX)) == NULL)
+	    exp = b_val_rexp(bp, VAL_STRIPSUFFIX)->reg;
+	if (paths[ic].path != NULL && paths[ic].strip == exp) {
+	    pathname = tb_values(paths[ic].path);
+	} else {
+	    paths[ic].strip = exp;
+	    pathname = strip_mm_pathname(bp, exp, ic, &(paths[ic].path));
 	}
 	filename = pathleaf(pathname);
 	suffix = strchr(filename, '.');
@@ -4735,7 +4909,7 @@ test_by_suffix(int n, BUFFER *bp)
 		   my_majormodes[n].shortname));
 	    result = n;
 	} else if ((exp = get_mm_rexp(n, MVAL_MODE_FILENAME)) != NULL
-		   && nregexec(exp, filename, (char *) 0, 0, -1, ic)) {
+		   && match_mm_rexp(n, MVAL_MODE_FILENAME, exp, filename, ic)) {
 	    TRACE(("test_by_filename(%s) %s %s\n",
 		   pathname,
 		   filename,
@@ -4744,17 +4918,13 @@ test_by_suffix(int n, BUFFER *bp)
 	} else if (!isShellOrPipe(pathname)
 		   && suffix != NULL
 		   && (exp = get_mm_rexp(n, MVAL_MODE_SUFFIXES)) != NULL
-		   && nregexec(exp, suffix, (char *) 0, 0, -1, ic)) {
+		   && match_mm_rexp(n, MVAL_MODE_SUFFIXES, exp, suffix, ic)) {
 	    TRACE(("test_by_suffixes(%s) %s %s\n",
 		   pathname,
 		   suffix,
 		   my_majormodes[n].shortname));
 	    result = n;
 	}
-	tb_free(&savename);
-#if OPT_VMS_PATH
-	tb_free(&stripname);
-#endif
     }
     return result;
 }
@@ -4827,6 +4997,9 @@ infer_majormode(BUFFER *bp)
 	int n, m;
 	int result = -1;
 	LINE *lp = get_preamble(bp);
+	MM_PATH paths[2];
+
+	memset(paths, 0, sizeof(paths));
 
 	did_attach_mmode = FALSE;
 	if (bp == curbp		/* otherwise we cannot script it */
@@ -4836,13 +5009,13 @@ infer_majormode(BUFFER *bp)
 	} else {
 	    for (m = 0; (n = majormodes_order[m]) >= 0; m++) {
 		if (need_suffix_and_preamble(n)) {
-		    if (test_by_suffix(n, bp) >= 0
+		    if (test_by_suffix(n, bp, paths) >= 0
 			&& test_by_preamble(n, bp, lp) >= 0) {
 			TPRINTF(("matched preamble and suffix of %s\n", bp->b_bname));
 			result = n;
 			break;
 		    }
-		} else if (test_by_suffix(n, bp) >= 0) {
+		} else if (test_by_suffix(n, bp, paths) >= 0) {
 		    TPRINTF(("matched suffix of %s\n", bp->b_bname));
 		    result = n;
 		    break;
@@ -4857,6 +5030,8 @@ infer_majormode(BUFFER *bp)
 		attach_mmode(bp, my_majormodes[result].shortname);
 	    }
 	}
+	for (m = 0; m < (int) TABLESIZE(paths); m++)
+	    tb_free(&(paths[m].path));
     }
     --level;
 
@@ -17,6 +17,8 @@
 #define PGREP	0x04		/* like "grep -n": buffer name, line number */
 
 static int delins(regexp * exp, char *sourc, int lensrc);
+static int subst_expand(regexp * exp, const char *sourc, int lensrc, TBUFF **result);
+static int subst_splits(const char *sourc, int lensrc);
 static int substline(regexp * exp, int nth_occur, int printit, int globally, int *confirmp);
 static int substreg1(int needpats, int use_opts, int is_globalsub);
 
@@ -310,6 +312,133 @@ showpat(regexp * rp, int on)
 	   on);
 }
 
+static TBUFF *splice_text;
+static SPLICE *splice_list;
+static size_t splice_size;
+
+/*
+ * Make all of the substitutions on the current line, building its new text
+ * in one buffer so that the line is changed (and saved for undo) only once.
+ * Return SORTOFTRUE if the line must be done a byte at a time.
+ */
+static int
+subst_splice(regexp * exp, int nth_occur, int globally, int at_bol, int ic,
+	     int *foundp)
+{
+    LINE *lp = DOT.l;
+    C_NUM copied = 0;		/* offset of old text not yet copied */
+    C_NUM delta = 0;		/* change in length, through last replacement */
+    int count = 0;
+    int which_occur = 0;
+    int matched_at_eol = FALSE;
+    int s;
+
+    *foundp = FALSE;
+    tb_init(&splice_text, EOS);
+    scanboundpos.l = lp;
+    scanbound_is_header = FALSE;
+    DOT.o = b_left_margin(curbp);
+    do {
+	int wrapped = FALSE;
+
+	scanboundpos.o = llength(lp);
+	s = scanner(exp, FORWARD, FALSE, at_bol, ic, &wrapped);
+	if (s != TRUE)
+	    break;
+
+	/*
+	 * A match past the end of the line, or found by wrapping back to its
+	 * beginning, depends on the replacements already made.
+	 */
+	if (wrapped || DOT.l != lp) {
+	    DOT.l = lp;
+	    return SORTOFTRUE;
+	}
+
+	/* found the pattern */
+	*foundp = TRUE;
+	which_occur++;
+	at_bol = FALSE;		/* at most, match "^" once */
+	if (nth_occur == -1 || which_occur == nth_occur) {
+	    C_NUM mlen = (C_NUM) exp->mlen;
+	    size_t before;
+
+	    /* only allow one match at the end of line, to
+	       prevent loop with s/$/x/g  */
+	    if (DOT.o == llength(lp)) {
+		if (matched_at_eol)
+		    break;
+		matched_at_eol = TRUE;
+	    }
+
+	    if ((size_t) count >= splice_size) {
+		splice_size = (splice_size + 8) * 2;
+		safe_typereallocn(SPLICE, splice_list, splice_size);
+		if (splice_list == NULL) {
+		    splice_size = 0;
+		    return no_memory("substline");
+		}
+	    }
+	    tb_bappend(&splice_text, lvalue(lp) + copied, (size_t) (DOT.o - copied));
+	    before = tb_length(splice_text);
+	    if ((s = subst_expand(exp,
+				  tb_values(replacepat),
+				  (int) tb_length(replacepat),
+				  &splice_text)) != TRUE)
+		return s;
+	    splice_list[count].sp_offset = DOT.o;
+	    splice_list[count].sp_delete = mlen;
+	    splice_list[count].sp_insert = (C_NUM) (tb_length(splice_text) - before);
+	    delta += splice_list[count].sp_insert - mlen;
+	    ++count;
+
+	    /* continue after the match, as if it were replaced */
+	    copied = DOT.o + mlen;
+	    DOT.o = copied;
+
+	    if (mlen == 0 && forwchar(TRUE, 1) == FALSE)
+		break;
+	    if (nth_occur > 0)
+		break;
+	} else {		/* non-overlapping matches */
+	    s = forwchar(TRUE, (int) (exp->mlen));
+	    if (s != TRUE)
+		return s;
+	}
+    } while (globally && sameline(scanboundpos, DOT));
+
+    if (count != 0) {
+	SPLICE *last = &splice_list[count - 1];
+	MARK after;
+
+	tb_bappend(&splice_text, lvalue(lp) + copied,
+		   (size_t) (llength(lp) - copied));
+	if (splice_text == NULL)
+	    return no_memory("substline");
+
+	after = DOT;
+	DOT.l = lp;
+	DOT.o = splice_list[0].sp_offset;
+	s = lsplice(tb_values(splice_text), tb_length(splice_text),
+		    splice_list, count);
+	if (s != TRUE) {
+	    mlforce("[Out of memory while inserting]");
+	    return FALSE;
+	}
+
+	/* leave dot and mark where delins() would have */
+	MK.l = lp;
+	MK.o = last->sp_offset + delta - (last->sp_insert - last->sp_delete);
+	DOT = after;
+	if (DOT.l == lp)
+	    DOT.o += delta;
+
+	lines_changed++;
+	total_changes += count;
+    }
+    return TRUE;
+}
+
 static int
 substline(regexp * exp, int nth_occur, int printit, int globally, int *confirmp)
 {
@@ -339,6 +468,22 @@ substline(regexp * exp, int nth_occur, int printit, int globally, int *confirmp)
 
     ic = window_b_val(curwp, MDIGNCASE);
 
+    /*
+     * Unless we must show each match, or the replacement splits the line, or
+     * the pattern looks at the text before a match (which is changed as we
+     * go), build the new line from the old one and replace it once.
+     */
+    if (!*confirmp
+	&& !exp->reglook
+	&& DOT.l != buf_head(curbp)
+	&& !subst_splits(tb_values(replacepat), (int) tb_length(replacepat))) {
+	s = subst_splice(exp, nth_occur, globally, at_bol, ic, &foundit);
+	if (s == TRUE)
+	    goto done;
+	if (s != SORTOFTRUE)
+	    returnCode(s);
+    }
+
     foundit = FALSE;
     scanboundpos.l = DOT.l;
     scanbound_is_header = FALSE;
@@ -424,6 +569,7 @@ substline(regexp * exp, int nth_occur, int printit, int globally, int *confirmp)
 		returnCode(s);
 	}
     } while (globally && sameline(scanboundpos, DOT));
+  done:
     if (foundit && printit) {
 	WINDOW *wp = curwp;
 	(void) setmark();
@@ -462,6 +608,139 @@ substline(regexp * exp, int nth_occur, int printit, int globally, int *confirmp)
 static char *buf_delins;
 static size_t len_delins;
 
+#define NO_CASE	0
+#define UPPER_CASE 1
+#define LOWER_CASE 2
+
+/*
+ * Apply the \u, \l, \U and \L case-changes to a character of replacement.
+ */
+static int
+subst_case(int c, int *case_next, int case_all)
+{
+    if (*case_next != NO_CASE || case_all != NO_CASE) {
+	int direction = (*case_next != NO_CASE) ? *case_next : case_all;
+	*case_next = NO_CASE;
+	/* Somewhat convoluted to handle
+	   \u\L correctly (upper case first
+	   char, lower case remainder).
+	   This is the perl model, not the vi model. */
+	if (isUpper(c) && (direction == LOWER_CASE))
+	    c = toLower(c);
+	if (isLower(c) && (direction == UPPER_CASE))
+	    c = toUpper(c);
+    }
+    return c;
+}
+
+/*
+ * Check if the replacement would split the line, which delins() does with
+ * lnewline().
+ */
+static int
+subst_splits(const char *sourc, int lensrc)
+{
+    int j;
+
+    for (j = 0; j < lensrc; ++j) {
+	if (sourc[j] == BACKSLASH) {
+	    if (++j < lensrc && sourc[j] == 'n')
+		return TRUE;
+	} else if (sourc[j] == '\n' || sourc[j] == '\r') {
+	    return TRUE;
+	}
+    }
+    return FALSE;
+}
+
+/*
+ * Append the replacement for the current match to "result", like delins()
+ * does in the buffer, but without changing the line.  The replacement must
+ * not split the line.
+ */
+static int
+subst_expand(regexp * exp, const char *sourc, int lensrc, TBUFF **result)
+{
+    int c;
+    int no;
+    int j;
+    int case_next, case_all;
+
+    case_next = case_all = NO_CASE;
+    for (j = 0; j < lensrc; ++j) {
+	c = sourc[j];
+	no = 0;
+	switch (c) {
+	case BACKSLASH:
+	    if (j + 1 >= lensrc)
+		break;
+	    c = sourc[++j];
+	    if (!isDigit(c)) {
+		switch (c) {
+		case 'U':
+		    case_all = UPPER_CASE;
+		    break;
+		case 'L':
+		    case_all = LOWER_CASE;
+		    break;
+		case 'u':
+		    case_next = UPPER_CASE;
+		    break;
+		case 'l':
+		    case_next = LOWER_CASE;
+		    break;
+		case 'E':
+		case 'e':
+		    case_all = NO_CASE;
+		    break;
+		case 'b':
+		    tb_append(result, '\b');
+		    break;
+		case 'f':
+		    tb_append(result, '\f');
+		    break;
+		case 'r':
+		    tb_append(result, '\r');
+		    break;
+		case 't':
+		    tb_append(result, '\t');
+		    break;
+		default:
+		    tb_append(result, c);
+		    break;
+		}
+		break;
+	    }
+	    /* else it's a digit --
+	       get pattern number, and fall through */
+	    no = c - '0';
+	    /* FALLTHROUGH */
+	case '&':
+	    if (exp->startp[no] != NULL && exp->endp[no] != NULL) {
+		const char *cp = exp->startp[no];
+		while (cp != exp->endp[no]) {
+		    c = *cp++;
+		    if (c == EOS) {
+			mlforce("BUG: mangled replace");
+			return FALSE;
+		    }
+		    tb_append(result, subst_case(c, &case_next, case_all));
+		}
+	    }
+	    break;
+
+	default:
+	    tb_append(result, subst_case(c, &case_next, case_all));
+	    break;
+	}
+    }
+    if (*result == NULL) {
+	mlforce("[Out of memory while inserting]");
+	return FALSE;
+    }
+    return TRUE;
+}
+
 /*
  - delins - perform substitutions after a regexp match
  */
@@ -473,9 +752,6 @@ delins(regexp * exp, char *sourc, int lensrc)
     int no;
     int j;
     int s;
-#define NO_CASE	0
-#define UPPER_CASE 1
-#define LOWER_CASE 2
     int case_next, case_all;
 
     if (exp == NULL || sourc == NULL) {
@@ -575,21 +851,8 @@ delins(regexp * exp, char *sourc, int lensrc)
 		    }
 		    if (c == '\n')
 			s = lnewline();
-		    else if (case_next == NO_CASE && case_all == NO_CASE)
-			s = lins_bytes(1, c);
-		    else {
-			int direction = case_next != NO_CASE ? case_next : case_all;
-			case_next = NO_CASE;
-			/* Somewhat convoluted to handle
-			   \u\L correctly (upper case first
-			   char, lower case remainder).
-			   This is the perl model, not the vi model. */
-			if (isUpper(c) && (direction == LOWER_CASE))
-			    c = toLower(c);
-			if (isLower(c) && (direction == UPPER_CASE))
-			    c = toUpper(c);
-			s = lins_bytes(1, c);
-		    }
+		    else
+			s = lins_bytes(1, subst_case(c, &case_next, case_all));
 		}
 	    }
 	    break;
@@ -600,19 +863,7 @@ delins(regexp * exp, char *sourc, int lensrc)
 	    break;
 
 	default:
-	    if (case_next || case_all) {
-		int direction = case_next != NO_CASE ? case_next : case_all;
-		case_next = NO_CASE;
-		/* Somewhat convoluted to handle
-		   \u\L correctly (upper case first
-		   char, lower case remainder).
-		   This is the perl model, not the vi model. */
-		if (isUpper(c) && (direction == LOWER_CASE))
-		    c = toLower(c);
-		if (isLower(c) && (direction == UPPER_CASE))
-		    c = toUpper(c);
-	    }
-	    s = lins_bytes(1, c);
+	    s = lins_bytes(1, subst_case(c, &case_next, case_all));
 	    break;
 	}
 	if (s != TRUE) {
@@ -629,5 +880,7 @@ onel_leaks(void)
 {
     FreeIfNeeded(substexp);
     FreeIfNeeded(buf_delins);
+    FreeIfNeeded(splice_list);
+    tb_free(&splice_text);
 }
 #endif
@@ -254,9 +254,13 @@ extern BUFFER *bfind (const char *bname, UINT bflag);
 extern BUFFER *find_alt (void);
 extern BUFFER *find_any_buffer (const char *name);
 extern BUFFER *find_b_file (const char *fname);
+extern BUFFER *find_b_fname (const char *nfname);
 extern BUFFER *find_b_hist(int number);
 extern BUFFER *find_b_name (const char *name);
 extern BUFFER *find_bp (BUFFER *bp1);
+#ifdef CAN_CHECK_INO
+extern BUFFER *find_b_fuid (FUID * fuid);
+#endif
 extern BUFFER *getfile2bp (const char *fname, int ok_to_ask, int cmdline);
 extern BUFFER *make_bp (const char *fname, UINT flags);
 extern BUFFER *make_ro_bp(const char *bname, UINT flags);
@@ -292,6 +296,7 @@ extern void buffer_flags (char *dst, BUFFER *bp);
 extern void chg_buff (BUFFER *bp, unsigned flag);
 extern void imply_alt (char *fname, int copy, int lockfl);
 extern void make_current (BUFFER *nbp);
+extern void reindex_buffer (BUFFER *bp);
 extern void set_bname (BUFFER *bp, const char *name);
 extern void set_editor_title(void);
 extern void set_last_bp (BUFFER *nbp);
@@ -334,6 +339,7 @@ extern const char *encoding2s(int code);
 extern int decode_bom (BUFFER *bp, UCHAR *buffer, B_COUNT *length);
 extern int decode_charset (BUFFER *bp, LINE *lp);
 extern int deduce_charset (BUFFER *bp, UCHAR *buffer, B_COUNT *length, int always);
+extern int deduce_charset_block (BUFFER *bp, UCHAR *buffer, B_COUNT *length, UCHAR **decoded);
 extern int encode_charset(BUFFER *bp, const char *buf, int nbuf, const char *ending);
 extern int write_bom (BUFFER *bp);
 
@@ -609,6 +615,10 @@ extern int execute (const CMDFUNC *execfunc, int f, int n);
 extern int more_named_cmd (void);
 extern int user_operator (void);
 
+#if !SMALLER
+extern void free_maccode (BUFFER *bp);
+#endif
+
 /* file.c */
 extern GCC_NORETURN SIGT imdying (int ACTUAL_SIG_ARGS);
 extern int bp2readin (BUFFER *bp, int lockfl);
@@ -639,6 +649,23 @@ extern void markWFMODE (BUFFER *bp);
 extern void set_last_file_edited (const char *);
 extern void unqname (char *name);
 
+#if OPT_LAZY_READER
+extern int lazyreadf_idle (void);
+extern void lazyreadf_finish (BUFFER *bp);
+extern void lazyreadf_finish_all (void);
+#define lazyreadf_pending(bp) ((bp)->b_lazyfp != NULL)
+#else
+#define lazyreadf_idle() FALSE
+#define lazyreadf_pending(bp) FALSE
+#define lazyreadf_finish(bp) /* nothing */
+#define lazyreadf_finish_all() /* nothing */
+#endif
+
+#if OPT_UNDOFILE
+extern FILE *open_undo_file (BUFFER *bp, int writing);
+extern void remove_undo_file (BUFFER *bp);
+#endif
+
 #ifdef MDCHK_MODTIME
 extern int ask_shouldchange (BUFFER *bp);
 extern int check_file_changed (BUFFER *bp, char *fn);
@@ -650,6 +677,11 @@ extern int get_modtime (BUFFER *bp, time_t *the_time);
 extern void set_modtime (BUFFER *bp, char *fn);
 #endif
 
+#if defined(MDCHK_MODTIME) && OPT_FILE_WATCH
+extern void unwatch_buffer_file (BUFFER *bp);
+extern void watch_buffer_file (BUFFER *bp);
+#endif
+
 #if SMALLER	/* cancel neproto.h */
 extern int filesave (int f, int n);
 #endif
@@ -687,6 +719,11 @@ extern void ffseek (B_COUNT n);
 extern void ffdocrypt (int crypting);
 #endif
 
+#if OPT_LAZY_READER
+extern FILE * ffkeep (void);
+extern int ffreadmore (FILE *fp, char *buf, B_COUNT want, B_COUNT *have);
+#endif
+
 /* finderr.c */
 #if OPT_FINDERR
 extern const char * get_febuff (void);
@@ -855,6 +892,7 @@ extern void release_lock (const char *fname);
 
 /* line.c */
 extern LINE *lalloc (int used, BUFFER *bp);
+extern char *ltextalloc (BUFFER *bp, size_t *sizep);
 extern int begin_kill (void);
 extern int do_report (L_NUM value);
 extern int index2reg (int c);
@@ -864,7 +902,9 @@ extern int kinsertlater (int c);
 extern int ldel_bytes (B_COUNT n, int kflag);
 extern int lreplc(LINE *lp, C_NUM off, int c);
 extern int lins_bytes (int n, int c);
+extern int lins_text (const char *text, size_t length);
 extern int lnewline (void);
+extern int lsplice (const char *text, size_t length, const SPLICE *edits, int count);
 extern int lstrinsert (TBUFF *tp, int len);
 extern int reg2index (int c);
 extern void end_kill (void);
@@ -874,8 +914,25 @@ extern void ksetup (void);
 extern void lfree (LINE *lp, BUFFER *bp);
 extern void lremove (BUFFER *bp, LINE *lp);
 extern void lremove2 (BUFFER *bp, LINE *lp);
+extern void lremove_all (BUFFER *bp);
 extern void ltextfree (LINE *lp, BUFFER *bp);
 
+#if !SMALLER
+extern LINE *lindex_line (BUFFER *bp, L_NUM num);
+extern L_NUM lindex_number (BUFFER *bp, LINE *lp);
+extern int lindex_check (BUFFER *bp);
+extern void lindex_clear (BUFFER *bp);
+extern void lindex_insert (BUFFER *bp, LINE *lp);
+extern void lindex_remove (BUFFER *bp, LINE *lp);
+extern void lindex_replace (BUFFER *bp, LINE *olp, LINE *nlp);
+#else
+#define lindex_check(bp) FALSE
+#define lindex_clear(bp) /* nothing */
+#define lindex_insert(bp, lp) /* nothing */
+#define lindex_remove(bp, lp) /* nothing */
+#define lindex_replace(bp, olp, nlp) /* nothing */
+#endif
+
 #if OPT_EVAL
 extern int lrepl_ctype (CHARTYPE type, const char *iline, int ilen);
 extern int lrepl_regex (REGEXVAL *expr, const char *iline, int ilen);
@@ -1109,6 +1166,7 @@ extern char * home_path (char *path);
 /* random.c */
 extern L_NUM line_no (BUFFER *the_buffer, LINE *the_line);
 extern L_NUM vl_line_count (BUFFER *the_buffer);
+extern LINE * line_at (BUFFER *the_buffer, L_NUM line_num);
 extern TBUFF * tb_visbuf (const char *buffer, size_t len);
 extern char * current_directory (int force);
 extern char * vl_vischr (char *buffer, int ch);
@@ -1148,7 +1206,7 @@ extern int vl_stricmp (const char *a, const char *b);
 extern int vl_strnicmp (const char *a, const char *b, size_t n);
 #endif
 
-#if (OPT_AUTOCOLOR || OPT_ELAPSED) && defined(VL_ELAPSED)
+#if (OPT_AUTOCOLOR || OPT_ELAPSED || OPT_SHOW_SCREEN) && defined(VL_ELAPSED)
 extern double vl_elapsed(VL_ELAPSED * first, int begin);
 #endif
 
@@ -1194,6 +1252,7 @@ extern void update_dos_drv_dir (char * cwd);
 extern int cregexec (regexp *prog, LINE *lp, int startoff, int endoff, int at_bol, int ic);
 extern int lregexec (regexp *prog, LINE *lp, int startoff, int endoff, int ic);
 extern int nregexec (regexp *prog, char *string, char *stringend, int startoff, int endoff, int ic);
+extern regexp * regcomp_cached (const char *exp_text, size_t exp_len, int magic);
 
 /* region.c */
 typedef int (*DORGNLINES)(int (*)(REGN_ARGS), void *, int);
@@ -1234,6 +1293,7 @@ extern int fsearch (int f, int n, int marking, int fromscreen);
 extern int readpattern (const char *prompt, TBUFF **apat, regexp **srchexpp, int c, int fromscreen);
 extern int scanner (regexp *exp, int direct, int wrapok, int at_bol, int ic, int *wrappedp);
 extern void attrib_matches (void);
+extern void attrib_more_matches (void);
 extern void scanboundry (int wrapok, MARK dot, int dir);
 
 #if OPT_HILITEMATCH
@@ -1260,6 +1320,9 @@ extern	void	do_sweep	(int flag);
 extern	void	find_release_attr (BUFFER *bp, REGION *rp);
 extern	void	free_attrib2	(BUFFER *bp, AREGION **rpp);
 extern	void	free_attribs	(BUFFER *bp);
+extern	void	index_attrib	(BUFFER *bp, AREGION *ap);
+extern	AREGION *line_attribs	(BUFFER *bp, LINE *lp);
+extern	void	reindex_attrib	(BUFFER *bp, AREGION *ap);
 extern	void	sel_reassert_ownership (BUFFER *bp);
 extern	void	sel_release	(void);
 
@@ -1414,6 +1477,7 @@ extern	void	setkey	(const char *schl);
 /* undo.c */
 extern int  check_editable (BUFFER *bp);
 extern int  copy_for_undo (LINE *lp);
+extern int  copy_part_for_undo (LINE *lp, C_NUM offset, C_NUM length);
 extern int  redo_ok(void);
 extern int  tag_for_undo (LINE *lp);
 extern int  undo_ok(void);
@@ -1423,12 +1487,18 @@ extern void mayneedundo (void);
 extern void nounmodifiable (BUFFER *bp);
 extern void toss_to_undo (LINE *lp);
 
+#if OPT_UNDOFILE
+extern void read_undo_file (BUFFER *bp);
+extern void write_undo_file (BUFFER *bp);
+#endif
+
 #define OkUndo(bp) \
     (!is_delinked_bp(bp) \
      &&  b_val(bp, MDUNDOABLE) \
      && !b_is_scratch(bp))
 
 #define CopyForUndo(lp) if (OkUndo(curbp)) copy_for_undo (lp)
+#define CopyPartForUndo(lp,off,len) if (OkUndo(curbp)) copy_part_for_undo (lp, off, len)
 #define TagForUndo(lp)  if (OkUndo(curbp)) tag_for_undo (lp)
 #define TossToUndo(lp)  if (OkUndo(curbp)) toss_to_undo (lp)
 
@@ -1602,6 +1672,7 @@ extern int  w32_message_box(HWND hwnd, const char *message, int code);
 
 /* watchfd.c */
 extern int watchfd(int fd, WATCHTYPE type, char *callback);
+extern int watchfd_func(int fd, WATCHTYPE type, WatchFunc handler);
 extern void unwatchfd(int fd);
 extern void dowatchcallback(int fd);
 
@@ -1720,6 +1791,7 @@ extern	void	map_leaks (void);
 extern	void	mode_leaks (void);
 extern	void	onel_leaks (void);
 extern	void	path_leaks (void);
+extern	void	regexp_leaks (void);
 extern	void	tags_leaks (void);
 extern	void	tb_leaks (void);
 extern	void	tcap_leaks (void);
@@ -324,15 +324,17 @@ vl_line_count(BUFFER *the_buffer)
 {
     L_NUM numlines = 0;		/* # of lines in file */
     if (the_buffer != NULL) {
-#if SMALLER
-	LINE *lp;		/* current line */
-
-	for_each_line(lp, the_buffer)
-	    ++ numlines;
-#else
-	(void) bsizes(the_buffer);
-	numlines = the_buffer->b_linecount;
+#if !SMALLER
+	if (lindex_check(the_buffer)) {
+	    numlines = the_buffer->b_lchunks_lines;
+	} else
 #endif
+	{
+	    LINE *lp;		/* current line */
+
+	    for_each_line(lp, the_buffer)
+		++ numlines;
+	}
     }
     return numlines;
 }
@@ -344,24 +346,56 @@ line_no(BUFFER *the_buffer, LINE *the_line)
     L_NUM line_num = 0;
 
     if (the_line != NULL) {
-#if SMALLER
-	LINE *lp;
+#if !SMALLER
+	if (lindex_check(the_buffer)) {
+	    if ((line_num = lindex_number(the_buffer, the_line)) == 0)
+		line_num = the_buffer->b_lchunks_lines + 1;
+	} else
+#endif
+	{
+	    LINE *lp;
 
-	line_num = 1;
-	for_each_line(lp, the_buffer) {
-	    if (lp == the_line)	/* found current line? */
-		break;
-	    ++line_num;
+	    line_num = 1;
+	    for_each_line(lp, the_buffer) {
+		if (lp == the_line)	/* found current line? */
+		    break;
+		++line_num;
+	    }
 	}
-#else
-	(void) bsizes(the_buffer);
-	if ((line_num = the_line->l_number) == 0)
-	    line_num = the_buffer->b_linecount + 1;
-#endif
     }
     return line_num;
 }
 
+/*
+ * Return the line with the given number (counting from 1), or null if the
+ * buffer has fewer lines.  Except for SMALLER, this uses the line-numbering
+ * index, which edits keep up to date, rather than walking the list.
+ */
+LINE *
+line_at(BUFFER *the_buffer, L_NUM line_num)
+{
+    LINE *result = NULL;
+
+    if (the_buffer != NULL && line_num > 0) {
+#if !SMALLER
+	if (lindex_check(the_buffer)) {
+	    result = lindex_line(the_buffer, line_num);
+	} else
+#endif
+	{
+	    LINE *lp;
+
+	    for_each_line(lp, the_buffer) {
+		if (--line_num == 0) {
+		    result = lp;
+		    break;
+		}
+	    }
+	}
+    }
+    return result;
+}
+
 #if OPT_EVAL
 /*
  * Returns the index of the mark in the buffer
@@ -1564,6 +1598,7 @@ ch_fname(BUFFER *bp, const char *fname)
 		    bp->b_fnlen = (int) strlen(bp->b_fname);
 		    no_memory("ch_fname");
 		    (void) free(np);
+		    reindex_buffer(bp);
 		    endofDisplay();
 		    return;
 		}
@@ -1578,12 +1613,16 @@ ch_fname(BUFFER *bp, const char *fname)
 	    updatelistbuffers();
 	}
 #ifdef	MDCHK_MODTIME
+#if OPT_FILE_WATCH
+	watch_buffer_file(bp);
+#endif
 	(void) get_modtime(bp, &(bp->b_modtime));
 	bp->b_modtime_at_warn = 0;
 #endif
 	fileuid_set_if_valid(bp, fname);
 	(void) free(np);
     }
+    reindex_buffer(bp);
     endofDisplay();
 }
 
@@ -1652,7 +1691,7 @@ run_readhook(void)
 }
 #endif
 
-#if (OPT_AUTOCOLOR || OPT_ELAPSED) && defined(VL_ELAPSED)
+#if (OPT_AUTOCOLOR || OPT_ELAPSED || OPT_SHOW_SCREEN) && defined(VL_ELAPSED)
 /*
  * Returns elapsed time in milliseconds.
  */
@@ -133,6 +133,10 @@ typedef ULONG B_COUNT;		/* byte-count */
 #include <edef.h>		/* use global data from vile */
 #endif
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #if !defined(OPT_WORKING) || defined(DEBUG_REGEXP)
 # undef  beginDisplay
 # define beginDisplay()		/* nothing */
@@ -199,6 +203,9 @@ static inline char *regnext(char *p);
 static int regmatch(char *prog, int plevel, int ic);
 static int regrepeat(const char *p, int ic);
 static int regtry(regexp * prog, char *string, char *stringend, int plevel, int ic);
+static regexp *regfast_init(regexp * r, size_t progsize);
+static regexp *regclass_init(regexp * r, int count);
+static int reg_rare_pair(const char *s, size_t len, int ic);
 static void regc(int b);
 static void regninsert(int n, char *opnd);
 static void regopinsert(int op, char *opnd);
@@ -225,6 +232,10 @@ static const char *regprop(char *op);
  * regmust	string (starting at program[offset]) that match must
  *				include, or NULL
  * regmlen	length of regmust string
+ * regfast	offset (in program[]) of the shift-and tables for a fixed-length
+ *		pattern, or -1 if none
+ * regclass	offset (in program[]) of the results remembered for each
+ *		bracket expression, or -1 if there are none
  *
  * Regstart and reganch permit very fast decisions on suitable starting points
  * for a match, cutting down the work a lot.  Regmust permits fast rejection
@@ -470,6 +481,10 @@ typedef enum {
  * OPERAND() so we can allow it to contain embedded nulls.  We cannot use
  * NEXT() for this purpose, since it may contain an offset past additional
  * operations following the current one.
+ *
+ * The null which ends the OPERAND() of ANYOF and ANYBUT is followed by two
+ * bytes giving the CLASS_INDEX() of the bracket expression, i.e., where its
+ * results are remembered in the table found with the "regclass" offset.
  */
 
 #define OP_HDR		5	/* header chars in normal operation */
@@ -479,6 +494,8 @@ typedef enum {
 #define	OPSIZE(p)	((unsigned)((CharOf((p)[3]) << 8) + CharOf((p)[4])))
 #define	OPSIZE2(p)	(((size_t)(CharOf((p)[3])) << 8) + ((size_t)CharOf((p)[4])))
 #define	OPERAND(p)	((p) + OP_HDR)
+#define	CLASS_INDEX(p)	((unsigned)((CharOf(OPERAND(p)[OPSIZE(p) + 1]) << 8) \
+				  + CharOf(OPERAND(p)[OPSIZE(p) + 2])))
 
 #define HI_BYTE(n)	(char)((n) >> 8)
 #define LO_BYTE(n)	(char)(n)
@@ -540,6 +557,9 @@ static char regdummy;
 static char *regcode;		/* Code-emit pointer; &regdummy = don't. */
 static long regsize;		/* Code size. */
 
+static int reglook;		/* saw \< or \> */
+static int regclasses;		/* count of bracket expressions */
+
 static char *op_pointer;	/* cached from regnode() */
 static int op_length;		/* ...corresponding operand-length */
 
@@ -861,6 +881,7 @@ regcomp(const char *exp_text, size_t exp_len, int magic)
 {
     regexp *r;
     char *scan;
+    char *first;
     char *longest;
     size_t len;
     size_t parsed_len;
@@ -906,6 +927,8 @@ regcomp(const char *exp_text, size_t exp_len, int magic)
     reglimit = exp + parsed_len;
     regnpar = 1;
     regsize = 0;
+    reglook = 0;
+    regclasses = 0;
     regcode = &regdummy;
     regc(REGEXP_MAGIC);
     if (reg(0, &flags) == NULL)
@@ -929,12 +952,14 @@ regcomp(const char *exp_text, size_t exp_len, int magic)
     /* how big is it?  (vile addition) */
     r->size = sizeof(regexp) + (size_t) regsize;
     r->uppercase = uppercase;
+    r->reglook = reglook;
 
     /* Second pass: emit code. */
     REGTRACE(("Second pass: emit code\n"));
     regparse = exp;
     reglimit = exp + parsed_len;
     regnpar = 1;
+    regclasses = 0;
     regcode = r->program;
     regc(REGEXP_MAGIC);
     if (reg(0, &flags) == NULL) {
@@ -947,6 +972,9 @@ regcomp(const char *exp_text, size_t exp_len, int magic)
     r->reganch = 0;
     r->regmust = -1;
     r->regmlen = 0;
+    r->regmprefix = 0;
+    r->regrare = -1;
+    r->regrare_ic = -1;
     scan = r->program + 1;	/* First BRANCH. */
     if (OP(regnext(scan)) == END) {	/* Only one top-level choice. */
 	scan = OPERAND(scan);
@@ -962,27 +990,33 @@ regcomp(const char *exp_text, size_t exp_len, int magic)
 	}
 
 	/*
-	 * If there's something expensive in the r.e., find the
-	 * longest literal string that must appear and make it the
-	 * regmust.  Resolve ties in favor of later strings, since
-	 * the regstart check works with the beginning of the r.e.
-	 * and avoiding duplication strengthens checking.  Not a
-	 * strong reason, but sufficient in the absence of others.
+	 * Find the longest literal string that must appear and make it the
+	 * regmust.  Resolve ties in favor of later strings, since the
+	 * regstart check works with the beginning of the r.e.  and avoiding
+	 * duplication strengthens checking.  Not a strong reason, but
+	 * sufficient in the absence of others.
+	 *
+	 * vile addition:  this is done for all patterns (not only those
+	 * beginning with * or +), since reg_find_must() can reject most
+	 * lines without entering regmatch().
 	 */
-	if (flags & SPSTART) {
-	    longest = NULL;
-	    len = 0;
-	    for (; scan != NULL; scan = regnext(scan))
-		if (OP(scan) == EXACTLY && OPSIZE2(scan) >= len) {
-		    longest = OPERAND(scan);
-		    len = OPSIZE2(scan);
-		}
-	    if (longest) {
-		r->regmust = (int) (longest - r->program);
-		r->regmlen = len;
+	longest = NULL;
+	len = 0;
+	for (first = scan; scan != NULL; scan = regnext(scan))
+	    if (OP(scan) == EXACTLY && OPSIZE2(scan) >= len) {
+		longest = OPERAND(scan);
+		len = OPSIZE2(scan);
 	    }
+	if (longest) {
+	    r->regmust = (int) (longest - r->program);
+	    r->regmlen = len;
+	    r->regmprefix = (char) (longest == OPERAND(first));
+	    r->regrare = reg_rare_pair(longest, len, FALSE);
+	    r->regrare_ic = reg_rare_pair(longest, len, TRUE);
 	}
     }
+    r = regfast_init(r, (size_t) regsize);
+    r = regclass_init(r, regclasses);
 #if NO_LEAKS
     if (exp != NULL) {
 	beginDisplay();
@@ -1420,9 +1454,11 @@ regatom(int *flagp, int at_bop)
 	break;
     case '<':
 	ret = regnode(BEGWORD);
+	reglook = 1;
 	break;
     case '>':
 	ret = regnode(ENDWORD);
+	reglook = 1;
 	break;
     case '.':
 	ret = regnode(ANY);
@@ -1482,6 +1518,9 @@ regatom(int *flagp, int at_bop)
 		}
 	    }
 	    set_opsize();
+	    regc(HI_BYTE(regclasses));
+	    regc(LO_BYTE(regclasses));
+	    regclasses++;
 	    if (*regparse != ']') {
 		regerror("unmatched []");
 		return NULL;
@@ -1857,6 +1896,502 @@ RegStrChr2(const char *s, unsigned length, const char *cs, int ic)
     return matched;
 }
 
+/*
+ * Rank bytes by how often they occur in typical text, to choose the part of
+ * the regmust string which is least likely to match by chance.  Bytes not
+ * listed are rare, e.g., control characters and most punctuation.
+ */
+static int
+reg_byte_rank(int ch)
+{
+    static const char common[] = "etaoinsrlhdcumfpgwybvkxjqz _\t,.;()=*/\"";
+    const char *p;
+    int rank = 0;
+
+    if (ch != EOS && (p = strchr(common, ch)) != NULL) {
+	rank = 100 + (int) (sizeof(common) - (size_t) (p - common));
+    } else if (ch >= 'A' && ch <= 'Z') {
+	rank = 60;
+    } else if (ch >= '0' && ch <= '9') {
+	rank = 50;
+    } else if (ch >= 128) {
+	rank = 20;
+    }
+    return rank;
+}
+
+/*
+ * Return the offset within the regmust string of the pair of adjacent bytes
+ * (or the single byte, if the string is that short) which reg_find_must()
+ * should look for, or -1 if there is none.  For ignorecase, only bytes which
+ * have no case-variants can be used.
+ */
+static int
+reg_rare_pair(const char *s, size_t len, int ic)
+{
+    int result = -1;
+    int best = 0;
+    size_t n;
+
+#define CaseLess(n) (!ic || (CharOf(s[n]) < 128 \
+			     && !(s[n] >= 'a' && s[n] <= 'z') \
+			     && !(s[n] >= 'A' && s[n] <= 'Z')))
+    if (len == 1) {
+	if (CaseLess(0))
+	    result = 0;
+    } else {
+	for (n = 0; n + 1 < len; ++n) {
+	    if (CaseLess(n) && CaseLess(n + 1)) {
+		int rank = (reg_byte_rank(CharOf(s[n]))
+			    + reg_byte_rank(CharOf(s[n + 1])));
+		if (result < 0 || rank < best) {
+		    result = (int) n;
+		    best = rank;
+		}
+	    }
+	}
+    }
+#undef CaseLess
+    return result;
+}
+
+/*
+ * Find the first place in [s..last) where the bytes c1 and c2 are adjacent.
+ * Use SSE2 to test 16 positions at a time where it is available.
+ */
+static char *
+reg_find_pair(char *s, char *last, int c1, int c2)
+{
+#if defined(__SSE2__)
+    __m128i want1 = _mm_set1_epi8((char) c1);
+    __m128i want2 = _mm_set1_epi8((char) c2);
+
+    while (last - s > 16) {
+	__m128i have1 = _mm_loadu_si128((const __m128i *) (const void *) s);
+	__m128i have2 = _mm_loadu_si128((const __m128i *) (const void *) (s + 1));
+	int mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(have1, want1),
+						   _mm_cmpeq_epi8(have2, want2)));
+	if (mask != 0) {
+	    while (!(mask & 1)) {
+		mask >>= 1;
+		++s;
+	    }
+	    return s;
+	}
+	s += 16;
+    }
+#endif
+    while (last - s > 1) {
+	char *p = (char *) memchr(s, c1, (size_t) (last - s - 1));
+
+	if (p == NULL)
+	    break;
+	if (CharOf(p[1]) == c2)
+	    return p;
+	s = p + 1;
+    }
+    return NULL;
+}
+
+/*
+ * Look for the regmust string in [s..stringend), returning the first place
+ * where it begins before endsrch.  Search for its rarest byte-pair, and check
+ * the rest of the string only where that is found.
+ */
+static char *
+reg_find_must(regexp * prog, char *s, char *stringend, char *endsrch, int ic)
+{
+    char *must = &(prog->program[prog->regmust]);
+    size_t len = prog->regmlen;
+    int rare = ic ? prog->regrare_ic : prog->regrare;
+    char *hit;
+
+    if ((size_t) (stringend - s) < len)
+	return NULL;
+    s += rare;
+    while (s < stringend) {
+	if (len == 1) {
+	    hit = (char *) memchr(s, CharOf(must[0]), (size_t) (stringend - s));
+	} else {
+	    hit = reg_find_pair(s, stringend,
+				CharOf(must[rare]),
+				CharOf(must[rare + 1]));
+	}
+	if (hit == NULL || (hit - rare) >= endsrch)
+	    break;
+	if (regstrncmp(hit - rare, must, len, stringend, ic) == 0)
+	    return (hit - rare);
+	s = hit + 1;
+    }
+    return NULL;
+}
+
+/*
+ * Patterns which match a fixed number of characters, e.g., literal strings
+ * with "." wildcards, character classes or repeat-counts such as \{4\}, and
+ * no closures or alternation, can be scanned with a bit-parallel (shift-and)
+ * automaton.  Bit "k" of the state is set when the last k+1 characters read
+ * match the first k+1 positions of the pattern, so a match is found in one
+ * pass over the string with no backtracking.  The automaton may accept a
+ * superset of the actual matches (it ignores \< and \>), so each match it
+ * finds is confirmed with regtry(), which also fills in the subexpressions.
+ *
+ * regcomp() records the positions; the table of bits for each byte is built
+ * on first use, and rebuilt if ignorecase or the character classes change.
+ */
+#define REG_FAST_MAX	((int) (sizeof(ULONG) * 8))
+
+typedef struct {
+    int length;			/* number of characters in a match */
+    int at_eol;			/* pattern ends with "$" */
+    int utf8;			/* reg_utf8flag when compiled */
+    int built;			/* true if table[] is valid... */
+    int ic;			/* ...for this ignorecase */
+    UINT ctype;			/* ...and these character classes */
+    char what[REG_FAST_MAX];	/* opcode for each position */
+    int data[REG_FAST_MAX];	/* EXACTLY: the character, else node offset */
+    ULONG table[N_chars];	/* positions matching each single byte */
+} REGFAST;
+
+#if OPT_MULTIBYTE
+#define REG_UTF8FLAG reg_utf8flag
+#else
+#define REG_UTF8FLAG 0
+#endif
+
+#if OPT_VILE_CTYPE
+#define REG_CTYPE_GEN vl_ctype_gen
+#else
+#define REG_CTYPE_GEN 0
+#endif
+
+#define REG_FAST(prog) ((REGFAST *) (void *) ((prog)->program + (prog)->regfast))
+
+/*
+ * Add 'count' copies of the single-character node 'node' to the positions.
+ */
+static int
+regfast_node(REGFAST * fp, const char *program, char *node, int count)
+{
+    int n;
+
+    for (n = 0; n < count; ++n) {
+	if (fp->length >= REG_FAST_MAX)
+	    return FALSE;
+	fp->what[fp->length] = OP(node);
+	if (OP(node) == EXACTLY) {
+	    fp->data[fp->length] = WCHAR_AT(OPERAND(node),
+					     OPERAND(node) + OPSIZE(node));
+	} else {
+	    fp->data[fp->length] = (int) (node - program);
+	}
+	fp->length++;
+    }
+    return TRUE;
+}
+
+/*
+ * Check if the compiled program can be matched with the shift-and automaton,
+ * and if so, append its description to the program.
+ */
+static regexp *
+regfast_init(regexp * r, size_t progsize)
+{
+    REGFAST temp;
+    char *scan;
+    char *next;
+    char *opnd;
+    char *last;
+    int ok = TRUE;
+    int min;
+    int max;
+
+    r->regfast = -1;
+    if (r->reganch)
+	return r;
+
+    memset(&temp, 0, sizeof(temp));
+    temp.utf8 = REG_UTF8FLAG;
+
+    for (scan = r->program + 1; ok && scan != NULL; scan = next) {
+	next = regnext(scan);
+	if (temp.at_eol && OP(scan) != END) {
+	    ok = FALSE;
+	    break;
+	}
+	switch (OP(scan)) {
+	case END:
+	    next = NULL;
+	    break;
+	case BRANCH:
+	    if (next != NULL && OP(next) == BRANCH)
+		ok = FALSE;
+	    else
+		next = OPERAND(scan);
+	    break;
+	case EOL:
+	    temp.at_eol = TRUE;
+	    break;
+	case BEGWORD:		/* FALLTHRU */
+	case ENDWORD:		/* FALLTHRU */
+	case NOTHING:		/* FALLTHRU */
+	case OPEN:		/* FALLTHRU */
+	case OPENn:		/* FALLTHRU */
+	case CLOSE:		/* FALLTHRU */
+	case CLOSEn:
+	    break;
+	case EXACTLY:
+	    opnd = OPERAND(scan);
+	    last = opnd + OPSIZE(scan);
+	    while (ok && opnd < last) {
+		if (temp.length >= REG_FAST_MAX) {
+		    ok = FALSE;
+		} else {
+		    temp.what[temp.length] = EXACTLY;
+		    temp.data[temp.length] = WCHAR_AT(opnd, last);
+		    temp.length++;
+		    opnd += BYTES_AT(opnd, last);
+		}
+	    }
+	    break;
+	case RSIMPLE:
+	    min = get_RR_MIN(scan);
+	    max = get_RR_MAX(scan);
+	    if (min <= 0 || min != max)
+		ok = FALSE;
+	    else
+		ok = regfast_node(&temp, r->program, scan + RR_LEN, min);
+	    break;
+	case ANY:		/* FALLTHRU */
+	case ANYOF:		/* FALLTHRU */
+	case ANYBUT:
+	    ok = regfast_node(&temp, r->program, scan, 1);
+	    break;
+#define case_CLASSES(with,without) \
+	case with: \
+	case without: \
+	    ok = regfast_node(&temp, r->program, scan, 1); \
+	    break
+
+	    expand_case_CLASSES();
+
+#undef case_CLASSES
+	default:
+	    ok = FALSE;
+	    break;
+	}
+    }
+
+    if (ok && temp.length > 0) {
+	size_t base = (size_t) (r->program - (char *) r);
+	size_t offset = ((base + progsize + sizeof(ULONG) - 1)
+			 / sizeof(ULONG)) * sizeof(ULONG);
+	regexp *r2;
+
+	beginDisplay();
+	r2 = castrealloc(regexp, r, offset + sizeof(REGFAST));
+	endofDisplay();
+	if (r2 != NULL) {
+	    r = r2;
+	    r->size = offset + sizeof(REGFAST);
+	    r->regfast = (int) (offset - base);
+	    memcpy(REG_FAST(r), &temp, sizeof(temp));
+	}
+    }
+    return r;
+}
+
+/*
+ * Test if the character at 'source' matches position 'k' of the pattern.
+ */
+static int
+regfast_test(regexp * prog, REGFAST * fp, int k, const char *source, int ic)
+{
+    char *node = prog->program + fp->data[k];
+    int rc = FALSE;
+
+    switch (fp->what[k]) {
+    case EXACTLY:
+	rc = EQ_CHARS(fp->data[k], WCHAR_AT(source, regnomore), ic);
+	break;
+    case ANY:
+	rc = TRUE;
+	break;
+    case ANYOF:
+	rc = (RegStrChr2(OPERAND(node), OPSIZE(node), source, ic) != 0);
+	break;
+    case ANYBUT:
+	rc = (RegStrChr2(OPERAND(node), OPSIZE(node), source, ic) == 0);
+	break;
+#define case_CLASSES(with,without) \
+    case with: \
+	rc = is_CLASS(with, source); \
+	break; \
+    case without: \
+	rc = !is_CLASS(with, source); \
+	break
+
+	expand_case_CLASSES();
+
+#undef case_CLASSES
+    }
+    return rc;
+}
+
+static ULONG
+regfast_bits(regexp * prog, REGFAST * fp, const char *source, int ic)
+{
+    ULONG result = 0;
+    int k;
+
+    for (k = 0; k < fp->length; ++k) {
+	if (regfast_test(prog, fp, k, source, ic))
+	    result |= (1UL << k);
+    }
+    return result;
+}
+
+static void
+regfast_build(regexp * prog, REGFAST * fp, int ic)
+{
+    static char source[2];
+    int limit = fp->utf8 ? 128 : N_chars;
+    int ch;
+
+    TRACE(("regfast_build %d positions%s\n", fp->length, ic ? " ic" : ""));
+    memset(fp->table, 0, sizeof(fp->table));
+    source[1] = EOS;
+    regnomore = source + 1;
+    for (ch = 0; ch < limit; ++ch) {
+	source[0] = (char) ch;
+	fp->table[ch] = regfast_bits(prog, fp, source, ic);
+    }
+    fp->built = TRUE;
+    fp->ic = ic;
+    fp->ctype = REG_CTYPE_GEN;
+}
+
+/*
+ * Scan for matches beginning in [s..endsrch), returning the first one which
+ * regtry() confirms.
+ */
+static int
+regfast_exec(regexp * prog,
+	     char *s,
+	     char *stringend,
+	     char *endsrch,
+	     int ic)
+{
+    REGFAST *fp = REG_FAST(prog);
+    char *starts[REG_FAST_MAX];
+    ULONG state = 0;
+    ULONG accept = 1UL << (fp->length - 1);
+    ULONG bits;
+    int count = 0;
+    int skip;
+
+    if (!fp->built || fp->ic != ic || fp->ctype != REG_CTYPE_GEN)
+	regfast_build(prog, fp, ic);
+
+    regnomore = stringend;
+    while (s < stringend) {
+	if (REG_UTF8FLAG && UCHAR_AT(s) >= 128) {
+	    skip = BYTES_AT(s, stringend);
+	    bits = regfast_bits(prog, fp, s, ic);
+	} else {
+	    skip = 1;
+	    bits = fp->table[UCHAR_AT(s)];
+	}
+	state = ((state << 1) | (ULONG) (s < endsrch)) & bits;
+	starts[count] = s;
+	if (++count >= fp->length)
+	    count = 0;
+	s += skip;
+	if ((state & accept) != 0
+	    && (!fp->at_eol || s == stringend)
+	    && regtry(prog, starts[count], stringend, 0, ic)) {
+	    return (1);
+	}
+	if (state == 0 && s >= endsrch)
+	    break;
+    }
+    return (0);
+}
+
+/*
+ * Bracket expressions are stored as strings which RegStrChr2() parses for
+ * each character tested, which is slow for long runs such as "[a-z]*".
+ * Append a table to the program, with an entry for each bracket expression
+ * in which RegAnyOf() remembers the results for single-byte characters.
+ */
+typedef struct {
+    int built;			/* true if the results are usable */
+    int utf8;			/* reg_utf8flag for the results */
+    UINT ctype;			/* vl_ctype_gen for the results */
+    UCHAR known[2][N_chars / 8];	/* bytes tested, without/with ic */
+    UCHAR found[2][N_chars / 8];	/* ...and those which matched */
+} REGCLASS;
+
+#define REG_CLASS(prog) ((REGCLASS *) (void *) ((prog)->program + (prog)->regclass))
+#define CLASS_BIT(ch)	(UCHAR) (1 << ((ch) & 7))
+
+static REGCLASS *reg_classes;	/* table for the program being executed */
+
+static regexp *
+regclass_init(regexp * r, int count)
+{
+    r->regclass = -1;
+    if (count > 0) {
+	size_t base = (size_t) (r->program - (char *) r);
+	size_t offset = ((r->size + sizeof(ULONG) - 1)
+			 / sizeof(ULONG)) * sizeof(ULONG);
+	size_t length = (size_t) count * sizeof(REGCLASS);
+	regexp *r2;
+
+	beginDisplay();
+	r2 = castrealloc(regexp, r, offset + length);
+	endofDisplay();
+	if (r2 != NULL) {
+	    r = r2;
+	    r->size = offset + length;
+	    r->regclass = (int) (offset - base);
+	    memset(REG_CLASS(r), 0, length);
+	}
+    }
+    return r;
+}
+
+/*
+ * Test if the character at 'cs' is in the bracket expression of the ANYOF or
+ * ANYBUT node.
+ */
+static int
+RegAnyOf(const char *node, const char *cs, int ic)
+{
+    int ch = UCHAR_AT(cs);
+    REGCLASS *cp;
+
+    if (reg_classes == NULL || (REG_UTF8FLAG && ch >= 128))
+	return RegStrChr2(OPERAND(node), OPSIZE(node), cs, ic);
+
+    ic = (ic != 0);
+    cp = reg_classes + CLASS_INDEX(node);
+    if (!cp->built
+	|| cp->utf8 != REG_UTF8FLAG
+	|| cp->ctype != REG_CTYPE_GEN) {
+	memset(cp, 0, sizeof(*cp));
+	cp->built = TRUE;
+	cp->utf8 = REG_UTF8FLAG;
+	cp->ctype = REG_CTYPE_GEN;
+    }
+    if (!(cp->known[ic][ch / 8] & CLASS_BIT(ch))) {
+	cp->known[ic][ch / 8] |= CLASS_BIT(ch);
+	if (RegStrChr2(OPERAND(node), OPSIZE(node), cs, ic))
+	    cp->found[ic][ch / 8] |= CLASS_BIT(ch);
+    }
+    return (cp->found[ic][ch / 8] & CLASS_BIT(ch)) != 0;
+}
+
 /*
  - regexec - match a regexp against a string
  	prog is the compiled expression, string is the string, stringend
@@ -1872,7 +2407,7 @@ regexec2(regexp * prog,
 	 int at_bol,
 	 int ic)
 {
-    char *s, *endsrch;
+    char *s, *first, *endsrch;
     int skip;
 
     /* Be paranoid... */
@@ -1886,6 +2421,7 @@ regexec2(regexp * prog,
 	regerror("corrupted program");
 	return (0);
     }
+    reg_classes = (prog->regclass >= 0) ? REG_CLASS(prog) : NULL;
 
     /* supply an endpoint if none given */
     if (stringend == NULL) {
@@ -1906,19 +2442,28 @@ regexec2(regexp * prog,
 	endsrch++;
 
     /* If there is a "must appear" string, look for it. */
+    first = &string[startoff];
     if (prog->regmust != -1) {
-	char *prog_must = &(prog->program[prog->regmust]);
-	int char_must = WCHAR_AT(prog_must, regnomore);
-	s = &string[startoff];
-	while ((s = regstrchr(s, char_must, stringend, ic))
-	       != NULL && s < endsrch) {
-	    if (regstrncmp(s, prog_must, prog->regmlen, stringend, ic) == 0)
-		break;		/* Found it. */
-	    s += BYTES_AT(s, stringend);
+	if ((ic ? prog->regrare_ic : prog->regrare) >= 0
+	    && !(ic && REG_UTF8FLAG)) {
+	    s = reg_find_must(prog, first, stringend, endsrch, ic);
+	} else {
+	    char *prog_must = &(prog->program[prog->regmust]);
+	    int char_must = WCHAR_AT(prog_must, regnomore);
+	    s = first;
+	    while ((s = regstrchr(s, char_must, stringend, ic))
+		   != NULL && s < endsrch) {
+		if (regstrncmp(s, prog_must, prog->regmlen, stringend, ic) == 0)
+		    break;	/* Found it. */
+		s += BYTES_AT(s, stringend);
+	    }
 	}
 	if (s >= endsrch || s == NULL) {	/* Not present. */
 	    return (0);
 	}
+	/* no match can begin before a literal prefix */
+	if (prog->regmprefix)
+	    first = s;
     }
 
     /* Mark beginning of line for ^ . */
@@ -1930,8 +2475,18 @@ regexec2(regexp * prog,
 	return (regtry(prog, string, stringend, 0, ic));
     }
 
+    /*
+     * Fixed-length patterns:  use the shift-and automaton, unless a literal
+     * first character lets regstrchr() skip ahead just as quickly.
+     */
+    if (prog->regfast >= 0
+	&& (prog->regstart < 0 || ic)
+	&& REG_FAST(prog)->utf8 == REG_UTF8FLAG) {
+	return regfast_exec(prog, first, stringend, endsrch, ic);
+    }
+
     /* Messy cases:  unanchored match. */
-    s = &string[startoff];
+    s = first;
     if (prog->regstart >= 0) {
 	/* We know what char it must start with. */
 	skip = 1;
@@ -2193,13 +2748,13 @@ regmatch(char *prog, int plevel, int ic)
 	    break;
 	case ANYOF:
 	    if (reginput >= regnomore
-		|| RegStrChr2(OPERAND(scan), OPSIZE(scan), reginput, ic) == 0)
+		|| RegAnyOf(scan, reginput, ic) == 0)
 		returnReg(0);
 	    reginput += BYTES_AT(reginput, regnomore);
 	    break;
 	case ANYBUT:
 	    if (reginput >= regnomore
-		|| RegStrChr2(OPERAND(scan), OPSIZE(scan), reginput, ic) != 0)
+		|| RegAnyOf(scan, reginput, ic) != 0)
 		returnReg(0);
 	    reginput += BYTES_AT(reginput, regnomore);
 	    break;
@@ -2495,13 +3050,13 @@ regrepeat(const char *p, int ic)
 	}
 	break;
     case ANYOF:
-	while (scan < regnomore && RegStrChr2(opnd, size, scan, ic) != 0) {
+	while (scan < regnomore && RegAnyOf(p, scan, ic) != 0) {
 	    count++;
 	    scan += BYTES_AT(scan, regnomore);
 	}
 	break;
     case ANYBUT:
-	while (scan < regnomore && RegStrChr2(opnd, size, scan, ic) == 0) {
+	while (scan < regnomore && RegAnyOf(p, scan, ic) == 0) {
 	    count++;
 	    scan += BYTES_AT(scan, regnomore);
 	}
@@ -2586,6 +3141,8 @@ regdump1(char *program, char *s)
     if (op == ANYOF || op == ANYBUT || op == EXACTLY) {
 	tb_sappend0(&dump, visible_buff(s, (int) len, FALSE));
 	s += (len + 1);
+	if (op != EXACTLY)
+	    s += 2;		/* CLASS_INDEX() */
     } else if (op == RSIMPLE || op == RCOMPLX) {
 	s += (RR_LEN - OP_HDR);
     }
@@ -2621,6 +3178,10 @@ regdump(regexp * r)
 	sprintf(temp, "anchored ");
 	tb_sappend0(&dump, temp);
     }
+    if (r->regfast >= 0) {
+	sprintf(temp, "fast %d ", REG_FAST(r)->length);
+	tb_sappend0(&dump, temp);
+    }
     if (r->regmust != -1) {
 	tb_sappend0(&dump, "must have \"");
 	tb_sappend0(&dump, &(r->program[r->regmust]));
@@ -2827,8 +3388,125 @@ regfree(regexp * prog)
     free(prog);
 }
 
+#ifndef UNBUNDLED_VILE_REGEX
+/*
+ * Keep the most recently used compiled expressions, so that patterns which
+ * are compiled over and over, e.g., for tag lookups, error-finding and macro
+ * functions, are copied rather than compiled again.  The compiled code
+ * depends on the encoding of the current buffer and the character classes,
+ * as well as on the text of the pattern and "magic".  Ignorecase is applied
+ * when matching, and does not affect it.
+ */
+#define REGCACHE_MAX	32	/* number of expressions kept */
+#define REGCACHE_TEXT	1024	/* ...and the longest pattern kept */
+
+typedef struct {
+    char *text;
+    size_t length;
+    int magic;
+    int utf8;
+    UINT ctype;
+    ULONG used;			/* when this was last used */
+    regexp *prog;
+} REGCACHE;
+
+static REGCACHE reg_cache[REGCACHE_MAX];
+static ULONG reg_cache_clock;
+
+static regexp *
+regcopy(const regexp * prog)
+{
+    regexp *result;
+
+    beginDisplay();
+    if ((result = castalloc(regexp, prog->size)) != NULL)
+	memcpy(result, prog, prog->size);
+    endofDisplay();
+    return result;
+}
+
+/*
+ * Like regcomp(), returning a copy which the caller frees, but using the
+ * cache.  Patterns which do not compile are not cached, so that the error is
+ * reported each time.
+ */
+regexp *
+regcomp_cached(const char *exp_text, size_t exp_len, int magic)
+{
+    REGCACHE *cp;
+    REGCACHE *slot = NULL;
+    regexp *result;
+    int n;
+
+    if (exp_text == NULL)
+	return regcomp(exp_text, exp_len, magic);
+
+    set_utf8flag(curbp);
+    for (n = 0; n < REGCACHE_MAX; ++n) {
+	cp = reg_cache + n;
+	if (cp->prog == NULL) {
+	    if (slot == NULL || slot->prog != NULL)
+		slot = cp;
+	} else if (cp->length == exp_len
+		   && cp->magic == magic
+		   && cp->utf8 == REG_UTF8FLAG
+		   && cp->ctype == REG_CTYPE_GEN
+		   && !memcmp(cp->text, exp_text, exp_len)) {
+	    cp->used = ++reg_cache_clock;
+	    regcache_hits++;
+	    return regcopy(cp->prog);
+	} else if (slot == NULL
+		   || (slot->prog != NULL && cp->used < slot->used)) {
+	    slot = cp;
+	}
+    }
+
+    regcache_misses++;
+    result = regcomp(exp_text, exp_len, magic);
+    if (result != NULL && slot != NULL && exp_len <= REGCACHE_TEXT) {
+	regexp *prog;
+	char *text;
+
+	beginDisplay();
+	if ((prog = regcopy(result)) != NULL
+	    && (text = castalloc(char, exp_len + 1)) != NULL) {
+	    FreeIfNeeded(slot->text);
+	    FreeIfNeeded(slot->prog);
+	    memcpy(text, exp_text, exp_len);
+	    text[exp_len] = EOS;
+	    slot->text = text;
+	    slot->length = exp_len;
+	    slot->magic = magic;
+	    slot->utf8 = REG_UTF8FLAG;
+	    slot->ctype = REG_CTYPE_GEN;
+	    slot->used = ++reg_cache_clock;
+	    slot->prog = prog;
+	} else {
+	    FreeIfNeeded(prog);
+	}
+	endofDisplay();
+    }
+    return result;
+}
+
+#if NO_LEAKS
+void
+regexp_leaks(void)
+{
+    int n;
+
+    for (n = 0; n < REGCACHE_MAX; ++n) {
+	FreeAndNull(reg_cache[n].text);
+	FreeAndNull(reg_cache[n].prog);
+    }
+}
+#endif
+#endif /* UNBUNDLED_VILE_REGEX */
+
 #ifdef DEBUG_REGEXP
 
+#include <time.h>
+
 #ifdef TEST_MULTIBYTE_REGEX
 #define NotImpl(name) fprintf(stderr, "Not implemented: " #name "\n")
 
@@ -3093,6 +3771,92 @@ put_string(char *s, unsigned length, int literal)
     putchar('\n');
 }
 
+static char *corpus_text;
+static size_t corpus_size;
+
+static void
+load_corpus(const char *name)
+{
+    FILE *fp;
+
+    FreeAndNull(corpus_text);
+    corpus_size = 0;
+    if ((fp = fopen(name, "r")) != 0) {
+	size_t have = BUFSIZ;
+	size_t got;
+
+	corpus_text = typeallocn(char, have);
+	while (corpus_text != 0
+	       && (got = fread(corpus_text + corpus_size, sizeof(char),
+			       have - corpus_size, fp)) != 0) {
+	    corpus_size += got;
+	    if (corpus_size == have) {
+		have *= 2;
+		corpus_text = typereallocn(char, corpus_text, have);
+	    }
+	}
+	fclose(fp);
+    } else {
+	perror(name);
+    }
+}
+
+/*
+ * Match each line of the corpus, returning the elapsed time.  The number of
+ * lines matched and a checksum of the match-offsets are returned as well.
+ */
+static double
+time_corpus(regexp * pattern, int ic, long *found, long *offsets)
+{
+    clock_t begin = clock();
+    char *s = corpus_text;
+    char *last = corpus_text + corpus_size;
+
+    *found = 0;
+    *offsets = 0;
+    while (s < last) {
+	char *eol = memchr(s, '\n', (size_t) (last - s));
+
+	if (eol == 0)
+	    eol = last;
+	if (regexec(pattern, s, eol, 0, (int) (eol - s), ic)) {
+	    *found += 1;
+	    *offsets += (pattern->startp[0] - s) + (long) pattern->mlen;
+	}
+	s = eol + 1;
+    }
+    return (double) (clock() - begin) / CLOCKS_PER_SEC;
+}
+
+/*
+ * If the pattern can use the shift-and matcher, time it against the corpus,
+ * compared to a copy of the pattern which uses backtracking.
+ */
+static void
+test_corpus(regexp * pattern, int ic)
+{
+    regexp *slow;
+    long fast_found, fast_offsets;
+    long slow_found, slow_offsets;
+    double fast_time, slow_time;
+
+    if (corpus_text == 0 || pattern == 0 || pattern->regfast < 0)
+	return;
+    if ((slow = castalloc(regexp, pattern->size)) == 0)
+	return;
+    memcpy(slow, pattern, pattern->size);
+    slow->regfast = -1;
+
+    fast_time = time_corpus(pattern, ic, &fast_found, &fast_offsets);
+    slow_time = time_corpus(slow, ic, &slow_found, &slow_offsets);
+    if (fast_found != slow_found || fast_offsets != slow_offsets)
+	printf("? corpus results differ\n");
+    fprintf(stderr, "corpus: %ld lines matched, %.3fs vs %.3fs (%.1fx)\n",
+	    fast_found, fast_time, slow_time,
+	    (fast_time > 0.0) ? (slow_time / fast_time) : 0.0);
+    free(slow);
+}
+
 /*
  * Read script containing patterns (p), test-data (q) and results (r).  The
  * first character of each line is its type:
@@ -3102,6 +3866,9 @@ put_string(char *s, unsigned length, int literal)
  * >	Use I/i to switch ignorecase on/off in the call to regexec().
  * >	Use M/m to switch magic on/off in the call to regcomp().
  * >	Use N to disable regmassage (used for vile), so expressions are POSIX.
+ * >	Use C/c to name a corpus file.  Following patterns which can use the
+ *	shift-and matcher are timed against each line of the corpus with and
+ *	without it, and the times reported on the standard error.
  * >	Lines beginning with '?' are error messages.
  * >	Other lines are converted to comments.
  *
@@ -3157,6 +3924,13 @@ test_regexp(FILE *fp)
 		free(pattern);
 	    ++s, --length;
 	    pattern = regcomp(s, length, magic);
+	    test_corpus(pattern, ic);
+	    break;
+	case 'C':
+	    /* FALLTHRU */
+	case 'c':
+	    put_string(s, length, TRUE);
+	    load_corpus(s + 1);
 	    break;
 	case 'Q':
 	    literal = 1;
@@ -3220,6 +3994,7 @@ test_regexp(FILE *fp)
     }
     if (pattern != 0)
 	free(pattern);
+    FreeAndNull(corpus_text);
 }
 
 int
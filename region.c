@@ -42,7 +42,7 @@ do_chars_in_line(void *flagp GCC_UNUSED, int ll, int rr)
 	    c = get_char2(lp, i);
 	    nc = (charprocfunc) (c);
 	    if (nc != -1) {
-		CopyForUndo(lp);
+		CopyPartForUndo(lp, i, BytesAt(lp, i));
 		set_char2(lp, i, nc);
 		changed++;
 	    }
@@ -971,7 +971,7 @@ getregion(BUFFER *bp, REGION * rp)
 	return found_region(rp);
     }
 #if !SMALLER
-    if (b_is_counted(bp)) {	/* we have valid line numbers */
+    if (lindex_check(bp)) {	/* we have valid line numbers */
 	LINE *flp_start;
 	L_NUM dno, mno;
 	dno = line_no(bp, DOT.l);
@@ -583,11 +583,45 @@ static int save_magic;
 static BUFFER *save_curbp;
 static VIDEO_ATTR save_vattr;
 
+/*
+ * attrib_matches() highlights only the lines shown in windows, leaving the
+ * rest of the buffer to attrib_more_matches(), which works through it a
+ * chunk of lines at a time while waiting for a keystroke.  Lines which have
+ * been done are flagged, and the flags are cleared in a final pass.
+ */
+#define HILITE_CHUNK	1000	/* lines to scan between keystroke checks */
+
+static BUFFER *hilite_bp;	/* buffer whose matches are not all shown */
+static LINE *hilite_lp;		/* ...next line to scan (or clear) */
+static int hilite_clearing;	/* ...true when clearing the line flags */
+static UINT hilite_changes;	/* ...its b_changes when we started */
+static regexp *hilite_exp;	/* ...the pattern */
+static VIDEO_ATTR hilite_vattr;	/* ...attribute for the matches */
+static int hilite_ic;		/* ...ignorecase for the pattern */
+
+/*
+ * Forget the unfinished highlighting, clearing the flags on its lines.
+ */
+static void
+hilite_cancel(void)
+{
+    if (hilite_bp != NULL) {
+	LINE *lp;
+
+	for_each_line(lp, hilite_bp) {
+	    lsetnothilited(lp);
+	}
+	hilite_bp = NULL;
+    }
+}
+
 void
 clobber_save_curbp(BUFFER *bp)
 {
     if (save_curbp == bp)
 	save_curbp = NULL;
+    if (hilite_bp == bp)
+	hilite_bp = NULL;
 }
 
 /* keep track of enough state to give us a hint as to whether
@@ -628,6 +662,9 @@ clear_match_attrs(int f GCC_UNUSED, int n GCC_UNUSED)
     int status;
     MARK origdot, origmark;
 
+    if (hilite_bp == curbp)
+	hilite_cancel();
+
     if ((curbp->b_highlight & HILITE_ON) == 0)
 	return TRUE;
 
@@ -651,14 +688,100 @@ clear_match_attrs(int f GCC_UNUSED, int n GCC_UNUSED)
 }
 #endif
 
+#if OPT_HILITEMATCH
+/*
+ * Highlight the matches in the given line.
+ */
+static int
+hilite_line(LINE *lp)
+{
+    regexp *exp = hilite_exp;
+    int offset = b_left_margin(curbp);
+    int status = TRUE;
+
+    while (offset <= llength(lp)
+	   && lregexec(exp, lp, offset, llength(lp), hilite_ic)) {
+	C_NUM start = ((exp->startp[0] != NULL)
+		       ? (C_NUM) (exp->startp[0] - lvalue(lp))
+		       : 0);
+
+	/* skip empty matches, whose regions would be discarded anyway */
+	if (exp->mlen == 0) {
+	    if (start >= llength(lp))
+		break;
+	    offset = start + BytesAt(lp, start);
+	    continue;
+	}
+
+	if (hilite_vattr != VACOLOR)
+	    videoattribute = hilite_vattr;
+	else {
+	    int c;
+	    for (c = NSUBEXP - 1; c > 0; c--)
+		if (exp->startp[c] == exp->startp[0]
+		    && exp->endp[c] == exp->endp[0])
+		    break;
+	    if (c > NCOLORS - 1)
+		videoattribute = VCOLORATTR(NCOLORS - 1);
+	    else
+		videoattribute = VCOLORATTR(c + 1);
+	}
+	DOT.l = lp;
+	DOT.o = start;
+	MK.l = lp;
+	MK.o = start + (C_NUM) exp->mlen;
+
+	/* show highlighting from DOT to MK */
+	regionshape = rgn_EXACT;
+	videoattribute |= VOWN_MATCHES;
+	if ((status = attributeregion()) != TRUE)
+	    break;
+
+	/* continue after the match, or after its first character */
+	if (b_val(curbp, MDHILITEOVERLAP))
+	    offset = start + BytesAt(lp, start);
+	else
+	    offset = MK.o;
+    }
+    lsethilited(lp);
+    return status;
+}
+
+/*
+ * Highlight the matches in the lines shown in windows, returning true if
+ * there were any not already done.
+ */
+static int
+hilite_visible(void)
+{
+    WINDOW *wp;
+    LINE *lp;
+    int n;
+    int found = FALSE;
+
+    for_each_visible_window(wp) {
+	if (wp->w_bufp != hilite_bp)
+	    continue;
+	for (n = 0, lp = wp->w_line.l;
+	     n < wp->w_ntrows && lp != buf_head(hilite_bp);
+	     ++n, lp = lforw(lp)) {
+	    if (!lishilited(lp)) {
+		found = TRUE;
+		if (hilite_line(lp) != TRUE) {
+		    hilite_cancel();
+		    return found;
+		}
+	    }
+	}
+    }
+    return found;
+}
+#endif /* OPT_HILITEMATCH */
+
 void
 attrib_matches(void)
 {
 #if OPT_HILITEMATCH
-    MARK origdot;
-    MARK nextdot;
-    int status;
-    REGIONSHAPE oregionshape = regionshape;
     VIDEO_ATTR vattr;
     int ic;
 
@@ -682,58 +805,85 @@ attrib_matches(void)
     if (vattr == 0)
 	return;
 
+    hilite_cancel();
     (void) clear_match_attrs(TRUE, 1);
 
     if (curwp == NULL)
 	return;
 
+    hilite_bp = curbp;
+    hilite_lp = lforw(buf_head(curbp));
+    hilite_clearing = FALSE;
+    hilite_changes = curbp->b_changes;
+    hilite_exp = gregexp;
+    hilite_vattr = vattr;
+    hilite_ic = ic;
+
+    curbp->b_highlight = HILITE_ON;	/* & ~HILITE_DIRTY */
+    hilite_suppressed = FALSE;
+#endif /* OPT_HILITEMATCH */
+}
+
+/*
+ * Highlight the matches which attrib_matches() left, those shown in windows
+ * first, then the rest of the buffer until there is a keystroke to process.
+ */
+void
+attrib_more_matches(void)
+{
+#if OPT_HILITEMATCH
+    MARK origdot;
+    MARK origmark;
+    REGIONSHAPE oregionshape;
+    int n;
+
+    if (hilite_bp == NULL)
+	return;
+
+    if (hilite_bp != curbp
+	|| hilite_bp->b_changes != hilite_changes
+	|| hilite_exp != gregexp
+	|| !(hilite_bp->b_highlight & HILITE_ON)) {
+	hilite_cancel();
+	return;
+    }
+
     origdot = DOT;
-    DOT.l = buf_head(curbp);
-    DOT.o = b_left_margin(curbp);
-    nextdot = DOT;
+    origmark = MK;
+    oregionshape = regionshape;
 
-    scanboundry(FALSE, DOT, FORWARD);
-    do {
-	if (b_val(curbp, MDHILITEOVERLAP)) {
-	    movenext(&(DOT), FORWARD);
-	} else {
-	    movenext(&nextdot, FORWARD);
-	    DOT = nextdot;
-	}
-	status = scanner(gregexp, FORWARD, FALSE, TRUE, ic, (int *) 0);
-	if (status != TRUE)
-	    break;
-	if (vattr != VACOLOR)
-	    videoattribute = vattr;
-	else {
-	    int c;
-	    for (c = NSUBEXP - 1; c > 0; c--)
-		if (gregexp->startp[c] == gregexp->startp[0]
-		    && gregexp->endp[c] == gregexp->endp[0])
+    if (!hilite_clearing && hilite_visible()) {
+	DOT = origdot;
+	MK = origmark;
+	(void) update(FALSE);
+    }
+
+    while (hilite_bp != NULL && !keystroke_avail()) {
+	for (n = 0; n < HILITE_CHUNK; ++n) {
+	    if (hilite_lp == buf_head(hilite_bp)) {
+		if (hilite_clearing) {
+		    hilite_bp = NULL;
 		    break;
-	    if (c > NCOLORS - 1)
-		videoattribute = VCOLORATTR(NCOLORS - 1);
-	    else
-		videoattribute = VCOLORATTR(c + 1);
+		}
+		hilite_clearing = TRUE;
+		hilite_lp = lforw(hilite_lp);
+	    } else if (hilite_clearing) {
+		lsetnothilited(hilite_lp);
+		hilite_lp = lforw(hilite_lp);
+	    } else {
+		if (!lishilited(hilite_lp)
+		    && hilite_line(hilite_lp) != TRUE) {
+		    hilite_cancel();
+		    break;
+		}
+		hilite_lp = lforw(hilite_lp);
+	    }
 	}
-	MK.l = DOT.l;
-	MK.o = DOT.o + (C_NUM) gregexp->mlen;
-
-	/* provide a location for the next non-overlapping match */
-	nextdot = MK;
-	if (gregexp->mlen > 0)
-	    nextdot.o -= BytesBefore(nextdot.l, nextdot.o);
-
-	/* show highlighting from DOT to MK */
-	regionshape = rgn_EXACT;
-	videoattribute |= VOWN_MATCHES;
-	status = attributeregion();
-    } while (status == TRUE);
+    }
 
     DOT = origdot;
+    MK = origmark;
     regionshape = oregionshape;
-    curbp->b_highlight = HILITE_ON;	/* & ~HILITE_DIRTY */
-    hilite_suppressed = FALSE;
 #endif /* OPT_HILITEMATCH */
 }
 
@@ -813,9 +963,9 @@ readpattern(const char *prompt,
 	    beginDisplay();
 	    FreeIfNeeded(*srchexpp);
 	    endofDisplay();
-	    *srchexpp = regcomp(tb_values(*apat),
-				tb_length(*apat),
-				b_val(curbp, MDMAGIC));
+	    *srchexpp = regcomp_cached(tb_values(*apat),
+				       tb_length(*apat),
+				       b_val(curbp, MDMAGIC));
 	    if (!*srchexpp)
 		returnCode(FALSE);
 	}
@@ -102,6 +102,130 @@ alloc_AREGION(void)
     return arp;
 }
 
+/*
+ * The buffer's attributed regions are hashed by the line on which each
+ * starts, so that a window need only look at those near the lines it shows.
+ * Regions which end past the following line are kept on a separate list of
+ * spans, which is always checked.  So are selections, since they move without
+ * changing the buffer.
+ */
+#define ATTR_HASH(bp, lp) \
+	(((size_t) (lp) / sizeof(LINE)) & ((bp)->b_attrindex_max - 1))
+
+static LINE *
+attrib_key(AREGION * ap)
+{
+    LINE *lp = ap->ar_region.r_orig.l;
+
+    if (lp == NULL
+	|| ap == &selregion
+	|| ap == &startregion
+	|| VOWNER(ap->ar_vattr) == VOWN_SELECT
+	|| (ap->ar_region.r_end.l != lp
+	    && ap->ar_region.r_end.l != lforw(lp)))
+	lp = NULL;
+    return lp;
+}
+
+static AREGION **
+attrib_bucket(BUFFER *bp, LINE *lp)
+{
+    return ((lp != NULL)
+	    ? &(bp->b_attrindex[ATTR_HASH(bp, lp)])
+	    : &(bp->b_attrspans));
+}
+
+/*
+ * Return the bucket holding the regions which start on the given line.  It
+ * may hold regions for other lines as well.
+ */
+AREGION *
+line_attribs(BUFFER *bp, LINE *lp)
+{
+    return ((bp->b_attrindex_max != 0)
+	    ? *attrib_bucket(bp, lp)
+	    : NULL);
+}
+
+/*
+ * Double the number of buckets when they average two regions each.
+ */
+static void
+grow_attrindex(BUFFER *bp)
+{
+    AREGION **old_index = bp->b_attrindex;
+    UINT old_max = bp->b_attrindex_max;
+    UINT new_max = (old_max != 0) ? (old_max * 2) : 256;
+    UINT n;
+
+    beginDisplay();
+    if ((bp->b_attrindex = typecallocn(AREGION *, (size_t) new_max)) != NULL) {
+	bp->b_attrindex_max = new_max;
+	for (n = 0; n < old_max; ++n) {
+	    AREGION *ap;
+
+	    while ((ap = old_index[n]) != NULL) {
+		AREGION **head = attrib_bucket(bp, ap->ar_key);
+
+		old_index[n] = ap->ar_index;
+		ap->ar_index = *head;
+		*head = ap;
+	    }
+	}
+	free(old_index);
+    } else {
+	bp->b_attrindex = old_index;
+    }
+    endofDisplay();
+}
+
+void
+index_attrib(BUFFER *bp, AREGION * ap)
+{
+    AREGION **head;
+
+    ap->ar_key = attrib_key(ap);
+    if (ap->ar_key != NULL) {
+	if (bp->b_attrindex_used >= bp->b_attrindex_max * 2)
+	    grow_attrindex(bp);
+	if (bp->b_attrindex_max != 0)
+	    bp->b_attrindex_used++;
+	else
+	    ap->ar_key = NULL;
+    }
+    head = attrib_bucket(bp, ap->ar_key);
+    ap->ar_index = *head;
+    *head = ap;
+}
+
+static void
+unindex_attrib(BUFFER *bp, AREGION * ap)
+{
+    AREGION **rpp = attrib_bucket(bp, ap->ar_key);
+
+    while (*rpp != NULL) {
+	if (*rpp == ap) {
+	    *rpp = ap->ar_index;
+	    if (ap->ar_key != NULL)
+		bp->b_attrindex_used--;
+	    break;
+	}
+	rpp = &((*rpp)->ar_index);
+    }
+}
+
+/*
+ * Call this after moving either end of an attached region.
+ */
+void
+reindex_attrib(BUFFER *bp, AREGION * ap)
+{
+    if (attrib_key(ap) != ap->ar_key) {
+	unindex_attrib(bp, ap);
+	index_attrib(bp, ap);
+    }
+}
+
 void
 free_attribs(BUFFER *bp)
 {
@@ -124,6 +248,11 @@ free_attribs(BUFFER *bp)
     }
     bp->b_attribs = NULL;
 
+    FreeAndNull(bp->b_attrindex);
+    bp->b_attrindex_max = 0;
+    bp->b_attrindex_used = 0;
+    bp->b_attrspans = NULL;
+
     free_line_attribs(bp);
     endofDisplay();
 }
@@ -138,6 +267,7 @@ free_attrib2(BUFFER *bp, AREGION ** rpp)
      * so there is no need to call detach_attrib() to find it.
      */
     mark_buffers_windows(bp);
+    unindex_attrib(bp, ap);
     ap->ar_region.r_attr_id = 0;
 
     beginDisplay();
@@ -167,6 +297,7 @@ detach_attrib(BUFFER *bp, AREGION * arp)
 	    while (*rpp != NULL) {
 		if (*rpp == arp) {
 		    *rpp = (*rpp)->ar_next;
+		    unindex_attrib(bp, arp);
 		    arp->ar_region.r_attr_id = 0;
 		    break;
 		} else
@@ -206,6 +337,7 @@ attach_attrib(BUFFER *bp, AREGION * arp)
     if (valid_buffer(bp)) {
 	arp->ar_next = bp->b_attribs;
 	bp->b_attribs = arp;
+	index_attrib(bp, arp);
 	mark_buffers_windows(bp);
 	arp->ar_region.r_attr_id = (USHORT) assign_attr_id();
     }
@@ -1289,11 +1421,13 @@ attributeregion(void)
 			}
 			p->ar_region.r_end.l = (region.r_orig.l);
 			p->ar_region.r_end.o = (region.r_orig.o);
+			reindex_attrib(bp, p);
 			curwp->w_flag |= WFHARD;
 			continue;
 		    } else if ((rle < ple) || (rle == ple && roe < poe)) {
 			p->ar_region.r_orig.l = (region.r_end.l);
 			p->ar_region.r_orig.o = (region.r_end.o);
+			reindex_attrib(bp, p);
 			curwp->w_flag |= WFHARD;
 			continue;
 		    }
@@ -1410,17 +1544,15 @@ hyperspray(int (*f) (char *))
     AREGION *p;
     int count = 0;
 
-    (void) bsizes(curbp);	/* attach line numbers to each line */
-
-    dlno = DOT.l->l_number;
+    dlno = line_no(curbp, DOT.l);
     doff = DOT.o;
 
     for (p = curbp->b_attribs; p != NULL; p = p->ar_next) {
 	if (p->ar_hypercmd) {
 	    int slno, elno, soff, eoff;
 
-	    slno = p->ar_region.r_orig.l->l_number;
-	    elno = p->ar_region.r_end.l->l_number;
+	    slno = line_no(curbp, p->ar_region.r_orig.l);
+	    elno = line_no(curbp, p->ar_region.r_end.l);
 	    soff = p->ar_region.r_orig.o;
 	    eoff = p->ar_region.r_end.o;
 
@@ -1853,7 +1985,6 @@ attribute_directly(void)
 	VL_ELAPSED begin_time;
 	(void) vl_elapsed(&begin_time, TRUE);
 #endif
-	discard_syntax_highlighting();
 	if (b_val(bp, MDHILITE)) {
 	    char *filtername = NULL;
 	    TBUFF *token = NULL;
@@ -1865,15 +1996,35 @@ attribute_directly(void)
 		&& bp->majr != NULL)
 		filtername = bp->majr->shortname;
 
+	    /*
+	     * Autocoloring follows edits, so we can usually re-lex just the
+	     * changed lines.  Explicit requests always redo the whole buffer.
+	     */
+	    detach_attrib(selbufp, &selregion);
+	    detach_attrib(startbufp, &startregion);
 	    if (filtername != NULL
-		&& flt_start(filtername)) {
-		TRACE(("attribute_directly(%s) using %s\n",
+		&& in_autocolor
+		&& flt_update(filtername)) {
+		TRACE(("attribute_directly(%s) updated with %s\n",
 		       bp->b_bname,
 		       filtername));
+		mark_buffers_windows(bp);
 		flt_finish();
 		code = TRUE;
+	    } else {
+		discard_syntax_highlighting();
+		if (filtername != NULL
+		    && flt_start(filtername)) {
+		    TRACE(("attribute_directly(%s) using %s\n",
+			   bp->b_bname,
+			   filtername));
+		    flt_finish();
+		    code = TRUE;
+		}
 	    }
 	    tb_free(&token);
+	} else {
+	    discard_syntax_highlighting();
 	}
 	attach_attrib(selbufp, &selregion);
 	attach_attrib(startbufp, &startregion);
@@ -174,7 +174,7 @@ any_rw_EXPR(TBUFF **rp, const char *vp, TBUFF **value)
 	    return TRUE;
 	}
     } else if (vp) {
-	regexp *exp = regcomp(vp, strlen(vp), TRUE);
+	regexp *exp = regcomp_cached(vp, strlen(vp), TRUE);
 	if (exp != NULL) {
 	    beginDisplay();
 	    free(exp);
@@ -1495,6 +1495,18 @@ var_RDHOOK(TBUFF **rp, const char *vp)
 }
 #endif
 
+int
+var_REGEX_HITS(TBUFF **rp, const char *vp)
+{
+    return any_ro_ULONG(rp, vp, regcache_hits);
+}
+
+int
+var_REGEX_MISSES(TBUFF **rp, const char *vp)
+{
+    return any_ro_ULONG(rp, vp, regcache_misses);
+}
+
 /*
  * Note that replacepat is stored without a trailing null.
  */
@@ -1513,6 +1525,50 @@ var_REPLACE(TBUFF **rp, const char *vp)
     }
 }
 
+#if OPT_SHOW_SCREEN
+int
+var_SCREEN_ATTRS(TBUFF **rp, const char *vp)
+{
+    return any_ro_ULONG(rp, vp, screen_stats.attrs);
+}
+
+int
+var_SCREEN_BYTES(TBUFF **rp, const char *vp)
+{
+    return any_ro_ULONG(rp, vp, screen_stats.bytes);
+}
+
+int
+var_SCREEN_MOVES(TBUFF **rp, const char *vp)
+{
+    return any_ro_ULONG(rp, vp, screen_stats.moves);
+}
+
+int
+var_SCREEN_MSECS(TBUFF **rp, const char *vp)
+{
+    return any_ro_ULONG(rp, vp, (ULONG) screen_stats.msecs);
+}
+
+int
+var_SCREEN_ROWS(TBUFF **rp, const char *vp)
+{
+    return any_ro_ULONG(rp, vp, screen_stats.rows);
+}
+
+int
+var_SCREEN_SCROLLS(TBUFF **rp, const char *vp)
+{
+    return any_ro_ULONG(rp, vp, screen_stats.scrolls);
+}
+
+int
+var_SCREEN_UPDATES(TBUFF **rp, const char *vp)
+{
+    return any_ro_ULONG(rp, vp, screen_stats.updates);
+}
+#endif
+
 /*
  * Note that searchpat is stored without a trailing null.
  */
@@ -1528,9 +1584,9 @@ var_SEARCH(TBUFF **rp, const char *vp)
 	beginDisplay();
 	FreeIfNeeded(gregexp);
 	endofDisplay();
-	gregexp = regcomp(tb_values(searchpat),
-			  tb_length(searchpat),
-			  b_val(curbp, MDMAGIC));
+	gregexp = regcomp_cached(tb_values(searchpat),
+				 tb_length(searchpat),
+				 b_val(curbp, MDMAGIC));
 	return TRUE;
     } else {
 	return FALSE;
@@ -527,9 +527,9 @@ finish_pop(char *fname, L_NUM lineno, C_NUM colno)
     return s;
 }
 
-#ifdef MDTAGIGNORECASE
 typedef int (*CompareFunc) (const char *a, const char *b, size_t len);
 
+#ifdef MDTAGIGNORECASE
 static int
 my_strncasecmp(const char *a, const char *b, size_t len)
 {
@@ -548,6 +548,107 @@ my_strncasecmp(const char *a, const char *b, size_t len)
 }
 #endif
 
+/*
+ * Check the pseudo-tags at the beginning of a tags file to see if it is
+ * sorted:
+ *	0 = unsorted,
+ *	1 = sorted (case-sensitive),
+ *	2 = sorted ignoring case (folded to uppercase, like "sort -f").
+ */
+#define SORTED_TAG "!_TAG_FILE_SORTED\t"
+
+static int
+tags_sorted(BUFFER *bp)
+{
+    LINE *lp;
+    int result = 0;
+    size_t len = sizeof(SORTED_TAG) - 1;
+
+    for_each_line(lp, bp) {
+	if (llength(lp) < 2 || strncmp(lvalue(lp), "!_", (size_t) 2))
+	    break;
+	if (llength(lp) > (int) len
+	    && !strncmp(lvalue(lp), SORTED_TAG, len)) {
+	    if (lvalue(lp)[len] == '1')
+		result = 1;
+	    else if (lvalue(lp)[len] == '2')
+		result = 2;
+	    break;
+	}
+    }
+    return result;
+}
+
+#define FoldTag(c) (((c) >= 'a' && (c) <= 'z') ? ((c) - 'a' + 'A') : (c))
+
+/*
+ * Compare the beginning of a line from a tags file against the name, using
+ * the same ordering as the sorted file.
+ */
+static int
+tag_order(LINE *lp, const char *name, size_t namelen, int folded)
+{
+    size_t len = (size_t) llength(lp);
+    size_t n;
+    int result = 0;
+
+    for (n = 0; n < namelen; ++n) {
+	int a, b;
+
+	if (n >= len) {
+	    result = -1;
+	    break;
+	}
+	a = CharOf(lvalue(lp)[n]);
+	b = CharOf(name[n]);
+	if (folded) {
+	    a = FoldTag(a);
+	    b = FoldTag(b);
+	}
+	if (a != b) {
+	    result = a - b;
+	    break;
+	}
+    }
+    return result;
+}
+
+/*
+ * Binary-search a sorted tags file for the first line which matches the name.
+ * The matching lines are adjacent, so we need look no further than the end of
+ * the block of lines which compare equal in the file's ordering.
+ */
+static LINE *
+sorted_tag_scan(BUFFER *bp, const char *name, size_t namelen,
+		int folded, CompareFunc compare)
+{
+    L_NUM count = vl_line_count(bp);
+    L_NUM lo = 1;
+    L_NUM hi = count + 1;
+    LINE *lp;
+
+    while (lo < hi) {
+	L_NUM mid = lo + (hi - lo) / 2;
+
+	if ((lp = line_at(bp, mid)) == NULL)
+	    return NULL;
+	if (tag_order(lp, name, namelen, folded) < 0)
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
+
+    for (; lo <= count; ++lo) {
+	if ((lp = line_at(bp, lo)) == NULL
+	    || tag_order(lp, name, namelen, folded) != 0)
+	    break;
+	if (llength(lp) > (int) namelen
+	    && !compare(lvalue(lp), name, namelen))
+	    return lp;
+    }
+    return NULL;
+}
+
 /*
  * Do exact/inexact lookup of an anchored string in a buffer.
  *	if taglen is 0, matches must be exact (i.e.  all
@@ -555,20 +656,26 @@ my_strncasecmp(const char *a, const char *b, size_t len)
  *	characters, this match must also be exact.  if the user enters
  *	'taglen' or more characters, only that many characters will be
  *	significant in the lookup.
+ *
+ * If the tags file says that it is sorted, use a binary search to find the
+ * first match, rather than reading the whole file.
  */
 static LINE *
-cheap_tag_scan(LINE *oldlp, char *name, size_t taglen)
+cheap_tag_scan(BUFFER *bp, LINE *oldlp, char *name, size_t taglen)
 {
     LINE *lp, *retlp;
     size_t namelen = strlen(name);
     int exact = (taglen == 0);
     int added_tab;
+    int sorted = tags_sorted(bp);
+    CompareFunc compare = strncmp;
+
 #ifdef MDTAGIGNORECASE
-    CompareFunc compare = (b_val(curbp, MDTAGIGNORECASE)
-			   ? my_strncasecmp
-			   : strncmp);
-#else
-#define compare strncmp
+    if (b_val(curbp, MDTAGIGNORECASE)) {
+	compare = my_strncasecmp;
+	if (sorted == 1)	/* not useful for a caseless search */
+	    sorted = 0;
+    }
 #endif
 
     /* force a match of the tab delimiter if we're supposed to do
@@ -583,15 +690,38 @@ cheap_tag_scan(LINE *oldlp, char *name, size_t taglen)
     }
 
     retlp = NULL;
-    lp = lforw(oldlp);
-    while (lp != oldlp) {
-	if (llength(lp) > (int) namelen) {
-	    if (!compare(lvalue(lp), name, namelen)) {
+    if (sorted && oldlp == buf_head(bp)) {
+	retlp = sorted_tag_scan(bp, name, namelen, (sorted == 2), compare);
+    } else if (sorted
+	       && llength(oldlp) > (int) namelen
+	       && !compare(lvalue(oldlp), name, namelen)) {
+	/* find the next match after the previous one, wrapping around */
+	for (lp = lforw(oldlp);
+	     lp != buf_head(bp)
+	     && tag_order(lp, name, namelen, (sorted == 2)) == 0;
+	     lp = lforw(lp)) {
+	    if (llength(lp) > (int) namelen
+		&& !compare(lvalue(lp), name, namelen)) {
 		retlp = lp;
 		break;
 	    }
 	}
-	lp = lforw(lp);
+	if (retlp == NULL
+	    && (lp = sorted_tag_scan(bp, name, namelen,
+				     (sorted == 2), compare)) != oldlp) {
+	    retlp = lp;
+	}
+    } else {
+	lp = lforw(oldlp);
+	while (lp != oldlp) {
+	    if (llength(lp) > (int) namelen) {
+		if (!compare(lvalue(lp), name, namelen)) {
+		    retlp = lp;
+		    break;
+		}
+	    }
+	    lp = lforw(lp);
+	}
     }
     if (added_tab)
 	name[namelen - 1] = EOS;
@@ -606,7 +736,7 @@ cheap_buffer_scan(BUFFER *bp, char *patrn, int dir)
     regexp *exp;
     int ic = FALSE;
 
-    if ((exp = regcomp(patrn, strlen(patrn), FALSE)) != NULL) {
+    if ((exp = regcomp_cached(patrn, strlen(patrn), FALSE)) != NULL) {
 #ifdef MDTAGIGNORECASE
 	ic = b_val(bp, MDTAGIGNORECASE);
 #endif
@@ -689,7 +819,8 @@ tag_search(char *tag, int taglen, int initial)
 	}
 
 	if (tagbp) {
-	    lp = cheap_tag_scan((initial || retried
+	    lp = cheap_tag_scan(tagbp,
+				(initial || retried
 				 ? buf_head(tagbp)
 				 : tagbp->b_dot.l),
 				tag, (size_t) taglen);
@@ -100,6 +100,19 @@ static int given_bcolor = NO_COLOR;
 
 static int shown_fcolor = NO_COLOR;
 static int shown_bcolor = NO_COLOR;
+
+/*
+ * The colors which we last sent to the terminal, so we need only send the
+ * ones which change.  PEN_UNKNOWN is used after sending something which may
+ * or may not have reset the colors.
+ */
+#define PEN_UNKNOWN (-2)
+static int pen_fcolor = PEN_UNKNOWN;
+static int pen_bcolor = PEN_UNKNOWN;
+
+static void forget_pen(const char *reset);
+#else
+#define forget_pen(reset)	/* nothing */
 #endif /* OPT_COLOR */
 
 #if SYS_OS2_EMX
@@ -416,6 +429,7 @@ tcap_close(void)
 #if OPT_COLOR
     shown_fcolor = shown_bcolor =
 	given_fcolor = given_bcolor = NO_COLOR;
+    pen_fcolor = pen_bcolor = PEN_UNKNOWN;
 #endif
     /* all of the ways one could find the original title and restore it
      * are too clumsy.  Setting it to $TERM is a nice way to appease about
@@ -456,6 +470,7 @@ tcap_kopen(void)
 	    putpad(tc_TI);
 	    ttrow = ttcol = -1;	/* 'ti' may move the cursor */
 	}
+	forget_pen(NULL);	/* a subprocess may have changed colors */
 	if (tc_KS)
 	    putpad(tc_KS);
     }
@@ -500,8 +515,10 @@ end_reverse(void)
 {
     if (tc_MR != NULL) {
 	putpad(tc_ME);
+	forget_pen(tc_ME);
     } else if (tc_SO != NULL) {
 	putpad(tc_SE);
+	forget_pen(tc_SE);
     }
 }
 
@@ -684,6 +701,20 @@ tcapscrollregion(int top, int bot)
 	putpad(tgoto(tc_CS, bot, top));
 }
 
+#if OPT_COLOR || OPT_VIDEO_ATTRS
+/*
+ * Check if the given string resets all video attributes and colors, i.e., it
+ * contains the ANSI sgr0 sequence.
+ */
+static int
+resets_all(const char *s)
+{
+    return (s != NULL
+	    && (strstr(s, "\033[m") != NULL
+		|| strstr(s, "\033[0m") != NULL));
+}
+#endif
+
 #if OPT_COLOR
 /*
  * This ugly hack is designed to work around an incompatibility built into
@@ -711,25 +742,50 @@ colors_are_really_ANSI(void)
     return ok;
 }
 
+/*
+ * Note that the terminal's colors have been reset by the given string, e.g.,
+ * sgr0, or may have been changed, if we cannot tell.
+ */
+static void
+forget_pen(const char *reset)
+{
+    if (resets_all(reset)) {
+	pen_fcolor = pen_bcolor = NO_COLOR;
+    } else {
+	pen_fcolor = pen_bcolor = PEN_UNKNOWN;
+    }
+}
+
+/*
+ * Send only the parts of the color pair which differ from the terminal's.
+ * Resetting to the default colors resets both, so the other may have to be
+ * sent again.
+ */
 static void
 show_ansi_colors(void)
 {
     char *t;
 
     if (VALID_TERM && Sf != NULL && Sb != NULL) {
-	if (shown_fcolor == NO_COLOR
-	    || shown_bcolor == NO_COLOR) {
-	    if (OrigColors)
+	if ((shown_fcolor == NO_COLOR && pen_fcolor != NO_COLOR)
+	    || (shown_bcolor == NO_COLOR && pen_bcolor != NO_COLOR)) {
+	    if (OrigColors) {
 		putpad(OrigColors);
+		pen_fcolor = pen_bcolor = NO_COLOR;
+	    }
 	}
 
 	if ((shown_fcolor != NO_COLOR)
+	    && (shown_fcolor != pen_fcolor)
 	    && (t = CALL_TPARM(Sf, shown_fcolor)) != NULL) {
 	    putpad(t);
+	    pen_fcolor = shown_fcolor;
 	}
 	if ((shown_bcolor != NO_COLOR)
+	    && (shown_bcolor != pen_bcolor)
 	    && (t = CALL_TPARM(Sb, shown_bcolor)) != NULL) {
 	    putpad(t);
+	    pen_bcolor = shown_bcolor;
 	}
     }
 }
@@ -751,6 +807,7 @@ static void
 tcap_fcol(int color)
 {
     if (color != given_fcolor) {
+	count_screen_stat(attrs);
 	given_fcolor = color;
 	shown_fcolor = (Sf != NULL) ? Num2Color(color) : NO_COLOR;
 	show_ansi_colors();
@@ -761,6 +818,7 @@ static void
 tcap_bcol(int color)
 {
     if (color != given_bcolor) {
+	count_screen_stat(attrs);
 	given_bcolor = color;
 	shown_bcolor = (Sb != NULL) ? Num2Color(color) : NO_COLOR;
 	show_ansi_colors();
@@ -881,17 +939,29 @@ tcap_attr(UINT attr)
 	register char *s;
 	UINT diff;
 	int ends = !colored;
+	int ended = FALSE;
+	int reset = FALSE;
 #if OPT_COLOR
 	int redo_color = FALSE;
 #endif
 
+	count_screen_stat(attrs);
+
 	diff = last & ~attr;
-	/* turn OFF old attributes */
+	/*
+	 * Turn OFF old attributes.  Once we have sent an ending which resets
+	 * everything (sgr0), the others need not be sent.  Endings such as
+	 * rmul or ritm only clear their own attribute.
+	 */
 	for (n = 0; n < TABLESIZE(tbl); n++) {
 	    if ((tbl[n].mask & diff) != 0
 		&& (tbl[n].mask & attr) == 0
+		&& !reset
 		&& (s = *(tbl[n].end)) != NULL) {
 		putpad(s);
+		forget_pen(s);
+		ended = TRUE;
+		reset = resets_all(s);
 #if OPT_COLOR
 		/*
 		 * Any of the resets can turn off color, but especially those
@@ -909,7 +979,8 @@ tcap_attr(UINT attr)
 	    reinitialize_colors();
 #endif
 
-	if (all_sgr0)
+	/* if everything was turned off, turn on whatever is still needed */
+	if (ended && all_sgr0)
 	    diff = attr;
 	else
 	    diff = attr & ~last;
@@ -685,6 +685,7 @@ ttputc(OUTC_ARGS)
 OUTC_DCL
 vl_ttputc(int c)
 {
+    count_screen_stat(bytes);
     OUTC_RET putchar((char) c);
 }
 
@@ -801,19 +802,31 @@ ttunwatchfd(int fd, long id GCC_UNUSED)
 #endif
 
 #if USE_SELECT || USE_POLL
+/*
+ * Read the keyboard a block at a time, so that a large paste does not cost a
+ * select() or poll() and a read() for each byte.
+ */
+static char kbd_buffer[BUFSIZ];
+static int kbd_used;
+static int kbd_have;
+
+#define kbd_buffered() (kbd_used < kbd_have)
+
 static int
 vl_getchar(void)
 {
-    char c;
-    int n;
+    if (!kbd_buffered()) {
+	int n = (int) read(0, kbd_buffer, sizeof(kbd_buffer));
 
-    n = (int) read(0, &c, (size_t) 1);
-    if (n <= 0) {
-	if (n < 0 && errno == EINTR)
-	    return -1;
-	imdying(SIGINT);
+	if (n <= 0) {
+	    if (n < 0 && errno == EINTR)
+		return -1;
+	    imdying(SIGINT);
+	}
+	kbd_used = 0;
+	kbd_have = n;
     }
-    return (c & 0xff);
+    return CharOf(kbd_buffer[kbd_used++]);
 }
 #endif
 
@@ -824,6 +837,10 @@ vl_getchar(void)
 int
 ttgetc(void)
 {
+#if USE_SELECT || USE_POLL
+    if (kbd_buffered())
+	return vl_getchar();
+#endif
 #if USE_SELECT
     for_ever {
 	fd_set read_fds;
@@ -967,8 +984,10 @@ tttypahead(void)
     return x_milli_sleep(0);
 #else
 
-# if USE_SELECT || USE_POLL || defined(__BEOS__)
+# if USE_SELECT || USE_POLL
     /* use the watchinput part of catnap if it's useful */
+    return kbd_buffered() || catnap(0, TRUE);
+# elif defined(__BEOS__)
     return catnap(0, TRUE);
 # else
 #  if	USE_FIONREAD
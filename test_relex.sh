@@ -0,0 +1,93 @@
+#!/bin/sh
+#
+# Check that autocoloring re-lexes an edit inside a multi-line comment, i.e.,
+# the lines after a newly typed end-of-comment lose the comment color, while
+# the lines before it keep the color.  This needs vile configured with the
+# built-in filters, and script(1) to run it on a pseudo-terminal:
+#	sh test_relex.sh ./vile
+#
+VILE=${1-./vile}
+case "$VILE" in #(vi
+/*)	;;
+*)	VILE=`pwd`/$VILE
+	;;
+esac
+SRCDIR=`dirname "$0"`
+SRCDIR=`cd "$SRCDIR" && pwd`
+
+if ! type script >/dev/null 2>&1; then
+	echo "SKIP: script(1) is not available"
+	exit 0
+fi
+
+WORK=`mktemp -d 2>/dev/null || echo /tmp/test_relex$$`
+trap 'rm -rf "$WORK"' EXIT INT QUIT TERM
+mkdir -p "$WORK" || exit 1
+
+cat >"$WORK/init.rc" <<'EOF'
+source modes.rc
+source filters.rc
+setv $autocolor-hook HighlightFilter
+setv $read-hook HighlightFilter
+set autocolor=20
+set highlight
+EOF
+
+{
+	echo "int before;"
+	echo "/* comment start"
+	n=3
+	while [ $n -le 11 ]; do
+		echo " * comment line $n"
+		n=`expr $n + 1`
+	done
+	echo " */"
+	echo "int after;"
+} >"$WORK/test.c"
+
+# close the comment on line 6, let autocolor run, then write the attributes
+{
+	sleep 2
+	printf '6GA */\033'
+	sleep 2
+	printf ':1,$encode-attributes-til\r'
+	sleep 1
+	printf ':w! result.c\r'
+	sleep 1
+	printf ':q!\r'
+	sleep 1
+} | (
+	cd "$WORK" &&
+	VILE_STARTUP_PATH="$WORK:$SRCDIR/macros:$SRCDIR/filters" \
+	VILE_STARTUP_FILE=init.rc \
+	HOME="$WORK" \
+	TERM=vt100 \
+	script -qec "$VILE test.c" /dev/null >/dev/null 2>&1
+)
+
+# a line is in the comment color if an attribute (^A...:) starts its text
+CTL_A=`printf '\001'`
+
+if ! grep "$CTL_A" "$WORK/result.c" >/dev/null 2>&1; then
+	echo "SKIP: no highlighting (are the built-in filters configured?)"
+	exit 0
+fi
+colored() {
+	sed -n "${1}p" "$WORK/result.c" | grep "$CTL_A[^:]*:[ /*]*comment" >/dev/null
+}
+
+status=0
+for n in 2 3 4 5; do
+	if ! colored $n; then
+		echo "FAIL: line $n lost its comment color"
+		status=1
+	fi
+done
+for n in 7 8 9 10 11; do
+	if colored $n; then
+		echo "FAIL: line $n is still colored as a comment"
+		status=1
+	fi
+done
+[ $status = 0 ] && echo "PASS: $0"
+exit $status
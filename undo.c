@@ -107,6 +107,18 @@
  * the cookie wraps around to 0, we _do_ need to clean the buffer, because
  * now there's a chance that the current_undo_cookie might match a very old
  * marked line.
+ *
+ * Notes on deltas:
+ *
+ * Copying a line costs as much as the line is long, however small the
+ * change.  So a long line is instead saved as a "delta":  the part of the
+ * line which is about to change, and the lengths of the unchanged text
+ * before (its "head") and after (its "tail") that part.  Further changes to
+ * the line in the same set of changes widen the delta to cover them, using
+ * the unchanged text next to it.  Undoing a delta swaps the saved text with
+ * the line's current text between the head and tail, so the line itself
+ * stays in the buffer, and needs no patch.  The delta with the swapped-out
+ * text is pushed onto the other stack.
  */
 
 #define FORW 0
@@ -132,9 +144,30 @@ static void preundocleanup(void);
 static void pushline(LINE *lp, LINE **stk);
 static void repointstuff(LINE *nlp, LINE *olp);
 static void setupuline(LINE *lp);
+static int undo_delta(LINE *dlp, int stkindx);
+
+/* lines at least this long are saved for undo as deltas */
+#define DELTA_MIN 1024
+
+/*
+ * The text of a delta begins with this, followed by the saved text.  The head
+ * is in l_back_offs, and the line which it changes is lforw().
+ */
+typedef struct {
+    C_NUM d_tail;		/* length of unchanged text after the change */
+    C_NUM d_used;		/* length of the saved text */
+} DELTA;
+
+#define DeltaOf(lp)	((DELTA *) (void *) lvalue(lp))
+#define DeltaHead(lp)	((lp)->l_back_offs)
+#define DeltaTail(lp)	(DeltaOf(lp)->d_tail)
+#define DeltaUsed(lp)	(DeltaOf(lp)->d_used)
+#define DeltaText(lp)	(lvalue(lp) + sizeof(DELTA))
 
 static short needundocleanup;
 
+static LINE *last_delta;	/* the delta which was last made or widened */
+
 /* this could be per-buffer, but i don't think it matters in practice */
 static USHORT current_undo_cookie = 1;	/* see L_FLAG.cook */
 
@@ -176,6 +209,8 @@ toss_to_undo(LINE *lp)
     pushline(lp, BACKSTK(curbp));
 
     next = lforw(lp);
+    lsetlexstale(lp);
+    lsetlexstale(next);
 
     /* need to save a dot -- either the next line or
        the previous one */
@@ -200,6 +235,101 @@ toss_to_undo(LINE *lp)
     return2Void();
 }
 
+static LINE *
+alloc_delta(BUFFER *bp,
+	    LINE *lp,
+	    C_NUM head,
+	    C_NUM tail,
+	    const char *text,
+	    C_NUM used)
+{
+    LINE *dlp;
+    size_t size = sizeof(DELTA) + (size_t) used;
+
+    if ((dlp = lalloc(LINEUNDODELTA, bp)) == NULL) {
+	TRACE(("alloc_delta: no memory\n"));
+    } else if ((lvalue(dlp) = ltextalloc(bp, &size)) == NULL) {
+	(void) no_memory("LINE text");
+	lfree(dlp, bp);
+	dlp = NULL;
+    } else {
+	dlp->l_size = size;
+	set_lforw(dlp, lp);
+	set_lback(dlp, NULL);
+	DeltaHead(dlp) = head;
+	DeltaTail(dlp) = tail;
+	DeltaUsed(dlp) = used;
+	if (used > 0)
+	    (void) memcpy(DeltaText(dlp), text, (size_t) used);
+    }
+    return dlp;
+}
+
+/* find the delta for a line in the current set of changes */
+static LINE *
+find_delta(LINE *lp)
+{
+    LINE *dlp = last_delta;
+
+    if (dlp == NULL || lforw(dlp) != lp) {
+	for (dlp = *BACKSTK(curbp); dlp != NULL; dlp = dlp->l_nxtundo) {
+	    if (lisstacksep(dlp)) {
+		dlp = NULL;
+		break;
+	    }
+	    if (lisundodelta(dlp) && lforw(dlp) == lp)
+		break;
+	}
+    }
+    return dlp;
+}
+
+/*
+ * Widen a delta to cover a change to its line, adding the unchanged text
+ * next to it.
+ */
+static int
+widen_delta(LINE *dlp, LINE *lp, C_NUM offset, C_NUM length)
+{
+    C_NUM head = DeltaHead(dlp);
+    C_NUM tail = DeltaTail(dlp);
+    C_NUM used = DeltaUsed(dlp);
+    C_NUM end = llength(lp) - tail;
+    C_NUM before = (offset < head) ? (head - offset) : 0;
+    C_NUM after = (offset + length > end) ? (offset + length - end) : 0;
+    size_t need = sizeof(DELTA) + (size_t) (before + used + after);
+    size_t size = need + need / 2;
+    char *text = lvalue(dlp);
+
+    if (before == 0 && after == 0)
+	return TRUE;
+
+    if (need > dlp->l_size) {
+	if ((text = ltextalloc(curbp, &size)) == NULL) {
+	    (void) no_memory("LINE text");
+	    return FALSE;
+	}
+    }
+    if (used > 0)
+	(void) memmove(text + sizeof(DELTA) + before, DeltaText(dlp),
+		       (size_t) used);
+    if (text != lvalue(dlp)) {
+	ltextfree(dlp, curbp);
+	lvalue(dlp) = text;
+	dlp->l_size = size;
+    }
+    if (before > 0)
+	(void) memcpy(DeltaText(dlp), lvalue(lp) + head - before,
+		      (size_t) before);
+    if (after > 0)
+	(void) memcpy(DeltaText(dlp) + before + used, lvalue(lp) + end,
+		      (size_t) after);
+    DeltaHead(dlp) = head - before;
+    DeltaTail(dlp) = tail - after;
+    DeltaUsed(dlp) = before + used + after;
+    return TRUE;
+}
+
 /*
  * Push a copy of a line onto the undo stack.  Push a patch so we can
  * later fix up any references to this line that might already be in the
@@ -210,16 +340,56 @@ toss_to_undo(LINE *lp)
  */
 int
 copy_for_undo(LINE *lp)
+{
+    return copy_part_for_undo(lp, 0, llength(lp));
+}
+
+/*
+ * As copy_for_undo(), for a change to "length" bytes of the line starting at
+ * "offset" (an insertion has no length).  A long line is saved as a delta
+ * covering just that part.
+ */
+int
+copy_part_for_undo(LINE *lp, C_NUM offset, C_NUM length)
 {
     int status = FALSE;
     LINE *nlp;
 
-    TRACE2((T_CALLED "copy_for_undo(%p)\n", lp));
+    TRACE2((T_CALLED "copy_part_for_undo(%p,%d,%d)\n", lp, offset, length));
     if (needundocleanup)
 	preundocleanup();
 
+    lsetlexdirty(lp);
     if (liscopied(lp)) {
 	status = TRUE;
+	if (lisdelta(lp)) {
+	    if ((nlp = find_delta(lp)) == NULL) {
+		mlforce("BUG: lost the undo delta for a line");
+	    } else if (!widen_delta(nlp, lp, offset, length)) {
+		status = ABORT;
+	    } else {
+		last_delta = nlp;
+	    }
+	}
+    } else if (llength(lp) >= DELTA_MIN) {
+	if ((nlp = alloc_delta(curbp, lp, offset,
+			       llength(lp) - offset - length,
+			       lvalue(lp) + offset, length)) == NULL) {
+	    status = ABORT;
+	} else {
+	    pushline(nlp, BACKSTK(curbp));
+	    last_delta = nlp;
+
+	    lsetcopied(lp);
+	    lsetdelta(lp);
+
+	    setupuline(lp);
+
+	    FORWDOT(curbp).l = lp;
+	    FORWDOT(curbp).o = DOT.o;
+
+	    status = TRUE;
+	}
     } else if ((nlp = copyline(lp)) == NULL) {
 	status = ABORT;
     } else {
@@ -229,6 +399,7 @@ copy_for_undo(LINE *lp)
 	make_undo_patch(lp, nlp);
 
 	lsetcopied(lp);
+	lsetnotdelta(lp);
 
 	setupuline(lp);
 
@@ -266,6 +437,7 @@ tag_for_undo(LINE *lp)
 	pushline(nlp, BACKSTK(curbp));
 
 	lsetcopied(lp);
+	lsetnotdelta(lp);
 	FORWDOT(curbp).l = lp;
 	FORWDOT(curbp).o = DOT.o;
 
@@ -300,6 +472,7 @@ freeundostacks(BUFFER *bp, int both)
     LINE *lp;
 
     TRACE((T_CALLED "freeundostacks(%p,%d)\n", (void *) bp, both));
+    last_delta = NULL;
     while ((lp = popline(FORWSTK(bp), TRUE)) != NULL) {
 	lfree(lp, bp);
     }
@@ -639,7 +812,10 @@ undoworker(int stkindx)
     LINE *alp;
     int nopops = TRUE;
 
+    last_delta = NULL;
     while ((lp = popline(STACK(stkindx), FALSE)) != NULL) {
+	int fresh = FALSE;
+
 	if (nopops)		/* first pop -- establish a new stack base */
 	    freshstack(1 ^ stkindx);
 	nopops = FALSE;
@@ -648,6 +824,11 @@ undoworker(int stkindx)
 	    lfree(lp, curbp);
 	    continue;
 	}
+	if (lisundodelta(lp)) {
+	    if (!undo_delta(lp, stkindx))
+		return (FALSE);
+	    continue;
+	}
 	if (lforw(lback(lp)) != lforw(lp)) {	/* there's something there */
 	    if (lforw(lforw(lback(lp))) == lforw(lp)) {
 		/* then there is exactly one line there */
@@ -656,6 +837,10 @@ undoworker(int stkindx)
 		alp = lforw(lback(lp));
 		repointstuff(lp, alp);
 		/* remove it */
+		if (lisreal(lp))
+		    lindex_replace(curbp, alp, lp);
+		else
+		    lindex_remove(curbp, alp);
 		set_lforw(lback(lp), lforw(alp));
 		set_lback(lforw(alp), lback(alp));
 	    } else {		/* there is more than one line there */
@@ -671,6 +856,7 @@ undoworker(int stkindx)
 		return (FALSE);
 	    }
 	} else {		/* there is no line where we're going */
+	    fresh = TRUE;
 	    /* create an "unreal" tag line to push */
 	    alp = lalloc(LINENOTREAL, curbp);
 	    if (alp == NULL) {
@@ -683,9 +869,13 @@ undoworker(int stkindx)
 
 	/* insert real lines into the buffer
 	   throw away the markers */
+	lsetlexstale(lforw(lp));
 	if (lisreal(lp)) {
 	    set_lforw(lback(lp), lp);
 	    set_lback(lforw(lp), lp);
+	    if (fresh)
+		lindex_insert(curbp, lp);
+	    lsetlexstale(lp);
 	} else {
 	    lfree(lp, curbp);
 	}
@@ -753,6 +943,66 @@ undoworker(int stkindx)
     return TRUE;
 }
 
+/*
+ * Swap the text saved in a delta with the text which has replaced it, and
+ * push the result onto the other stack.
+ */
+static int
+undo_delta(LINE *dlp, int stkindx)
+{
+    LINE *lp = lforw(dlp);
+    LINE *alp;
+    C_NUM head = DeltaHead(dlp);
+    C_NUM tail = DeltaTail(dlp);
+    C_NUM used = DeltaUsed(dlp);
+    C_NUM cut;
+    size_t nsize;
+    char *ntext;
+
+    if (!lisreal(lp)
+	|| head < 0
+	|| tail < 0
+	|| head + tail > llength(lp)) {
+	mlforce("BUG: undo delta does not fit its line");
+	return FALSE;
+    }
+    cut = llength(lp) - head - tail;
+    alp = alloc_delta(curbp, lp, head, tail, lvalue(lp) + head, cut);
+    if (alp == NULL)
+	return FALSE;
+
+    nsize = (size_t) (head + used + tail);
+    if (nsize > lp->l_size) {	/* reallocate */
+	if ((ntext = ltextalloc(curbp, &nsize)) == NULL) {
+	    (void) no_memory("LINE text");
+	    lfree(alp, curbp);
+	    return FALSE;
+	}
+	if (head > 0)
+	    (void) memcpy(ntext, lvalue(lp), (size_t) head);
+	if (tail > 0)
+	    (void) memcpy(ntext + head + used, lvalue(lp) + head + cut,
+			  (size_t) tail);
+	ltextfree(lp, curbp);
+	lvalue(lp) = ntext;
+	lp->l_size = nsize;
+    } else if (tail > 0 && used != cut) {
+	(void) memmove(lvalue(lp) + head + used, lvalue(lp) + head + cut,
+		       (size_t) tail);
+    }
+    if (used > 0)
+	(void) memcpy(lvalue(lp) + head, DeltaText(dlp), (size_t) used);
+    llength(lp) = head + used + tail;
+
+    lsetlexstale(lp);
+    lsetlexstale(lforw(lp));
+    repointstuff(lp, lp);
+
+    lfree(dlp, curbp);
+    pushline(alp, OTHERSTACK(stkindx));
+    return TRUE;
+}
+
 static void
 setupuline(LINE *lp)
 {
@@ -787,6 +1037,7 @@ lineundo(int f GCC_UNUSED, int n GCC_UNUSED)
     LINE *lp;			/* the line we may replace */
     WINDOW *wp;
     char *ntext;
+    size_t nsize;
 
     ulp = curbp->b_ulinep;
     if (ulp == NULL) {
@@ -814,7 +1065,8 @@ lineundo(int f GCC_UNUSED, int n GCC_UNUSED)
     preundocleanup();
 
     ntext = NULL;
-    if (ulp->l_size && (ntext = typeallocn(char, ulp->l_size)) == NULL)
+    nsize = ulp->l_size;
+    if (nsize && (ntext = ltextalloc(curbp, &nsize)) == NULL)
 	  return (FALSE);
 
     CopyForUndo(lp);
@@ -826,7 +1078,7 @@ lineundo(int f GCC_UNUSED, int n GCC_UNUSED)
 
     lvalue(lp) = ntext;
     llength(lp) = llength(ulp);
-    lp->l_size = ulp->l_size;
+    lp->l_size = nsize;
 
 #if ! WINMARK
     if (MK.l == lp)
@@ -966,6 +1218,10 @@ list_undos(LINE *lp)
 	case PURESTACKSEP:
 	    bprintf("*PURESTACKSEP");
 	    break;
+	case LINEUNDODELTA:
+	    bprintf("*LINEUNDODELTA %d %d ", DeltaHead(lp), DeltaTail(lp));
+	    bputsn(DeltaText(lp), DeltaUsed(lp));
+	    break;
 	default:
 	    if (len > 0) {
 		bputsn(lvalue(lp), llength(lp));
@@ -1007,3 +1263,765 @@ show_undostk(int f GCC_UNUSED, int n GCC_UNUSED)
     return liststuff(UNDOSTK_BufName, FALSE, make_undostk, 0, (void *) curbp);
 }
 #endif
+
+#if OPT_UNDOFILE
+/*
+ * Persistent undo:
+ *
+ * If "undo-directory" is set, writing a buffer to its file also saves the
+ * sets of changes on its undo stack in that directory, and reading the file
+ * again restores them.  The stack entries point to lines rather than number
+ * them, so we save the stack by walking it as undoworker() would, on a shadow
+ * copy of the buffer's list of lines.  Each set of changes is written as the
+ * hunks which undo it, each replacing a range of lines (numbered as before
+ * the undo) by those from the stack.  When a hunk replaces one line by one
+ * line, only the bytes which differ are kept, and are read back as a delta:
+ *
+ *	vile-undo <lines> <checksum>
+ *	H <line> <removed> <inserted>
+ *	L <length>			before the text of each inserted line
+ *	D <offset> <cut> <length>	before text replacing part of the line
+ *	G <back-line> <back-offs> <forw-line> <forw-offs>
+ *
+ * The "G" record ends a set, with the dots from its stack separator.  The
+ * newest set is first.
+ */
+#define UNDO_MAGIC "vile-undo"
+
+/*
+ * The undo-history holds the text, including deleted text, in the clear.  Do
+ * not keep it for an encrypted buffer.
+ */
+#if OPT_ENCRYPT
+#define undo_is_secret(bp) b_val(bp, MDCRYPT)
+#else
+#define undo_is_secret(bp) FALSE
+#endif
+
+typedef struct _unode {
+    LINE *lp;
+    struct _unode *base;	/* if lp is a delta, the line which it changes */
+    struct _unode *prev;
+    struct _unode *next;
+    L_NUM index;		/* line-number before undoing the set */
+    int listed;			/* true if in the shadow list */
+} UNODE;
+
+typedef struct {
+    LINE *key;
+    UNODE *node;
+} USLOT;
+
+typedef struct {
+    USLOT *slots;		/* lookup node by line */
+    size_t mask;
+    UNODE *nodes;
+    size_t used;
+    size_t limit;
+    UNODE **order;		/* lookup node by line-number */
+    L_NUM count;
+} USHADOW;
+
+typedef struct {
+    L_NUM line;
+    L_NUM removed;
+    int first;			/* index of its first tag or line */
+    int inserted;
+    int delta;			/* true if the entry is a delta */
+    C_NUM length;		/* ...and the length of the line after undo */
+} UHUNK;
+
+/*
+ * The checksum lets us ignore an undo-file which does not match the file.
+ */
+static ULONG
+undo_checksum(BUFFER *bp, L_NUM *countp)
+{
+    ULONG sum = 2166136261UL;
+    L_NUM count = 0;
+    LINE *lp;
+    int n;
+
+    for_each_line(lp, bp) {
+	for (n = 0; n < llength(lp); ++n)
+	    sum = ((sum ^ CharOf(lvalue(lp)[n])) * 16777619UL) & 0xffffffffUL;
+	sum = ((sum ^ '\n') * 16777619UL) & 0xffffffffUL;
+	++count;
+    }
+    *countp = count;
+    return sum;
+}
+
+static USLOT *
+shadow_slot(USHADOW * sp, LINE *lp)
+{
+    size_t n = (((size_t) lp >> 4) * 2654435761UL) & sp->mask;
+
+    while (sp->slots[n].key != NULL && sp->slots[n].key != lp)
+	n = (n + 1) & sp->mask;
+    return sp->slots + n;
+}
+
+static UNODE *
+shadow_find(USHADOW * sp, LINE *lp)
+{
+    return shadow_slot(sp, lp)->node;
+}
+
+static UNODE *
+shadow_node(USHADOW * sp, LINE *lp)
+{
+    USLOT *slot = shadow_slot(sp, lp);
+
+    if (slot->node == NULL && sp->used < sp->limit) {
+	UNODE *np = sp->nodes + sp->used++;
+
+	memset(np, 0, sizeof(*np));
+	np->lp = lp;
+	slot->key = lp;
+	slot->node = np;
+    }
+    return slot->node;
+}
+
+static void
+shadow_link(UNODE *np, UNODE *prev, UNODE *next)
+{
+    np->prev = prev;
+    np->next = next;
+    prev->next = np;
+    next->prev = np;
+    np->listed = TRUE;
+}
+
+static void
+shadow_number(USHADOW * sp, UNODE *head)
+{
+    UNODE *np;
+
+    sp->count = 0;
+    for (np = head->next; np != head; np = np->next) {
+	np->index = ++(sp->count);
+	sp->order[sp->count] = np;
+    }
+}
+
+/* return the line-number of a node which was listed when last numbered */
+static L_NUM
+shadow_index(USHADOW * sp, UNODE *np)
+{
+    if (np != NULL
+	&& np->index > 0
+	&& np->index <= sp->count
+	&& sp->order[np->index] == np)
+	return np->index;
+    return 0;
+}
+
+static C_NUM
+shadow_length(UNODE *np)
+{
+    LINE *lp = np->lp;
+
+    if (np->base != NULL)
+	return DeltaHead(lp) + DeltaUsed(lp) + DeltaTail(lp);
+    return llength(lp);
+}
+
+/* write part of the text of a line, which may be a delta of another */
+static void
+put_shadow_text(FILE *fp, UNODE *np, C_NUM offset, C_NUM length)
+{
+    while (length > 0) {
+	LINE *lp = np->lp;
+	C_NUM head;
+	C_NUM used;
+	C_NUM part;
+
+	if (np->base == NULL) {
+	    (void) fwrite(lvalue(lp) + offset, sizeof(char), (size_t) length, fp);
+	    break;
+	}
+	head = DeltaHead(lp);
+	used = DeltaUsed(lp);
+	if (offset < head) {
+	    part = (length < head - offset) ? length : (head - offset);
+	    put_shadow_text(fp, np->base, offset, part);
+	} else if (offset < head + used) {
+	    part = (length < head + used - offset) ? length : (head + used - offset);
+	    (void) fwrite(DeltaText(lp) + offset - head,
+			  sizeof(char), (size_t) part, fp);
+	} else {
+	    offset += shadow_length(np->base) - shadow_length(np);
+	    np = np->base;
+	    continue;
+	}
+	offset += part;
+	length -= part;
+    }
+}
+
+/* do to the shadow list what undoworker() would do to the buffer */
+static int
+shadow_undo(USHADOW * sp, LINE *lp)
+{
+    UNODE *prev;
+    UNODE *next;
+    UNODE *np;
+
+    if (lislinepatch(lp)) {
+	USLOT *slot;
+
+	if ((np = shadow_node(sp, lback(lp))) == NULL)
+	    return FALSE;
+	/* like applypatch(), later references to the original are to the copy */
+	slot = shadow_slot(sp, lforw(lp));
+	slot->key = lforw(lp);
+	slot->node = np;
+	return TRUE;
+    }
+
+    if (lisundodelta(lp)) {
+	UNODE *base;
+	USLOT *slot;
+
+	if ((np = shadow_node(sp, lp)) == NULL
+	    || (base = shadow_node(sp, lforw(lp))) == NULL
+	    || !base->listed
+	    || DeltaHead(lp) + DeltaTail(lp) > shadow_length(base))
+	    return FALSE;
+	/* the changed line takes the place of the line, under its name */
+	np->base = base;
+	shadow_link(np, base->prev, base->next);
+	base->listed = FALSE;
+	slot = shadow_slot(sp, lforw(lp));
+	slot->node = np;
+	return TRUE;
+    }
+
+    if ((prev = shadow_node(sp, lback(lp))) == NULL
+	|| (next = shadow_node(sp, lforw(lp))) == NULL
+	|| !prev->listed
+	|| !next->listed)
+	return FALSE;
+
+    if ((np = prev->next) != next) {
+	if (np->next != next)
+	    return FALSE;
+	np->listed = FALSE;
+	prev->next = next;
+	next->prev = prev;
+    }
+    if (lisreal(lp)) {
+	if ((np = shadow_node(sp, lp)) == NULL || np->listed)
+	    return FALSE;
+	np->index = 0;
+	shadow_link(np, prev, next);
+    }
+    return TRUE;
+}
+
+static void
+put_undo_hunk(FILE *fp,
+	      USHADOW * sp,
+	      L_NUM line,
+	      L_NUM removed,
+	      UNODE *first,
+	      int inserted)
+{
+    fprintf(fp, "H %d %d %d\n", line, removed, inserted);
+    if (removed == 1 && inserted == 1) {
+	UNODE *onp = sp->order[line];
+	int olen = shadow_length(onp);
+	int nlen = shadow_length(first);
+	int head = 0;
+	int tail = 0;
+
+	if (first->base == onp) {
+	    head = DeltaHead(first->lp);
+	    tail = DeltaTail(first->lp);
+	} else if (onp->base == NULL && first->base == NULL) {
+	    LINE *olp = onp->lp;
+	    LINE *nlp = first->lp;
+
+	    while (head < olen
+		   && head < nlen
+		   && lvalue(olp)[head] == lvalue(nlp)[head])
+		++head;
+	    while (tail < olen - head
+		   && tail < nlen - head
+		   && lvalue(olp)[olen - 1 - tail] == lvalue(nlp)[nlen - 1 - tail])
+		++tail;
+	}
+	fprintf(fp, "D %d %d %d\n", head, olen - head - tail, nlen - head - tail);
+	put_shadow_text(fp, first, head, nlen - head - tail);
+	(void) fputc('\n', fp);
+    } else {
+	while (inserted-- > 0) {
+	    fprintf(fp, "L %d\n", shadow_length(first));
+	    put_shadow_text(fp, first, 0, shadow_length(first));
+	    (void) fputc('\n', fp);
+	    first = first->next;
+	}
+    }
+}
+
+/*
+ * The shadow list has been undone to the given separator.  Compare it with
+ * the numbering from before the undo, writing a hunk for each range which
+ * differs.
+ */
+static void
+put_undo_set(FILE *fp, USHADOW * sp, UNODE *head, LINE *sep)
+{
+    L_NUM forw = shadow_index(sp, shadow_find(sp, lforw(sep)));
+    L_NUM expect = 1;
+    L_NUM upto;
+    UNODE *np;
+    UNODE *first = NULL;
+    int inserted = 0;
+
+    for (np = head->next;; np = np->next) {
+	if (np == head || shadow_index(sp, np) != 0) {
+	    upto = (np == head) ? (sp->count + 1) : np->index;
+	    if (upto > expect || inserted != 0)
+		put_undo_hunk(fp, sp, expect, upto - expect, first, inserted);
+	    if (np == head)
+		break;
+	    expect = upto + 1;
+	    first = NULL;
+	    inserted = 0;
+	} else if (inserted++ == 0) {
+	    first = np;
+	}
+    }
+    shadow_number(sp, head);
+    fprintf(fp, "G %d %d %d %d\n",
+	    shadow_index(sp, shadow_find(sp, lback(sep))),
+	    sep->l_back_offs,
+	    forw,
+	    sep->l_forw_offs);
+}
+
+/*
+ * Save the undo stack of a buffer which has just been written to its file.
+ */
+void
+write_undo_file(BUFFER *bp)
+{
+    USHADOW shadow;
+    UNODE *head;
+    UNODE *np;
+    LINE *lp;
+    FILE *fp;
+    size_t entries = 0;
+    size_t slots;
+    L_NUM count;
+    ULONG sum;
+    int ok = FALSE;
+
+    TRACE((T_CALLED "write_undo_file(%s)\n", bp->b_bname));
+    if (!b_val(bp, MDUNDOABLE) || *BACKSTK(bp) == NULL || undo_is_secret(bp)) {
+	remove_undo_file(bp);
+	returnVoid();
+    }
+    if ((fp = open_undo_file(bp, TRUE)) == NULL)
+	returnVoid();
+
+    for (lp = *BACKSTK(bp); lp != NULL; lp = lp->l_nxtundo)
+	++entries;
+    sum = undo_checksum(bp, &count);
+
+    memset(&shadow, 0, sizeof(shadow));
+    shadow.limit = (size_t) count + (3 * entries) + 2;
+    for (slots = 16; slots < 4 * shadow.limit; slots <<= 1) {
+	;
+    }
+    shadow.mask = slots - 1;
+    shadow.slots = typecallocn(USLOT, slots);
+    shadow.nodes = typeallocn(UNODE, shadow.limit);
+    shadow.order = typeallocn(UNODE *, shadow.limit + 1);
+
+    if (shadow.slots != NULL
+	&& shadow.nodes != NULL
+	&& shadow.order != NULL) {
+
+	head = shadow_node(&shadow, buf_head(bp));
+	head->prev = head->next = head;
+	head->listed = TRUE;
+	for_each_line(lp, bp) {
+	    np = shadow_node(&shadow, lp);
+	    shadow_link(np, head->prev, head);
+	}
+	shadow_number(&shadow, head);
+
+	fprintf(fp, "%s %d %lu\n", UNDO_MAGIC, count, sum);
+	ok = TRUE;
+	for (lp = *BACKSTK(bp); ok && lp != NULL; lp = lp->l_nxtundo) {
+	    if (lisstacksep(lp))
+		put_undo_set(fp, &shadow, head, lp);
+	    else
+		ok = shadow_undo(&shadow, lp);
+	}
+    }
+    if (ferror(fp))
+	ok = FALSE;
+    if (fclose(fp) != 0)
+	ok = FALSE;
+    if (!ok) {
+	TRACE(("...cannot save undo stack\n"));
+	remove_undo_file(bp);
+    }
+
+    FreeIfNeeded(shadow.slots);
+    FreeIfNeeded(shadow.nodes);
+    FreeIfNeeded(shadow.order);
+    returnVoid();
+}
+
+static int
+get_undo_text(FILE *fp, char *text, int length)
+{
+    if (length > 0
+	&& fread(text, sizeof(char), (size_t) length, fp) != (size_t) length)
+	return FALSE;
+    return (fgetc(fp) == '\n');
+}
+
+/* read the text of a line which an undo will put back */
+static LINE *
+get_undo_line(FILE *fp, BUFFER *bp)
+{
+    char buffer[NSTRING];
+    LINE *lp = NULL;
+    int length;
+
+    if (fgets(buffer, (int) sizeof(buffer), fp) != NULL
+	&& sscanf(buffer, "L %d", &length) == 1
+	&& length >= 0
+	&& (lp = lalloc(length, bp)) != NULL
+	&& !get_undo_text(fp, lvalue(lp), length)) {
+	lfree(lp, bp);
+	lp = NULL;
+    }
+    return lp;
+}
+
+/* read the part of a line which an undo will put back, as a delta */
+static LINE *
+get_undo_delta(FILE *fp, BUFFER *bp, LINE *olp, C_NUM *lengthp)
+{
+    char buffer[NSTRING];
+    LINE *lp = NULL;
+    int head, cut, length;
+
+    if (fgets(buffer, (int) sizeof(buffer), fp) != NULL
+	&& sscanf(buffer, "D %d %d %d", &head, &cut, &length) == 3
+	&& head >= 0
+	&& cut >= 0
+	&& length >= 0
+	&& head + cut <= *lengthp
+	&& (lp = alloc_delta(bp, olp, head, *lengthp - head - cut,
+			     NULL, 0)) != NULL) {
+	size_t size = sizeof(DELTA) + (size_t) length;
+	char *text;
+
+	if (size > lp->l_size) {
+	    if ((text = ltextalloc(bp, &size)) == NULL) {
+		lfree(lp, bp);
+		return NULL;
+	    }
+	    (void) memcpy(text, lvalue(lp), sizeof(DELTA));
+	    ltextfree(lp, bp);
+	    lvalue(lp) = text;
+	    lp->l_size = size;
+	}
+	DeltaUsed(lp) = length;
+	if (!get_undo_text(fp, DeltaText(lp), length)) {
+	    lfree(lp, bp);
+	    lp = NULL;
+	} else {
+	    *lengthp += length - cut;
+	}
+    }
+    return lp;
+}
+
+static int
+add_undo_entry(LINE ***entriesp, size_t *maxp, int *nump, LINE *lp)
+{
+    if (lp != NULL && (size_t) *nump >= *maxp) {
+	*maxp = (*maxp + 16) * 2;
+	safe_typereallocn(LINE *, *entriesp, *maxp);
+    }
+    if (lp == NULL || *entriesp == NULL) {
+	*nump = 0;
+	return FALSE;
+    }
+    (*entriesp)[(*nump)++] = lp;
+    return TRUE;
+}
+
+static void
+set_undo_dot(LINE *sep,
+	     LINE **list,
+	     C_NUM *lens,
+	     L_NUM count,
+	     L_NUM line,
+	     C_NUM offs,
+	     int back)
+{
+    L_NUM n = (line > 0 && line <= count) ? line : 1;
+    LINE *dot = list[n];
+
+    if (offs > lens[n])
+	offs = lens[n];
+    if (offs < 0)
+	offs = 0;
+    if (back) {
+	set_lback(sep, dot);
+	sep->l_back_offs = offs;
+    } else {
+	set_lforw(sep, dot);
+	sep->l_forw_offs = offs;
+    }
+}
+
+/*
+ * Restore the undo stack of a buffer which has just been read from its file,
+ * if the undo-file matches it.  Like undoworker(), we keep a list of the lines
+ * as each set is undone, so that each stack entry can point to the lines
+ * which will be there when it is popped.  The hunks of a set are popped from
+ * the end, so that the lines before each hunk are unchanged.  A delta changes
+ * its line in place, so we also keep the lengths which the lines will have.
+ */
+void
+read_undo_file(BUFFER *bp)
+{
+    char buffer[NSTRING];
+    FILE *fp;
+    LINE *lp;
+    LINE **list = NULL;		/* the lines before undoing a set */
+    LINE **next;		/* ...and after */
+    C_NUM *lens = NULL;		/* the lengths of the lines before */
+    C_NUM *next_lens;		/* ...and after */
+    LINE **entries = NULL;	/* tags and lines for the hunks of a set */
+    UHUNK *hunks = NULL;
+    size_t max_entries = 0;
+    size_t max_hunks = 0;
+    int num_entries = 0;
+    int num_hunks = 0;
+    LINE *top = NULL;		/* the stack which we are building */
+    LINE **tail = &top;
+    LINE *newer = NULL;		/* the separator of the newer set */
+    LINE *newest = NULL;
+    int sets = 0;
+    int limit = b_val(bp, VAL_UNDOLIM);
+    int ok = TRUE;
+    int n, j;
+    L_NUM count;
+    L_NUM have_count;
+    ULONG have_sum;
+    ULONG sum;
+
+    TRACE((T_CALLED "read_undo_file(%s)\n", bp->b_bname));
+    if (undo_is_secret(bp)) {
+	remove_undo_file(bp);
+	returnVoid();
+    }
+    if (!b_val(bp, MDUNDOABLE)
+	|| *BACKSTK(bp) != NULL
+	|| (fp = open_undo_file(bp, FALSE)) == NULL)
+	returnVoid();
+
+    lazyreadf_finish(bp);
+    sum = undo_checksum(bp, &count);
+    if (fgets(buffer, (int) sizeof(buffer), fp) == NULL
+	|| sscanf(buffer, UNDO_MAGIC " %d %lu", &have_count, &have_sum) != 2
+	|| have_count != count
+	|| have_sum != sum
+	|| (list = typeallocn(LINE *, (size_t) count + 2)) == NULL
+	|| (lens = typeallocn(C_NUM, (size_t) count + 2)) == NULL) {
+	TRACE(("...undo-file does not match\n"));
+	ok = FALSE;
+    } else {
+	n = 0;
+	list[n] = buf_head(bp);
+	lens[n] = 0;
+	for_each_line(lp, bp) {
+	    list[++n] = lp;
+	    lens[n] = llength(lp);
+	}
+	list[++n] = buf_head(bp);
+	lens[n] = 0;
+    }
+
+    while (ok && fgets(buffer, (int) sizeof(buffer), fp) != NULL) {
+	UHUNK hunk;
+	L_NUM back_line, forw_line;
+	C_NUM back_offs, forw_offs;
+	L_NUM after;
+
+	if (sscanf(buffer, "H %d %d %d",
+		   &hunk.line, &hunk.removed, &hunk.inserted) == 3) {
+	    /* hunks must be in order, with an unchanged line between */
+	    after = (num_hunks
+		     ? (hunks[num_hunks - 1].line
+			+ hunks[num_hunks - 1].removed + 1)
+		     : 1);
+	    if (hunk.line < after
+		|| hunk.removed < 0
+		|| hunk.inserted < 0
+		|| hunk.line + hunk.removed > count + 1) {
+		ok = FALSE;
+		break;
+	    }
+	    hunk.first = num_entries;
+	    hunk.delta = (hunk.removed == 1 && hunk.inserted == 1);
+	    hunk.length = lens[hunk.line];
+	    if (hunk.delta) {
+		lp = get_undo_delta(fp, bp, list[hunk.line], &hunk.length);
+		ok = add_undo_entry(&entries, &max_entries, &num_entries, lp);
+	    }
+	    for (n = 0; ok && !hunk.delta && n < hunk.removed; ++n) {
+		ok = add_undo_entry(&entries, &max_entries, &num_entries,
+				    lalloc(LINENOTREAL, bp));
+	    }
+	    for (n = 0; ok && !hunk.delta && n < hunk.inserted; ++n) {
+		lp = get_undo_line(fp, bp);
+		ok = add_undo_entry(&entries, &max_entries, &num_entries, lp);
+	    }
+	    if (ok && (size_t) num_hunks >= max_hunks) {
+		max_hunks = (max_hunks + 16) * 2;
+		safe_typereallocn(UHUNK, hunks, max_hunks);
+		if (hunks == NULL)
+		    ok = FALSE;
+	    }
+	    if (ok)
+		hunks[num_hunks++] = hunk;
+	} else if (sscanf(buffer, "G %d %d %d %d",
+			  &back_line, &back_offs,
+			  &forw_line, &forw_offs) == 4) {
+	    L_NUM next_count = count;
+	    LINE *sep = NULL;
+
+	    for (n = 0; n < num_hunks; ++n)
+		next_count += hunks[n].inserted - hunks[n].removed;
+	    next_lens = NULL;
+	    if ((next = typeallocn(LINE *, (size_t) next_count + 2)) == NULL
+		|| (next_lens = typeallocn(C_NUM, (size_t) next_count + 2)) == NULL
+		|| (sep = lalloc(STACKSEP, bp)) == NULL) {
+		FreeIfNeeded(next);
+		FreeIfNeeded(next_lens);
+		ok = FALSE;
+		break;
+	    }
+
+	    /* pop tags for the lines to remove, then the lines to put back */
+	    for (n = num_hunks - 1; n >= 0; --n) {
+		LINE *before = list[hunks[n].line - 1];
+		LINE *beyond = list[hunks[n].line + hunks[n].removed];
+		LINE **ep = entries + hunks[n].first;
+
+		if (hunks[n].delta) {
+		    lp = *ep;
+		    *tail = lp;
+		    tail = &(lp->l_nxtundo);
+		    continue;
+		}
+		for (j = 0; j < hunks[n].removed; ++j) {
+		    lp = *ep++;
+		    set_lback(lp, before);
+		    set_lforw(lp, list[hunks[n].line + j + 1]);
+		    *tail = lp;
+		    tail = &(lp->l_nxtundo);
+		}
+		for (j = 0; j < hunks[n].inserted; ++j) {
+		    lp = *ep++;
+		    set_lback(lp, before);
+		    set_lforw(lp, beyond);
+		    *tail = lp;
+		    tail = &(lp->l_nxtundo);
+		    before = lp;
+		}
+	    }
+
+	    /* list the lines as they will be after the undo */
+	    j = 0;
+	    next[j] = buf_head(bp);
+	    next_lens[j] = 0;
+	    for (n = 0, after = 1; n <= num_hunks; ++n) {
+		L_NUM upto = (n < num_hunks) ? hunks[n].line : (count + 1);
+
+		while (after < upto) {
+		    next[++j] = list[after];
+		    next_lens[j] = lens[after++];
+		}
+		if (n >= num_hunks) {
+		    ;
+		} else if (hunks[n].delta) {
+		    next[++j] = list[after++];
+		    next_lens[j] = hunks[n].length;
+		} else {
+		    LINE **ep = entries + hunks[n].first + hunks[n].removed;
+		    int k;
+
+		    for (k = 0; k < hunks[n].inserted; ++k) {
+			next[++j] = *ep++;
+			next_lens[j] = llength(next[j]);
+		    }
+		    after += hunks[n].removed;
+		}
+	    }
+	    next[++j] = buf_head(bp);
+	    next_lens[j] = 0;
+
+	    set_undo_dot(sep, next, next_lens, next_count,
+			 back_line, back_offs, TRUE);
+	    set_undo_dot(sep, list, lens, count,
+			 forw_line, forw_offs, FALSE);
+	    *tail = sep;
+	    tail = &(sep->l_nxtundo);
+	    sep->l_nextsep = newer;
+	    if (newer == NULL)
+		newest = sep;
+	    newer = sep;
+	    ++sets;
+
+	    free(list);
+	    free(lens);
+	    list = next;
+	    lens = next_lens;
+	    count = next_count;
+	    num_hunks = 0;
+	    num_entries = 0;
+	    if (limit > 0 && sets >= limit)
+		break;
+	} else {
+	    ok = FALSE;
+	}
+    }
+    (void) fclose(fp);
+
+    /* discard an incomplete set */
+    for (n = 0; n < num_entries; ++n)
+	lfree(entries[n], bp);
+
+    if (top != NULL) {
+	*BACKSTK(bp) = top;
+	bp->b_udtail = newer;
+	bp->b_udlastsep = newest;
+	bp->b_udcount = sets;
+	bp->b_udstkindx = BACK;
+	BACKDOT(bp).l = FORWDOT(bp).l = lforw(buf_head(bp));
+	BACKDOT(bp).o = FORWDOT(bp).o = 0;
+	TRACE(("...restored %d sets of changes\n", sets));
+    }
+
+    FreeIfNeeded(list);
+    FreeIfNeeded(lens);
+    FreeIfNeeded(entries);
+    FreeIfNeeded(hunks);
+    returnVoid();
+}
+#endif /* OPT_UNDOFILE */
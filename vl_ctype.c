@@ -32,6 +32,8 @@ vl_ctype_init(int print_lo, int print_hi)
 	   print_lo,
 	   print_hi));
 
+    vl_ctype_gen++;
+
     /* If we're using the locale functions, set our flags based on its
      * tables.  Note that just because you have 'setlocale()' doesn't mean
      * that the tables are present or correct.  But this is a start.
@@ -377,6 +379,7 @@ vl_ctype_apply(void)
     unsigned n;
 
     TRACE(("vl_ctype_apply\n"));
+    vl_ctype_gen++;
     if (ctype_sets) {
 	for (n = 0; n < N_chars; n++) {
 	    addVlCTYPE(n, ctype_sets[n]);
@@ -409,6 +412,8 @@ vl_ctype_set(int ch, CHARTYPE cclass)
 {
     TRACE(("vl_ctype_set %d:%#lx\n", ch, (ULONG) cclass));
 
+    vl_ctype_gen++;
+
     if (ctype_sets == NULL) {
 	ctype_sets = typecallocn(CHARTYPE, (size_t) N_chars);
     }
@@ -426,6 +431,8 @@ vl_ctype_clr(int ch, CHARTYPE cclass)
 {
     TRACE(("vl_ctype_clr %d:%#lx\n", ch, (ULONG) cclass));
 
+    vl_ctype_gen++;
+
     if (ctype_clrs == NULL) {
 	ctype_clrs = typecallocn(CHARTYPE, (size_t) N_chars);
     }
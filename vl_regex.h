@@ -52,8 +52,14 @@ typedef struct regexp {
     char reganch;		/* Internal use only. */
     int regmust;		/* Internal use only. */
     size_t regmlen;		/* Internal use only. */
+    char regmprefix;		/* Internal use only. */
+    int regrare;		/* Internal use only. */
+    int regrare_ic;		/* Internal use only. */
+    int regfast;		/* Internal use only. */
+    int regclass;		/* Internal use only. */
     size_t size;		/* vile addition -- how big is this */
     size_t uppercase;		/* vile addition -- uppercase chars in pattern */
+    int reglook;		/* vile addition -- looks before the match */
     char program[1];		/* Unwarranted chumminess with compiler. */
 } regexp;
 
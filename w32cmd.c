@@ -1230,7 +1230,7 @@ print_rgn_data(void *argp, int l, int r)
 				       " ",
 				       1,
 				       pparam->mcpl,
-				       lp->l_number,
+				       line_no(curbp, lp),
 				       &saw_ff);
 	    } else {
 		pparam->buf[0] = ' ';
@@ -1241,7 +1241,7 @@ print_rgn_data(void *argp, int l, int r)
 				      src + outlen,
 				      vile_llen - outlen,
 				      pparam->mcpl,
-				      (outlen == 0) ? lp->l_number : 0,
+				      (outlen == 0) ? line_no(curbp, lp) : 0,
 				      &saw_ff);
 	}
 	winprint_write(pd->hDC,
@@ -1359,7 +1359,7 @@ winprint_curbuffer_collated(PRINT_PARAM * pparam)
 					   " ",
 					   1,
 					   pparam->mcpl,
-					   lp->l_number,
+					   line_no(curbp, lp),
 					   &saw_ff);
 		} else {
 		    pparam->buf[0] = ' ';
@@ -1370,7 +1370,7 @@ winprint_curbuffer_collated(PRINT_PARAM * pparam)
 					  lvalue(lp) + outlen,
 					  vile_llen - outlen,
 					  pparam->mcpl,
-					  (outlen == 0) ? lp->l_number : 0,
+					  (outlen == 0) ? line_no(curbp, lp) : 0,
 					  &saw_ff);
 	    }
 	    winprint_write(pd->hDC,
@@ -1492,7 +1492,7 @@ winprint_curbuffer_uncollated(PRINT_PARAM * pparam,
 					   " ",
 					   1,
 					   pparam->mcpl,
-					   lp->l_number,
+					   line_no(curbp, lp),
 					   &saw_ff);
 		} else {
 		    pparam->buf[0] = ' ';
@@ -1503,7 +1503,7 @@ winprint_curbuffer_uncollated(PRINT_PARAM * pparam,
 					  lvalue(lp) + outlen,
 					  vile_llen - outlen,
 					  pparam->mcpl,
-					  (outlen == 0) ? lp->l_number : 0,
+					  (outlen == 0) ? line_no(curbp, lp) : 0,
 					  &saw_ff);
 	    }
 	    winprint_write(pd->hDC,
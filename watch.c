@@ -10,6 +10,7 @@
 
 typedef struct {
     char *callback;		/* a vile command to run... */
+    WatchFunc handler;		/* ...or a function to call */
     long otherid;		/* e.g, the XtInputId is stored here for x11. */
     WATCHTYPE type;		/* one of WATCHINPUT, WATCHOUTPUT, or WATCHERROR */
 } watchrec;
@@ -21,12 +22,17 @@ static watchrec *watchfds[NWATCHFDS];
 static void unwatch_dealloc(int fd);
 static void unwatch_free_callback(char *callback);
 
-int
-watchfd(int fd, WATCHTYPE type, char *callback)
+static int
+watchfd_common(int fd, WATCHTYPE type, char *callback, WatchFunc handler)
 {
     long otherid;
     int status;
 
+    if (fd < 0 || fd >= NWATCHFDS) {
+	unwatch_free_callback(callback);
+	return FALSE;
+    }
+
     if (watchfds[fd]) {
 	/* Already allocated/watched, so deallocate/unwatch */
 	unwatchfd(fd);
@@ -43,6 +49,7 @@ watchfd(int fd, WATCHTYPE type, char *callback)
 
     /* *INDENT-EQLS* */
     watchfds[fd]->callback = callback;
+    watchfds[fd]->handler  = handler;
     watchfds[fd]->type     = type;
     watchfds[fd]->otherid  = otherid;
 
@@ -53,10 +60,26 @@ watchfd(int fd, WATCHTYPE type, char *callback)
     return status;
 }
 
+int
+watchfd(int fd, WATCHTYPE type, char *callback)
+{
+    return watchfd_common(fd, type, callback, NULL);
+}
+
+/*
+ * Watch a file descriptor on behalf of the editor itself, calling a function
+ * rather than running a command.
+ */
+int
+watchfd_func(int fd, WATCHTYPE type, WatchFunc handler)
+{
+    return watchfd_common(fd, type, NULL, handler);
+}
+
 void
 unwatchfd(int fd)
 {
-    if (watchfds[fd] == NULL)
+    if (fd < 0 || fd >= NWATCHFDS || watchfds[fd] == NULL)
 	return;
 
     term.unwatchfd(fd, watchfds[fd]->otherid);
@@ -66,6 +89,15 @@ unwatchfd(int fd)
 void
 dowatchcallback(int fd)
 {
+    if (fd < 0 || fd >= NWATCHFDS || watchfds[fd] == NULL)
+	return;
+
+    /* Handlers do not interact with the user, so they are always safe */
+    if (watchfds[fd]->handler != NULL) {
+	(*watchfds[fd]->handler) (fd);
+	return;
+    }
+
     /* Not safe to do one of these callbacks when the user is
        typing on the message line.  FIXME. */
     if (reading_msg_line)
@@ -114,9 +114,17 @@
  *-----------------------------------------------------------------------------
  */
 
+#ifdef MAKE_WCWTBL
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <wcwidth.h>
+#else
 #include <estruct.h>
 #include <edef.h>
 #include <wcwidth.h>
+#include <newidth.h>
 
 #if OPT_LOCALE
 #include <locale.h>
@@ -124,6 +132,7 @@
 #include <wchar.h>		/* prototype for wcwidth() */
 #endif
 #endif
+#endif /* MAKE_WCWTBL */
 
 struct interval {
     unsigned long first;
@@ -132,6 +141,22 @@ struct interval {
 
 static int use_latin1 = 1;
 
+/*
+ * For codes below WCW_LIMIT, mk_wcwidth() indexes a three-stage table which
+ * mkwidth (this file, compiled with MAKE_WCWTBL) generates from the interval
+ * tables:  the high bits select a block of the second stage, the middle bits
+ * select a block of widths from the third stage, and the low bits select the
+ * width.  Identical blocks are shared, keeping the tables small.
+ */
+#define WCW_LIMIT	0x110000UL
+#define WCW_LOW		7	/* bits used to index a block of widths */
+#define WCW_MID		5	/* bits used to index a second-stage block */
+
+#define WCW_LOOKUP(c) \
+	wcw_stage3[wcw_stage2[wcw_stage1[(c) >> (WCW_LOW + WCW_MID)]] \
+				       [((c) >> WCW_LOW) & ((1 << WCW_MID) - 1)]] \
+		  [(c) & ((1 << WCW_LOW) - 1)]
+
 /* auxiliary function for binary search in interval table */
 static int
 bisearch(unsigned long ucs, const struct interval *table, int max)
@@ -200,11 +225,9 @@ bisearch(unsigned long ucs, const struct interval *table, int max)
  * in ISO 10646.
  */
 
-int
-mk_wcwidth(wchar_t ucs)
+static int
+search_wcwidth(unsigned long cmp)
 {
-    unsigned long cmp = (unsigned long) ucs;
-
     /* sorted list of non-overlapping intervals of formatting characters */
     /* generated by
      *    uniset +cat=Cf -00AD -0600-0605 -061C -06DD -070F c
@@ -674,6 +697,34 @@ mk_wcwidth(wchar_t ucs)
     return result;
 }
 
+#ifdef MAKE_WCWTBL
+/* the generator fills in its own copy of the tables */
+#define MAX_STAGE1 (WCW_LIMIT >> (WCW_LOW + WCW_MID))
+#define MAX_STAGE3 (WCW_LIMIT >> WCW_LOW)
+
+static unsigned short wcw_stage1[MAX_STAGE1];
+static unsigned short wcw_stage2[MAX_STAGE1][1 << WCW_MID];
+static signed char wcw_stage3[MAX_STAGE3][1 << WCW_LOW];
+static unsigned num_stage2;
+static unsigned num_stage3;
+#endif
+
+int
+mk_wcwidth(wchar_t ucs)
+{
+    unsigned long cmp = (unsigned long) ucs;
+    int result;
+
+    if (cmp == 0xad) {
+	result = use_latin1;
+    } else if (cmp < WCW_LIMIT) {
+	result = WCW_LOOKUP(cmp);
+    } else {
+	result = search_wcwidth(cmp);
+    }
+    return result;
+}
+
 int
 mk_wcswidth(const wchar_t *pwcs, size_t n)
 {
@@ -806,6 +857,7 @@ mk_wcswidth_cjk(const wchar_t *pwcs, size_t n)
     return width;
 }
 
+#ifndef MAKE_WCWTBL
 /*
  */
 int
@@ -823,3 +875,255 @@ vl_wcwidth(int code)
 #endif
     return result;
 }
+#endif /* MAKE_WCWTBL */
+
+#ifdef MAKE_WCWTBL
+/*
+ * Build the lookup tables from search_wcwidth(), sharing identical blocks.
+ */
+static void
+build_tables(void)
+{
+    unsigned short index2[1 << WCW_MID];
+    signed char widths[1 << WCW_LOW];
+    unsigned long code = 0;
+    unsigned hi, mid, lo, n;
+
+    for (hi = 0; hi < MAX_STAGE1; ++hi) {
+	for (mid = 0; mid < (1 << WCW_MID); ++mid) {
+	    for (lo = 0; lo < (1 << WCW_LOW); ++lo) {
+		widths[lo] = (signed char) search_wcwidth(code++);
+	    }
+	    for (n = 0; n < num_stage3; ++n) {
+		if (!memcmp(wcw_stage3[n], widths, sizeof(widths)))
+		    break;
+	    }
+	    if (n == num_stage3)
+		memcpy(wcw_stage3[num_stage3++], widths, sizeof(widths));
+	    index2[mid] = (unsigned short) n;
+	}
+	for (n = 0; n < num_stage2; ++n) {
+	    if (!memcmp(wcw_stage2[n], index2, sizeof(index2)))
+		break;
+	}
+	if (n == num_stage2)
+	    memcpy(wcw_stage2[num_stage2++], index2, sizeof(index2));
+	wcw_stage1[hi] = (unsigned short) n;
+    }
+
+    for (code = 0; code < WCW_LIMIT; ++code) {
+	if (WCW_LOOKUP(code) != search_wcwidth(code)) {
+	    fprintf(stderr, "mkwidth: table mismatch at U+%04lX\n", code);
+	    exit(EXIT_FAILURE);
+	}
+    }
+}
+
+static const char *
+index_type(unsigned count)
+{
+    return (count <= 256) ? "unsigned char" : "unsigned short";
+}
+
+static void
+emit_values(const int *values, unsigned count)
+{
+    unsigned n;
+
+    for (n = 0; n < count; ++n) {
+	if (n % 16 == 0)
+	    printf("\n\t");
+	printf("%d,", values[n]);
+    }
+}
+
+static void
+emit_tables(void)
+{
+    int values[1 << WCW_LOW];
+    unsigned row, col;
+
+    printf("/* generated by mkwidth from wcwidth.c -- do not edit */\n");
+
+    printf("\nstatic const %s wcw_stage1[%lu] =\n{",
+	   index_type(num_stage2), (unsigned long) MAX_STAGE1);
+    for (row = 0; row < MAX_STAGE1; ++row) {
+	if (row % 16 == 0)
+	    printf("\n\t");
+	printf("%u,", wcw_stage1[row]);
+    }
+    printf("\n};\n");
+
+    printf("\nstatic const %s wcw_stage2[%u][%u] =\n{\n",
+	   index_type(num_stage3), num_stage2, 1 << WCW_MID);
+    for (row = 0; row < num_stage2; ++row) {
+	for (col = 0; col < (1 << WCW_MID); ++col)
+	    values[col] = wcw_stage2[row][col];
+	printf("    {");
+	emit_values(values, 1 << WCW_MID);
+	printf("\n    },\n");
+    }
+    printf("};\n");
+
+    printf("\nstatic const signed char wcw_stage3[%u][%u] =\n{\n",
+	   num_stage3, 1 << WCW_LOW);
+    for (row = 0; row < num_stage3; ++row) {
+	for (col = 0; col < (1 << WCW_LOW); ++col)
+	    values[col] = wcw_stage3[row][col];
+	printf("    {");
+	emit_values(values, 1 << WCW_LOW);
+	printf("\n    },\n");
+    }
+    printf("};\n");
+}
+
+/*
+ * Decode a UTF-8 file into the corpus, ignoring malformed sequences.
+ */
+static size_t
+load_corpus(const char *name, unsigned long **corpus, size_t used)
+{
+    FILE *fp;
+    int ch;
+
+    if ((fp = fopen(name, "rb")) == NULL) {
+	perror(name);
+	exit(EXIT_FAILURE);
+    }
+    while ((ch = fgetc(fp)) != EOF) {
+	unsigned long code = (unsigned long) ch;
+	int extra = 0;
+
+	if (ch >= 0xf0) {
+	    code &= 0x07;
+	    extra = 3;
+	} else if (ch >= 0xe0) {
+	    code &= 0x0f;
+	    extra = 2;
+	} else if (ch >= 0xc0) {
+	    code &= 0x1f;
+	    extra = 1;
+	} else if (ch >= 0x80) {
+	    continue;
+	}
+	while (extra-- > 0) {
+	    if ((ch = fgetc(fp)) == EOF || (ch & 0xc0) != 0x80)
+		break;
+	    code = (code << 6) | (unsigned long) (ch & 0x3f);
+	}
+	if (extra >= 0)
+	    continue;
+	if ((used % 4096) == 0)
+	    *corpus = realloc(*corpus, (used + 4096) * sizeof(**corpus));
+	(*corpus)[used++] = code;
+    }
+    fclose(fp);
+    return used;
+}
+
+/*
+ * Without a corpus, make one which is mostly CJK, Hangul and emoji, with
+ * some kana, Latin and combining marks.
+ */
+static size_t
+make_corpus(unsigned long **corpus)
+{
+    static const unsigned long ranges[][2] =
+    {
+	{0x4E00, 0x9FFF},	/* CJK unified ideographs */
+	{0x4E00, 0x9FFF},
+	{0xAC00, 0xD7A3},	/* Hangul syllables */
+	{0x3040, 0x30FF},	/* Hiragana, Katakana */
+	{0x1F300, 0x1F64F},	/* pictographs, emoticons */
+	{0x1F900, 0x1F9FF},
+	{0x0020, 0x007E},	/* ASCII */
+	{0x00A0, 0x024F},	/* Latin-1, Latin Extended */
+	{0x0300, 0x036F},	/* combining diacritics */
+	{0x20000, 0x2A6DF},	/* CJK extension B */
+    };
+    size_t count = 1000000;
+    unsigned long seed = 1;
+    size_t n;
+
+    *corpus = malloc(count * sizeof(**corpus));
+    for (n = 0; n < count; ++n) {
+	unsigned which;
+
+	seed = seed * 1103515245UL + 12345UL;
+	which = (unsigned) ((seed >> 16) % (sizeof(ranges) / sizeof(ranges[0])));
+	seed = seed * 1103515245UL + 12345UL;
+	(*corpus)[n] = ranges[which][0]
+	    + ((seed >> 8) % (ranges[which][1] + 1 - ranges[which][0]));
+    }
+    return count;
+}
+
+static double
+elapsed(clock_t start)
+{
+    return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+/*
+ * Compare the time for binary searching against the table lookup.
+ */
+static int
+benchmark(int argc, char *argv[])
+{
+    unsigned long *corpus = NULL;
+    size_t count = 0;
+    size_t n;
+    long sum1 = 0;
+    long sum2 = 0;
+    int repeat = 20;
+    int pass;
+    double t1, t2;
+    clock_t start;
+
+    while (argc-- > 0)
+	count = load_corpus(*argv++, &corpus, count);
+    if (count == 0)
+	count = make_corpus(&corpus);
+
+    start = clock();
+    for (pass = 0; pass < repeat; ++pass) {
+	for (n = 0; n < count; ++n)
+	    sum1 += search_wcwidth(corpus[n]);
+    }
+    t1 = elapsed(start);
+
+    start = clock();
+    for (pass = 0; pass < repeat; ++pass) {
+	for (n = 0; n < count; ++n)
+	    sum2 += mk_wcwidth((wchar_t) corpus[n]);
+    }
+    t2 = elapsed(start);
+
+    printf("%lu codes, %d passes\n", (unsigned long) count, repeat);
+    printf("bisearch: %8.3f sec, %6.2f ns/code\n",
+	   t1, t1 * 1e9 / ((double) count * repeat));
+    printf("lookup:   %8.3f sec, %6.2f ns/code\n",
+	   t2, t2 * 1e9 / ((double) count * repeat));
+    free(corpus);
+
+    if (sum1 != sum2) {
+	fprintf(stderr, "mkwidth: sums differ (%ld vs %ld)\n", sum1, sum2);
+	return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Write the tables for wcwidth.c to the standard output, or with "-b",
+ * benchmark them against a corpus of UTF-8 files.
+ */
+int
+main(int argc, char *argv[])
+{
+    build_tables();
+    if (argc > 1 && !strcmp(argv[1], "-b"))
+	return benchmark(argc - 2, argv + 2);
+    emit_tables();
+    return EXIT_SUCCESS;
+}
+#endif /* MAKE_WCWTBL */
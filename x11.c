@@ -45,6 +45,16 @@ static TextWindowRec cur_win_rec;
 static TextWindow cur_win = &cur_win_rec;
 static TBUFF *PasteBuf;
 
+/*
+ * Text pasted into a buffer is returned by x_getc() between KEY_Paste and
+ * KEY_PasteEnd, so that ins_pasted() inserts it in one operation.
+ */
+static enum {
+    pb_NONE,
+    pb_PENDING,
+    pb_ACTIVE
+} PasteBracket = pb_NONE;
+
 #if OPT_KEV_SCROLLBARS || OPT_XAW_SCROLLBARS
 static Cursor curs_sb_v_double_arrow;
 static Cursor curs_sb_up_arrow;
@@ -3971,6 +3981,17 @@ insert_selection(Atom *selection, char *value, size_t length)
     int do_ins;
     char *s = NULL;		/* stifle warning */
 
+    PasteBracket = pb_NONE;
+    if (!reading_msg_line) {
+	if (tb_init(&PasteBuf, esc_c)) {
+	    if (tb_bappend(&PasteBuf, value, length))
+		PasteBracket = pb_PENDING;
+	    else
+		tb_free(&PasteBuf);
+	}
+	return;
+    }
+
     /* should be impossible to hit this with existing paste */
     /* XXX massive hack -- leave out 'i' if in prompt line */
     do_ins = !insertmode
@@ -5391,7 +5412,15 @@ x_getc(void)
 	    int limit = (int) tb_length(PasteBuf);
 	    int offset = (int) PasteBuf->tb_last;
 	    char *data = tb_values(PasteBuf) + offset;
+#endif
 
+	    if (PasteBracket == pb_PENDING) {
+		PasteBracket = pb_ACTIVE;
+		c = KEY_Paste;
+		cur_win->pasting = True;
+		break;
+	    }
+#if OPT_MULTIBYTE
 	    check = vl_conv_to_utf32(&result, data, (B_COUNT) (limit - offset));
 	    if (check > 0) {
 		c = (int) result;
@@ -5402,6 +5431,10 @@ x_getc(void)
 	    c = (c | (int) NOREMAP);	/* pasted chars are not subject to mapping */
 	    cur_win->pasting = True;
 	    break;
+	} else if (PasteBracket == pb_ACTIVE) {
+	    PasteBracket = pb_NONE;
+	    c = KEY_PasteEnd;
+	    break;
 	} else if (cur_win->pasting) {
 	    /*
 	     * Set the default position for new pasting to just past the newly
@@ -5445,7 +5478,7 @@ x_getc(void)
 
     x_stop_autocolor_timer();
 
-    if (c != ((int) NOREMAP | esc_c))
+    if (c != ((int) NOREMAP | esc_c) && c != KEY_PasteEnd)
 	cur_win->last_getc = c;
     return c;
 }
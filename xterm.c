@@ -25,6 +25,11 @@
 # endif
 #endif
 
+#define XTERM_ENABLE_PASTE	"\033[?2004h"	/* bracketed paste */
+#define XTERM_DISABLE_PASTE	"\033[?2004l"
+#define XTERM_BEGIN_PASTE	"\033[200~"
+#define XTERM_END_PASTE		"\033[201~"
+
 static int x_origin = 1, y_origin = 1;
 
 void
@@ -43,6 +48,8 @@ xterm_open(TERM * tp)
 
 #if OPT_XTERM
 	addtosysmap("\033[M", 3, KEY_Mouse);
+	addtosysmap(XTERM_BEGIN_PASTE, 6, KEY_Paste);
+	addtosysmap(XTERM_END_PASTE, 6, KEY_PasteEnd);
 #if OPT_XTERM >= 3
 	addtosysmap("\033[t", 3, KEY_text);
 	addtosysmap("\033[T", 3, KEY_textInvalid);
@@ -66,6 +73,10 @@ xterm_mopen(void)
 	putpad(XTERM_ENABLE_TRACKING);
 	fflush(stdout);
     }
+    if (global_g_val(GMDXTERM_PASTE)) {
+	putpad(XTERM_ENABLE_PASTE);
+	fflush(stdout);
+    }
     returnVoid();
 }
 
@@ -77,6 +88,9 @@ xterm_mclose(void)
 	putpad(XTERM_DISABLE_TRACKING);
 	fflush(stdout);
     }
+    /* the mode may have just been reset, cf. chgd_xtermpaste() */
+    putpad(XTERM_DISABLE_PASTE);
+    fflush(stdout);
     returnVoid();
 }
 